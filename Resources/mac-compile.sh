@@ -7,7 +7,7 @@ echo "-------------------------------------------"
 FOLDER_CREATED=false
 rm -rf CompiledShaders
 
-for entry in `find . -type f -name "*.frag" & find . -type f -name "*.vert"`; do
+for entry in `find . -type f -name "*.frag" & find . -type f -name "*.vert" & find . -type f -name "*.comp"`; do
 	SHADER_NAME=$(basename "$entry")
 	echo "Found $SHADER_NAME"
 	if [ $FOLDER_CREATED == false ]
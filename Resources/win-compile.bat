@@ -1,3 +1,4 @@
 D:\Libs\VulkanSDK\1.2.176.1\Bin32\glslc.exe shaderInstance.vert -o vertex.spv
 D:\Libs\VulkanSDK\1.2.176.1\Bin32\glslc.exe shaderInstance.frag -o fragment.spv
+D:\Libs\VulkanSDK\1.2.176.1\Bin32\glslc.exe ShaderExamples\rgba2yuv.comp -o rgba2yuv.comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <SGR.h>
+
+#include <math.h>
+#include <algorithm>
+
+// Scene helpers shared by sgr_bench and sgr_microbench
+
+// data structure for instance uses shader presenter as "instance shader"
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec2 deltaText;
+	glm::vec2 startMesh;
+	glm::vec2 startText;
+};
+
+inline std::vector<VkDescriptorSetLayoutBinding> createDescriptorSetLayoutBinding()
+{
+	VkDescriptorSetLayoutBinding uboLayoutBinding{};
+	uboLayoutBinding.binding = 0;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorCount = 1;
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+	samplerLayoutBinding.binding = 1;
+	samplerLayoutBinding.descriptorCount = 1;
+	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding instanceUBOLayoutBinding{};
+	instanceUBOLayoutBinding.binding = 2;
+	instanceUBOLayoutBinding.descriptorCount = 1;
+	instanceUBOLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	instanceUBOLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	return { uboLayoutBinding, samplerLayoutBinding, instanceUBOLayoutBinding };
+}
+
+inline std::vector<VkVertexInputBindingDescription> createBindingDescr()
+{
+	VkVertexInputBindingDescription vertexBindingDescription{};
+	vertexBindingDescription.binding = 0;
+	vertexBindingDescription.stride = sizeof(SgrVertex);
+	vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return { vertexBindingDescription };
+}
+
+inline std::vector<VkVertexInputAttributeDescription> createAttrDescr()
+{
+	VkVertexInputAttributeDescription positionDescr{};
+	positionDescr.binding = 0;
+	positionDescr.location = 0;
+	positionDescr.format = VK_FORMAT_R32G32B32_SFLOAT;
+	positionDescr.offset = 0;
+	return { positionDescr };
+}
+
+// regular polygon with 3 + index%30 sides inscribed in [-0.5; 0.5] square, triangle fan indices
+inline void createPolygon(uint32_t index, std::vector<SgrVertex>& vertices, std::vector<uint16_t>& indices)
+{
+	uint32_t sides = 3 + index % 30;
+	vertices.push_back({ 0, 0, 0 });
+	for (uint32_t i = 0; i < sides; i++) {
+		float angle = 2.f * 3.14159265f * i / sides;
+		vertices.push_back({ 0.5f * cosf(angle), 0.5f * sinf(angle), 0 });
+	}
+	for (uint32_t i = 0; i < sides; i++) {
+		indices.push_back(0);
+		indices.push_back(uint16_t(1 + i));
+		indices.push_back(uint16_t(1 + (i + 1) % sides));
+	}
+}
+
+// procedural checkerboard, colors depend on seed so textures differ
+inline SgrErrCode createCheckerTexture(uint32_t seed, uint32_t size, SgrImage*& image)
+{
+	std::vector<uint32_t> pixels(size * size);
+	uint32_t colorA = 0xFF000000 | ((seed * 2654435761u) & 0x00FFFFFF);
+	uint32_t colorB = 0xFF000000 | (~colorA & 0x00FFFFFF);
+	uint32_t cell = std::max(1u, size / 8);
+	for (uint32_t y = 0; y < size; y++)
+		for (uint32_t x = 0; x < size; x++)
+			pixels[y * size + x] = ((x / cell + y / cell) % 2) ? colorA : colorB;
+
+	return TextureManager::createTextureImageFromPixels(pixels.data(), size, size, image);
+}
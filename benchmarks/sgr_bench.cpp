@@ -0,0 +1,898 @@
+#include <SGR.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "BenchScene.h"
+
+// Headless benchmark suite. Every scenario renders the same generated scene into offscreen images,
+// results are written as JSON and can be compared with previous run:
+//
+//   sgr_bench --scenario all --out current.json
+//   sgr_bench --scenario all --out current.json --compare baseline.json --threshold 0.1
+//
+// Scenario is executed in separate process when "all" is requested because SGR is initialized once per process.
+//
+// yuv_check isn't part of "all", it captures the same frame with GPU YUV conversion and as RGBA converted by
+// CaptureManager::convertRGBAToYUV, exit code is 1 if any plane differs by more than yuvTolerance:
+//
+//   sgr_bench --scenario yuv_check --conversion-shader rgba2yuv.comp.spv
+
+#ifndef SGR_BENCH_RESOURCES
+	#define SGR_BENCH_RESOURCES "Resources"
+#endif
+
+#ifndef SGR_BENCH_CONVERSION_SHADER
+	#define SGR_BENCH_CONVERSION_SHADER "Resources/CompiledShaders/rgba2yuv.comp.spv"
+#endif
+
+const char* scenarioNames[] = { "static", "dynamic", "descriptor_churn", "resize_storm", "load_storm" };
+const uint8_t scenariosCount = sizeof(scenarioNames) / sizeof(scenarioNames[0]);
+const char* checkNames[] = { "yuv_check" };
+
+const uint32_t yuvTolerance = 1; // rounding of float math differs between GPU and CPU
+
+struct BenchParams {
+	std::string scenario = "static";
+	uint32_t instances = 1000;
+	uint32_t geometries = 8;
+	uint32_t textures = 16;
+	uint32_t frames = 600;
+	uint32_t warmup = 60;
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	uint32_t resizePeriod = 10; // frames between resizes in resize_storm
+	float threshold = 0.1f;     // allowed relative regression
+	std::string out;
+	std::string compare;
+	std::string resources = SGR_BENCH_RESOURCES;
+	std::string conversionShader = SGR_BENCH_CONVERSION_SHADER; // compiled by Resources/mac-compile.sh or win-compile.bat
+};
+
+BenchParams params;
+
+SGR sgr;
+SgrInstancesUniformBufferObject instancesData;
+SgrGlobalUniformBufferObject globalData;
+SgrBuffer* uboBuffer = nullptr;
+SgrBuffer* instanceUBO = nullptr;
+std::vector<SgrImage*> textures;
+std::vector<std::string> instanceNames;
+std::vector<glm::mat4> baseModels;
+uint32_t frameIndex = 0;
+uint32_t benchErrors = 0;
+bool checkFailed = false;
+
+//----------------------------------------------------------------------------- minimal JSON
+
+struct JsonValue {
+	enum Type { NUL, NUMBER, STRING, BOOL, ARRAY, OBJECT } type = NUL;
+	double number = 0;
+	bool boolean = false;
+	std::string str;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	const JsonValue* get(const std::string& key) const
+	{
+		for (auto& member : object)
+			if (member.first == key)
+				return &member.second;
+		return nullptr;
+	}
+};
+
+struct JsonParser {
+	const char* p;
+
+	void skip() { while (*p && isspace((unsigned char)*p)) p++; }
+
+	bool parseString(std::string& res)
+	{
+		if (*p != '"')
+			return false;
+		p++;
+		while (*p && *p != '"') {
+			if (*p == '\\' && *(p + 1))
+				p++;
+			res += *p++;
+		}
+		if (*p != '"')
+			return false;
+		p++;
+		return true;
+	}
+
+	bool parse(JsonValue& value)
+	{
+		skip();
+		if (*p == '{') {
+			value.type = JsonValue::OBJECT;
+			p++; skip();
+			if (*p == '}') { p++; return true; }
+			while (true) {
+				skip();
+				std::string key;
+				if (!parseString(key))
+					return false;
+				skip();
+				if (*p++ != ':')
+					return false;
+				value.object.push_back({ key, JsonValue() });
+				if (!parse(value.object.back().second))
+					return false;
+				skip();
+				if (*p == ',') { p++; continue; }
+				if (*p == '}') { p++; return true; }
+				return false;
+			}
+		}
+		if (*p == '[') {
+			value.type = JsonValue::ARRAY;
+			p++; skip();
+			if (*p == ']') { p++; return true; }
+			while (true) {
+				value.array.push_back(JsonValue());
+				if (!parse(value.array.back()))
+					return false;
+				skip();
+				if (*p == ',') { p++; continue; }
+				if (*p == ']') { p++; return true; }
+				return false;
+			}
+		}
+		if (*p == '"') {
+			value.type = JsonValue::STRING;
+			return parseString(value.str);
+		}
+		if (!strncmp(p, "true", 4) || !strncmp(p, "false", 5)) {
+			value.type = JsonValue::BOOL;
+			value.boolean = *p == 't';
+			p += value.boolean ? 4 : 5;
+			return true;
+		}
+		if (!strncmp(p, "null", 4)) {
+			p += 4;
+			return true;
+		}
+		char* end = nullptr;
+		value.type = JsonValue::NUMBER;
+		value.number = strtod(p, &end);
+		if (end == p)
+			return false;
+		p = end;
+		return true;
+	}
+};
+
+bool loadJson(const std::string& path, JsonValue& root)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	std::string text;
+	char chunk[4096];
+	size_t readed;
+	while ((readed = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		text.append(chunk, readed);
+	fclose(file);
+
+	JsonParser parser{ text.c_str() };
+	return parser.parse(root);
+}
+
+void writeJson(FILE* file, const JsonValue& value, int indent)
+{
+	std::string pad(indent * 2, ' ');
+	switch (value.type) {
+		case JsonValue::NUMBER:
+			fprintf(file, "%.6g", value.number);
+			break;
+		case JsonValue::STRING:
+			fprintf(file, "\"%s\"", value.str.c_str());
+			break;
+		case JsonValue::BOOL:
+			fprintf(file, value.boolean ? "true" : "false");
+			break;
+		case JsonValue::ARRAY:
+			fprintf(file, "[\n");
+			for (size_t i = 0; i < value.array.size(); i++) {
+				fprintf(file, "%s  ", pad.c_str());
+				writeJson(file, value.array[i], indent + 1);
+				fprintf(file, i + 1 < value.array.size() ? ",\n" : "\n");
+			}
+			fprintf(file, "%s]", pad.c_str());
+			break;
+		case JsonValue::OBJECT:
+			fprintf(file, "{\n");
+			for (size_t i = 0; i < value.object.size(); i++) {
+				fprintf(file, "%s  \"%s\": ", pad.c_str(), value.object[i].first.c_str());
+				writeJson(file, value.object[i].second, indent + 1);
+				fprintf(file, i + 1 < value.object.size() ? ",\n" : "\n");
+			}
+			fprintf(file, "%s}", pad.c_str());
+			break;
+		default:
+			fprintf(file, "null");
+	}
+}
+
+JsonValue jsonNumber(double number)
+{
+	JsonValue value;
+	value.type = JsonValue::NUMBER;
+	value.number = number;
+	return value;
+}
+
+JsonValue jsonString(std::string str)
+{
+	JsonValue value;
+	value.type = JsonValue::STRING;
+	value.str = str;
+	return value;
+}
+
+JsonValue jsonBool(bool boolean)
+{
+	JsonValue value;
+	value.type = JsonValue::BOOL;
+	value.boolean = boolean;
+	return value;
+}
+
+JsonValue jsonObject()
+{
+	JsonValue value;
+	value.type = JsonValue::OBJECT;
+	return value;
+}
+
+// percentiles in milliseconds
+JsonValue jsonPercentiles(float p50, float p95, float p99, float max)
+{
+	JsonValue value = jsonObject();
+	value.object.push_back({ "p50", jsonNumber(p50 * 1000.0) });
+	value.object.push_back({ "p95", jsonNumber(p95 * 1000.0) });
+	value.object.push_back({ "p99", jsonNumber(p99 * 1000.0) });
+	value.object.push_back({ "max", jsonNumber(max * 1000.0) });
+	return value;
+}
+
+JsonValue jsonPercentiles(const SgrFramePercentiles& percentiles)
+{
+	return jsonPercentiles(percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max);
+}
+
+JsonValue jsonPercentiles(std::vector<float> values)
+{
+	if (values.empty())
+		return jsonPercentiles(0, 0, 0, 0);
+
+	std::sort(values.begin(), values.end());
+	auto percentile = [&values](float p) { return values[std::min(values.size() - 1, size_t(ceil(p * values.size())) - 1)]; };
+	return jsonPercentiles(percentile(0.5f), percentile(0.95f), percentile(0.99f), values.back());
+}
+
+//----------------------------------------------------------------------------- scene
+
+SgrErrCode writeInstanceDescriptors(uint32_t instance, SgrImage* texture)
+{
+	std::vector<void*> objectData;
+	objectData.push_back((void*)(uboBuffer));
+	objectData.push_back((void*)(texture));
+	objectData.push_back((void*)(instanceUBO));
+	return sgr.writeDescriptorSets(instanceNames[instance], objectData);
+}
+
+InstanceData* getInstanceData(uint32_t instance)
+{
+	return (InstanceData*)((uint64_t)instancesData.data + instance * instancesData.dynamicAlignment);
+}
+
+SgrErrCode createScene()
+{
+	std::string vertShader = params.resources + "/shaders/vertInstanceSh.spv";
+	std::string fragShader = params.resources + "/shaders/fragTextureSh.spv";
+
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBinding = createDescriptorSetLayoutBinding();
+	std::vector<VkVertexInputBindingDescription> bindInpDescr = createBindingDescr();
+	std::vector<VkVertexInputAttributeDescription> attDescr = createAttrDescr();
+
+	instancesData.instnaceCount = params.instances;
+	instancesData.instanceSize = sizeof(InstanceData);
+	SgrErrCode result = MemoryManager::createDynamicUniformMemory(instancesData);
+	if (result != sgrOK)
+		return result;
+
+	result = MemoryManager::get()->createDynamicUniformBuffer(instanceUBO, instancesData.dataSize, instancesData.dynamicAlignment);
+	if (result != sgrOK)
+		return result;
+	sgr.setupInstancesUniformBufferObject(instanceUBO);
+
+	result = MemoryManager::get()->createUniformBuffer(uboBuffer, sizeof(SgrGlobalUniformBufferObject));
+	if (result != sgrOK)
+		return result;
+	sgr.setupGlobalUniformBufferObject(uboBuffer);
+
+	std::vector<std::shared_future<SgrErrCode>> pipelinesReady(params.geometries);
+	for (uint32_t i = 0; i < params.geometries; i++) {
+		std::vector<SgrVertex> vertices;
+		std::vector<uint16_t> indices;
+		createPolygon(i, vertices, indices);
+		result = sgr.addNewObjectGeometry("geometry" + std::to_string(i), vertices, indices, vertShader, fragShader, true,
+										  bindInpDescr, attDescr, setLayoutBinding, &pipelinesReady[i]);
+		if (result != sgrOK)
+			return result;
+	}
+
+	for (uint32_t i = 0; i < params.textures; i++) {
+		SgrImage* texture = nullptr;
+		result = createCheckerTexture(i, 256, texture);
+		if (result != sgrOK)
+			return result;
+		textures.push_back(texture);
+	}
+
+	// instances are placed on grid covering whole frame
+	uint32_t columns = (uint32_t)ceil(sqrt((double)params.instances));
+	float cell = 2.f / columns;
+	for (uint32_t i = 0; i < params.instances; i++) {
+		std::string name = "instance" + std::to_string(i);
+		instanceNames.push_back(name);
+
+		result = sgr.addObjectInstance(name, "geometry" + std::to_string(i % params.geometries), i * instancesData.dynamicAlignment);
+		if (result != sgrOK)
+			return result;
+
+		result = writeInstanceDescriptors(i, textures[i % params.textures]);
+		if (result != sgrOK)
+			return result;
+
+		result = sgr.drawObject(name);
+		if (result != sgrOK)
+			return result;
+
+		glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(-1.f + cell * (i % columns + 0.5f), -1.f + cell * (i / columns + 0.5f), 0));
+		baseModels.push_back(glm::scale(model, glm::vec3(cell * 0.9f)));
+
+		InstanceData* iData = getInstanceData(i);
+		iData->model = baseModels.back();
+		iData->color = glm::vec4(1.f);
+		iData->startMesh = glm::vec2(-0.5, -0.5);
+		iData->startText = glm::vec2(0, 0);
+		iData->deltaText = glm::vec2(1, 1);
+	}
+
+	globalData.view = glm::mat4(1.f);
+	globalData.proj = glm::mat4(1.f);
+	sgr.updateGlobalUniformBufferObject(globalData);
+	sgr.updateInstancesUniformBufferObject(instancesData);
+
+	// pipelines are compiled in background, measurement should not include compilation
+	for (auto& ready : pipelinesReady) {
+		result = ready.get();
+		if (result != sgrOK)
+			return result;
+	}
+
+	return sgrOK;
+}
+
+//----------------------------------------------------------------------------- scenarios
+
+void updateDynamic()
+{
+	float angle = frameIndex * 0.01f;
+	for (uint32_t i = 0; i < params.instances; i++)
+		getInstanceData(i)->model = glm::rotate(baseModels[i], angle + i, glm::vec3(0, 0, 1));
+
+	sgr.updateInstancesUniformBufferObject(instancesData);
+}
+
+void updateDescriptorChurn()
+{
+	uint32_t churnCount = std::max(1u, params.instances / 10);
+	for (uint32_t i = 0; i < churnCount; i++) {
+		uint32_t instance = (frameIndex * churnCount + i) % params.instances;
+		if (writeInstanceDescriptors(instance, textures[(instance + frameIndex) % params.textures]) != sgrOK)
+			benchErrors++;
+	}
+}
+
+// new texture every frame, textures are not released until exit
+void updateLoadStorm()
+{
+	SgrImage* texture = nullptr;
+	if (createCheckerTexture(params.textures + frameIndex, 128, texture) != sgrOK) {
+		benchErrors++;
+		return;
+	}
+	textures.push_back(texture);
+
+	if (writeInstanceDescriptors(frameIndex % params.instances, texture) != sgrOK)
+		benchErrors++;
+}
+
+// called between frames
+SgrErrCode resizeStormStep()
+{
+	if (frameIndex % params.resizePeriod != 0)
+		return sgrOK;
+
+	bool small = (frameIndex / params.resizePeriod) % 2;
+	uint32_t width = small ? params.width / 2 : params.width;
+	uint32_t height = small ? params.height / 2 : params.height;
+	return sgr.resizeOffscreen(std::max(1u, width), std::max(1u, height));
+}
+
+JsonValue runScenario()
+{
+	JsonValue result = jsonObject();
+	result.object.push_back({ "name", jsonString(params.scenario) });
+	result.object.push_back({ "instances", jsonNumber(params.instances) });
+	result.object.push_back({ "geometries", jsonNumber(params.geometries) });
+	result.object.push_back({ "textures", jsonNumber(params.textures) });
+	result.object.push_back({ "frames", jsonNumber(params.frames) });
+	result.object.push_back({ "width", jsonNumber(params.width) });
+	result.object.push_back({ "height", jsonNumber(params.height) });
+
+	if (params.scenario == "dynamic")
+		sgr.setUpdateFunction(updateDynamic);
+	else if (params.scenario == "descriptor_churn")
+		sgr.setUpdateFunction(updateDescriptorChurn);
+	else if (params.scenario == "load_storm")
+		sgr.setUpdateFunction(updateLoadStorm);
+
+	bool resizeStorm = params.scenario == "resize_storm";
+
+	for (frameIndex = 0; frameIndex < params.warmup; frameIndex++) {
+		if (resizeStorm && resizeStormStep() != sgrOK)
+			benchErrors++;
+		if (sgr.drawFrame() != sgrOK)
+			benchErrors++;
+	}
+
+	sgr.setFrameStatsWindow(params.frames);
+	sgr.resetFrameStats();
+
+	std::vector<float> gpuFrame, gpuScene, gpuUploads;
+	uint64_t lastGpuFrame = 0;
+	SgrRenderStats counters;
+
+	SgrTime_t start = SgrTime::now();
+	for (uint32_t i = 0; i < params.frames; i++, frameIndex++) {
+		if (resizeStorm && resizeStormStep() != sgrOK)
+			benchErrors++;
+		if (sgr.drawFrame() != sgrOK)
+			benchErrors++;
+
+		SgrGpuFrameTimings gpuTimings;
+		if (sgr.getLastGpuFrameTimings(gpuTimings) && gpuTimings.frameNumber > lastGpuFrame) {
+			lastGpuFrame = gpuTimings.frameNumber;
+			gpuFrame.push_back(gpuTimings.frame);
+			gpuScene.push_back(gpuTimings.scene);
+			gpuUploads.push_back(gpuTimings.uploads);
+		}
+
+		counters += sgr.getRenderStats();
+	}
+	double wallTime = std::chrono::duration<double>(SgrTime::now() - start).count();
+
+	const SgrFrameStats& cpuStats = sgr.getFrameStats();
+
+	result.object.push_back({ "wallTime", jsonNumber(wallTime) });
+	result.object.push_back({ "fps", jsonNumber(params.frames / wallTime) });
+	result.object.push_back({ "errors", jsonNumber(benchErrors) });
+
+	JsonValue cpu = jsonObject();
+	cpu.object.push_back({ "frameTime", jsonPercentiles(cpuStats.frameTime) });
+	cpu.object.push_back({ "update", jsonPercentiles(cpuStats.update) });
+	cpu.object.push_back({ "recording", jsonPercentiles(cpuStats.recording) });
+	cpu.object.push_back({ "acquire", jsonPercentiles(cpuStats.acquire) });
+	cpu.object.push_back({ "submit", jsonPercentiles(cpuStats.submit) });
+	result.object.push_back({ "cpu", cpu });
+
+	JsonValue gpu = jsonObject();
+	gpu.object.push_back({ "supported", jsonBool(sgr.isGpuTimingSupported()) });
+	gpu.object.push_back({ "samples", jsonNumber(gpuFrame.size()) });
+	gpu.object.push_back({ "frame", jsonPercentiles(gpuFrame) });
+	gpu.object.push_back({ "scene", jsonPercentiles(gpuScene) });
+	gpu.object.push_back({ "uploads", jsonPercentiles(gpuUploads) });
+	result.object.push_back({ "gpu", gpu });
+
+	// average per frame
+	double frames = params.frames;
+	JsonValue perFrame = jsonObject();
+	perFrame.object.push_back({ "drawCalls", jsonNumber(counters.drawCalls / frames) });
+	perFrame.object.push_back({ "triangles", jsonNumber(counters.triangles / frames) });
+	perFrame.object.push_back({ "pipelineBinds", jsonNumber(counters.pipelineBinds / frames) });
+	perFrame.object.push_back({ "descriptorSetBinds", jsonNumber(counters.descriptorSetBinds / frames) });
+	perFrame.object.push_back({ "descriptorUpdates", jsonNumber(counters.descriptorUpdates / frames) });
+	perFrame.object.push_back({ "bytesUploaded", jsonNumber(counters.bytesUploaded / frames) });
+	perFrame.object.push_back({ "commandBuffersRecorded", jsonNumber(counters.commandBuffersRecorded / frames) });
+	perFrame.object.push_back({ "allocations", jsonNumber(counters.allocations / frames) });
+	result.object.push_back({ "perFrame", perFrame });
+
+	sgr.setUpdateFunction(nullptr);
+	return result;
+}
+
+//----------------------------------------------------------------------------- yuv check
+
+struct StoredFrame {
+	std::vector<uint8_t> pixels;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t delivered = 0;
+};
+
+void storeCapturedFrame(const SgrCapturedFrame& frame, void* userData)
+{
+	StoredFrame* stored = (StoredFrame*)userData;
+	stored->pixels.assign(frame.pixels, frame.pixels + frame.dataSize);
+	stored->width = frame.width;
+	stored->height = frame.height;
+	stored->format = frame.format;
+	stored->delivered++;
+}
+
+// scene is static, so every frame has the same pixels and last delivered one is kept
+SgrErrCode captureFrame(SgrCaptureFormat format, StoredFrame& frame, bool& gpuConverted)
+{
+	SgrErrCode result = sgr.startCapture(storeCapturedFrame, &frame, 1, format);
+	if (result != sgrOK)
+		return result;
+	gpuConverted = CaptureManager::get()->isGPUConversionUsed();
+
+	for (uint32_t i = 0; i < 3; i++) {
+		result = sgr.drawFrame();
+		if (result != sgrOK)
+			break;
+	}
+
+	SgrErrCode resultStop = sgr.stopCapture();
+	if (result != sgrOK)
+		return result;
+	if (resultStop != sgrOK)
+		return resultStop;
+
+	return frame.delivered > 0 ? sgrOK : sgrCaptureNotSupported;
+}
+
+// maximal absolute difference of Y, U and V planes, NV12 chroma is deinterleaved
+JsonValue compareYUV(const StoredFrame& gpu, const std::vector<uint8_t>& cpu, SgrCaptureFormat format, bool& passed)
+{
+	size_t lumaSize = size_t(gpu.width) * gpu.height;
+	size_t chromaSize = size_t((gpu.width + 1) / 2) * ((gpu.height + 1) / 2);
+	uint32_t maxDiff[3] = { 0, 0, 0 };
+
+	for (size_t i = 0; i < cpu.size() && i < gpu.pixels.size(); i++) {
+		uint32_t plane = 0;
+		if (i >= lumaSize) {
+			size_t chromaIndex = i - lumaSize;
+			plane = format == SGR_CAPTURE_NV12 ? 1 + chromaIndex % 2 : 1 + uint32_t(chromaIndex / chromaSize);
+		}
+		uint32_t diff = (uint32_t)abs(int(gpu.pixels[i]) - int(cpu[i]));
+		maxDiff[plane] = std::max(maxDiff[plane], diff);
+	}
+
+	passed = gpu.pixels.size() == cpu.size() && maxDiff[0] <= yuvTolerance && maxDiff[1] <= yuvTolerance && maxDiff[2] <= yuvTolerance;
+
+	JsonValue result = jsonObject();
+	result.object.push_back({ "y", jsonNumber(maxDiff[0]) });
+	result.object.push_back({ "u", jsonNumber(maxDiff[1]) });
+	result.object.push_back({ "v", jsonNumber(maxDiff[2]) });
+	result.object.push_back({ "passed", jsonBool(passed) });
+	return result;
+}
+
+JsonValue runYuvCheck()
+{
+	JsonValue result = jsonObject();
+	result.object.push_back({ "name", jsonString(params.scenario) });
+	result.object.push_back({ "width", jsonNumber(params.width) });
+	result.object.push_back({ "height", jsonNumber(params.height) });
+	result.object.push_back({ "tolerance", jsonNumber(yuvTolerance) });
+
+	StoredFrame rgba;
+	bool gpuConverted = false;
+	SgrErrCode resultCapture = captureFrame(SGR_CAPTURE_RGBA, rgba, gpuConverted);
+	if (resultCapture != sgrOK) {
+		printf("RGBA capture error %d\n", resultCapture);
+		checkFailed = true;
+		return result;
+	}
+
+	bool bgra = rgba.format == VK_FORMAT_B8G8R8A8_SRGB || rgba.format == VK_FORMAT_B8G8R8A8_UNORM;
+	sgr.setCaptureConversionShader(params.conversionShader);
+
+	const std::pair<SgrCaptureFormat, const char*> formats[] = { { SGR_CAPTURE_NV12, "nv12" }, { SGR_CAPTURE_I420, "i420" } };
+	for (auto& format : formats) {
+		StoredFrame yuv;
+		resultCapture = captureFrame(format.first, yuv, gpuConverted);
+		if (resultCapture != sgrOK || !gpuConverted || yuv.width != rgba.width || yuv.height != rgba.height) {
+			// conversion shader is missing or frame size isn't supported by it (width % 8, height % 2)
+			printf("%s: GPU conversion wasn't used, error %d\n", format.second, resultCapture);
+			result.object.push_back({ format.second, jsonString("not converted on GPU") });
+			checkFailed = true;
+			continue;
+		}
+
+		std::vector<uint8_t> reference(CaptureManager::getCaptureDataSize(rgba.width, rgba.height, format.first));
+		CaptureManager::convertRGBAToYUV(rgba.pixels.data(), rgba.width, rgba.height, bgra, format.first, reference.data());
+
+		bool passed = false;
+		JsonValue planes = compareYUV(yuv, reference, format.first, passed);
+		printf("%s: max difference Y %g, U %g, V %g%s\n", format.second, planes.get("y")->number, planes.get("u")->number,
+			   planes.get("v")->number, passed ? "" : "  FAILED");
+		result.object.push_back({ format.second, planes });
+		if (!passed)
+			checkFailed = true;
+	}
+
+	result.object.push_back({ "passed", jsonBool(!checkFailed) });
+	return result;
+}
+
+//----------------------------------------------------------------------------- report
+
+JsonValue createReport(std::vector<JsonValue> scenarios)
+{
+	JsonValue report = jsonObject();
+	report.object.push_back({ "sgrVersion", jsonString(std::to_string(SGR_VERSION_MAJOR) + "." + std::to_string(SGR_VERSION_MINOR) + "." + std::to_string(SGR_VERSION_PATCH)) });
+
+	JsonValue list;
+	list.type = JsonValue::ARRAY;
+	list.array = scenarios;
+	report.object.push_back({ "scenarios", list });
+	return report;
+}
+
+bool saveReport(const JsonValue& report, const std::string& path)
+{
+	FILE* file = path.empty() ? stdout : fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	writeJson(file, report, 0);
+	fprintf(file, "\n");
+
+	if (file != stdout)
+		fclose(file);
+	return true;
+}
+
+const JsonValue* findMetric(const JsonValue& scenario, const char* group, const char* metric, const char* percentile)
+{
+	const JsonValue* value = scenario.get(group);
+	if (value)
+		value = value->get(metric);
+	if (value)
+		value = value->get(percentile);
+	return value && value->type == JsonValue::NUMBER ? value : nullptr;
+}
+
+// returns count of regressed metrics
+uint32_t compareReports(const JsonValue& baseline, const JsonValue& current)
+{
+	// differences smaller than this are noise even if relative change is big
+	const double absoluteFloor = 0.05; // ms
+
+	const char* metrics[][2] = { { "cpu", "frameTime" }, { "cpu", "recording" }, { "gpu", "frame" }, { "gpu", "scene" } };
+	const char* percentiles[] = { "p50", "p95", "p99" };
+
+	const JsonValue* baseScenarios = baseline.get("scenarios");
+	const JsonValue* curScenarios = current.get("scenarios");
+	if (!baseScenarios || !curScenarios)
+		return 0;
+
+	uint32_t regressions = 0;
+	printf("%-18s %-16s %-4s %10s %10s %8s\n", "scenario", "metric", "", "base, ms", "cur, ms", "change");
+	for (auto& cur : curScenarios->array) {
+		const JsonValue* curName = cur.get("name");
+		const JsonValue* base = nullptr;
+		for (auto& candidate : baseScenarios->array) {
+			const JsonValue* name = candidate.get("name");
+			if (name && curName && name->str == curName->str)
+				base = &candidate;
+		}
+		if (!base || !curName)
+			continue;
+
+		for (auto& metric : metrics) {
+			for (auto percentile : percentiles) {
+				const JsonValue* baseValue = findMetric(*base, metric[0], metric[1], percentile);
+				const JsonValue* curValue = findMetric(cur, metric[0], metric[1], percentile);
+				if (!baseValue || !curValue || baseValue->number <= 0)
+					continue;
+
+				double change = curValue->number / baseValue->number - 1.0;
+				bool regressed = change > params.threshold && curValue->number - baseValue->number > absoluteFloor;
+				if (regressed)
+					regressions++;
+
+				std::string metricName = std::string(metric[0]) + "." + metric[1];
+				printf("%-18s %-16s %-4s %10.3f %10.3f %+7.1f%%%s\n", curName->str.c_str(), metricName.c_str(), percentile,
+					   baseValue->number, curValue->number, change * 100.0, regressed ? "  REGRESSION" : "");
+			}
+		}
+	}
+
+	return regressions;
+}
+
+//----------------------------------------------------------------------------- main
+
+void printHelp()
+{
+	printf("sgr_bench - headless SGR benchmark suite\n\n");
+	printf("  --scenario NAME     static, dynamic, descriptor_churn, resize_storm, load_storm or all (default static),\n");
+	printf("                      yuv_check compares GPU and CPU YUV capture, exit code is 1 if they differ\n");
+	printf("  --instances N       instances count (default %u)\n", params.instances);
+	printf("  --geometries N      geometries count (default %u)\n", params.geometries);
+	printf("  --textures N        textures count (default %u)\n", params.textures);
+	printf("  --frames N          measured frames (default %u)\n", params.frames);
+	printf("  --warmup N          frames before measurement (default %u)\n", params.warmup);
+	printf("  --width N --height N  render target size (default %ux%u)\n", params.width, params.height);
+	printf("  --resources PATH    folder with shaders (default %s)\n", params.resources.c_str());
+	printf("  --conversion-shader FILE  compiled rgba2yuv.comp for yuv_check (default %s)\n", params.conversionShader.c_str());
+	printf("  --out FILE          JSON output, stdout if not set\n");
+	printf("  --compare FILE      baseline JSON, exit code is 1 if any percentile regressed\n");
+	printf("  --threshold X       allowed relative regression (default %.2f)\n", params.threshold);
+}
+
+bool parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printHelp();
+			exit(0);
+		}
+		if (i + 1 >= argc) {
+			printf("Missing value for %s\n", arg.c_str());
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--scenario")
+			params.scenario = value;
+		else if (arg == "--instances")
+			params.instances = std::max(1, atoi(value.c_str()));
+		else if (arg == "--geometries")
+			params.geometries = std::max(1, atoi(value.c_str()));
+		else if (arg == "--textures")
+			params.textures = std::max(1, atoi(value.c_str()));
+		else if (arg == "--frames")
+			params.frames = std::max(1, atoi(value.c_str()));
+		else if (arg == "--warmup")
+			params.warmup = std::max(0, atoi(value.c_str()));
+		else if (arg == "--width")
+			params.width = std::max(1, atoi(value.c_str()));
+		else if (arg == "--height")
+			params.height = std::max(1, atoi(value.c_str()));
+		else if (arg == "--resources")
+			params.resources = value;
+		else if (arg == "--conversion-shader")
+			params.conversionShader = value;
+		else if (arg == "--out")
+			params.out = value;
+		else if (arg == "--compare")
+			params.compare = value;
+		else if (arg == "--threshold")
+			params.threshold = (float)atof(value.c_str());
+		else {
+			printf("Unknown argument %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	if (params.scenario == "all")
+		return true;
+	for (auto name : scenarioNames)
+		if (params.scenario == name)
+			return true;
+	for (auto name : checkNames)
+		if (params.scenario == name)
+			return true;
+
+	printf("Unknown scenario %s\n", params.scenario.c_str());
+	return false;
+}
+
+// every scenario in own process, SGR can be initialized only once
+bool runAllScenarios(const char* executable, std::vector<JsonValue>& results)
+{
+	for (auto name : scenarioNames) {
+		std::string output = params.out.empty() ? std::string("sgr_bench_") + name + ".json" : params.out + "." + name;
+		std::string command = std::string("\"") + executable + "\" --scenario " + name +
+							  " --instances " + std::to_string(params.instances) +
+							  " --geometries " + std::to_string(params.geometries) +
+							  " --textures " + std::to_string(params.textures) +
+							  " --frames " + std::to_string(params.frames) +
+							  " --warmup " + std::to_string(params.warmup) +
+							  " --width " + std::to_string(params.width) +
+							  " --height " + std::to_string(params.height) +
+							  " --resources \"" + params.resources + "\"" +
+							  " --out \"" + output + "\"";
+
+		printf("Running %s...\n", name);
+		if (system(command.c_str()) != 0) {
+			printf("Scenario %s failed\n", name);
+			return false;
+		}
+
+		JsonValue report;
+		const JsonValue* scenarios = nullptr;
+		if (!loadJson(output, report) || !(scenarios = report.get("scenarios")) || scenarios->array.empty()) {
+			printf("Can't read %s\n", output.c_str());
+			return false;
+		}
+		results.push_back(scenarios->array[0]);
+		remove(output.c_str());
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv)) {
+		printHelp();
+		return 2;
+	}
+
+	std::vector<JsonValue> results;
+	if (params.scenario == "all") {
+		if (!runAllScenarios(argv[0], results))
+			return 3;
+	} else {
+		SgrErrCode resultSGRInit = sgr.initOffscreen(params.width, params.height);
+		if (resultSGRInit != sgrOK) {
+			printf("SGR init error %d\n", resultSGRInit);
+			return resultSGRInit;
+		}
+
+		SgrErrCode resultScene = createScene();
+		if (resultScene != sgrOK) {
+			printf("Scene creation error %d\n", resultScene);
+			sgr.destroy();
+			return resultScene;
+		}
+
+		if (params.scenario == "yuv_check")
+			results.push_back(runYuvCheck());
+		else
+			results.push_back(runScenario());
+		sgr.destroy();
+	}
+
+	JsonValue report = createReport(results);
+	if (!saveReport(report, params.out)) {
+		printf("Can't write %s\n", params.out.c_str());
+		return 3;
+	}
+
+	if (checkFailed)
+		return 1;
+
+	if (!params.compare.empty()) {
+		JsonValue baseline;
+		if (!loadJson(params.compare, baseline)) {
+			printf("Can't read baseline %s\n", params.compare.c_str());
+			return 3;
+		}
+		uint32_t regressions = compareReports(baseline, report);
+		printf("%u regression(s), threshold %.0f%%\n", regressions, params.threshold * 100.0);
+		if (regressions > 0)
+			return 1;
+	}
+
+	return 0;
+}
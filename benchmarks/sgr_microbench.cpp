@@ -0,0 +1,502 @@
+#include <SGR.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "BenchScene.h"
+
+// CPU microbenchmarks of SGR internal hot paths.
+//
+// By default scene data is registered directly in managers with null Vulkan handles, so lookups,
+// instance insertion, command building and descriptor writes are measured without device and driver.
+// Command replay needs real command buffers and runs only with --device (offscreen init).
+
+#ifndef SGR_BENCH_RESOURCES
+	#define SGR_BENCH_RESOURCES "Resources"
+#endif
+
+struct MicroBenchParams {
+	std::string filter;
+	std::string out;
+	std::string resources = SGR_BENCH_RESOURCES;
+	uint32_t repetitions = 3;
+	uint32_t maxInstances = 100000;
+	double minTime = 0.1; // seconds of one repetition
+	bool device = false;
+};
+
+MicroBenchParams params;
+
+SGR sgr;
+volatile uint64_t benchSink = 0; // results are accumulated here so calls are not optimized out
+
+// Time is counted only between resumeTiming and pauseTiming, benchmark setup is excluded.
+class BenchState {
+public:
+	BenchState(uint64_t iterations, uint32_t arg) : iterations(iterations), arg(arg) { ; }
+
+	const uint64_t iterations;
+	const uint32_t arg;
+	uint64_t itemsPerIteration = 1;
+
+	void resumeTiming() { start = SgrTime::now(); }
+	void pauseTiming() { elapsed += std::chrono::duration<double>(SgrTime::now() - start).count(); }
+	double getElapsed() { return elapsed; }
+
+private:
+	SgrTime_t start;
+	double elapsed = 0;
+};
+
+typedef void (*SgrBenchFunction)(BenchState& state);
+
+struct MicroBenchmark {
+	std::string name;
+	SgrBenchFunction function;
+	uint32_t arg;
+};
+
+struct MicroBenchResult {
+	std::string name;
+	uint64_t iterations;
+	double nsPerIteration;
+	double nsPerItem;
+};
+
+class SgrMicroBench {
+public:
+	static void findInstanceByName(BenchState& state);
+	static void getPipelineByName(BenchState& state);
+	static void addObjectInstance(BenchState& state);
+	static void buildDrawingCommands(BenchState& state);
+	static void createDescriptorSetWrites(BenchState& state);
+	static void createDynamicUniformMemory(BenchState& state);
+	static void executeCommands(BenchState& state);
+
+	static void initFakeDevice();
+	static void addFakeInstances(uint32_t count);
+	static SgrErrCode initDeviceScene();
+
+private:
+	static const uint32_t geometriesCount = 64;
+	static const uint32_t fakeBuffersCount = 3;
+	static SgrBuffer fakeBuffer;
+	static uint32_t fakeInstancesCount;
+};
+
+SgrBuffer SgrMicroBench::fakeBuffer{};
+uint32_t SgrMicroBench::fakeInstancesCount = 0;
+
+//----------------------------------------------------------------------------- scene
+
+// geometries, pipelines and descriptor infos without device objects
+void SgrMicroBench::initFakeDevice()
+{
+	PhysicalDeviceManager::instance->pickedPhysicalDevice.props.limits.minUniformBufferOffsetAlignment = 256;
+
+	CommandManager* commandManager = CommandManager::instance;
+	commandManager->commandBuffers.assign(fakeBuffersCount, VK_NULL_HANDLE);
+	commandManager->commands.resize(fakeBuffersCount);
+
+	PipelineManager* pipelineManager = PipelineManager::instance;
+	DescriptorManager* descriptorManager = DescriptorManager::instance;
+	for (uint32_t i = 0; i < geometriesCount; i++) {
+		SGR::SgrObject object;
+		object.name = "geometry" + std::to_string(i);
+		object.vertices = &fakeBuffer;
+		object.indices = &fakeBuffer;
+		object.indicesCount = 6;
+		sgr.objects.push_back(object);
+
+		PipelineManager::SgrPipeline* pipeline = new PipelineManager::SgrPipeline;
+		pipeline->name = object.name;
+		pipeline->renderState = pipelineManager->getPipelineKeyState(object.renderState);
+		pipeline->ready = true;
+		pipelineManager->pipelines.push_back(pipeline);
+
+		DescriptorManager::SgrDescriptorInfo descriptorInfo;
+		descriptorInfo.name = object.name;
+		descriptorInfo.setLayoutBinding = createDescriptorSetLayoutBinding();
+		descriptorManager->descriptorInfos.push_back(descriptorInfo);
+	}
+}
+
+// grows scene up to count instances, instances of one geometry are kept together as addObjectInstance does
+void SgrMicroBench::addFakeInstances(uint32_t count)
+{
+	if (fakeInstancesCount >= count)
+		return;
+
+	for (; fakeInstancesCount < count; fakeInstancesCount++) {
+		std::string name = "instance" + std::to_string(fakeInstancesCount);
+		sgr.addObjectInstance(name, "geometry" + std::to_string(fakeInstancesCount % geometriesCount), fakeInstancesCount * 256);
+
+		DescriptorManager::SgrDescriptorSets descriptorSets;
+		descriptorSets.name = name;
+		descriptorSets.descriptorPool = VK_NULL_HANDLE;
+		descriptorSets.descriptorSets.assign(fakeBuffersCount, VK_NULL_HANDLE);
+		DescriptorManager::instance->allDescriptorSets.push_back(descriptorSets);
+	}
+
+	// drawObject is not used, its lookups would make scene creation quadratic
+	for (auto& instance : sgr.instances)
+		instance.needToDraw = instance.name != "empty";
+}
+
+SgrErrCode SgrMicroBench::initDeviceScene()
+{
+	SgrErrCode result = sgr.initOffscreen(256, 256);
+	if (result != sgrOK)
+		return result;
+
+	SgrBuffer* uboBuffer = nullptr;
+	result = MemoryManager::get()->createUniformBuffer(uboBuffer, sizeof(SgrGlobalUniformBufferObject));
+	if (result != sgrOK)
+		return result;
+	sgr.setupGlobalUniformBufferObject(uboBuffer);
+
+	SgrInstancesUniformBufferObject instancesData;
+	instancesData.instnaceCount = 1;
+	instancesData.instanceSize = sizeof(InstanceData);
+	result = MemoryManager::createDynamicUniformMemory(instancesData);
+	if (result != sgrOK)
+		return result;
+
+	SgrBuffer* instanceUBO = nullptr;
+	result = MemoryManager::get()->createDynamicUniformBuffer(instanceUBO, instancesData.dataSize, instancesData.dynamicAlignment);
+	if (result != sgrOK)
+		return result;
+	sgr.setupInstancesUniformBufferObject(instanceUBO);
+
+	SgrImage* texture = nullptr;
+	result = createCheckerTexture(0, 64, texture);
+	if (result != sgrOK)
+		return result;
+
+	std::vector<SgrVertex> vertices;
+	std::vector<uint16_t> indices;
+	createPolygon(1, vertices, indices);
+
+	std::shared_future<SgrErrCode> pipelineReady;
+	result = sgr.addNewObjectGeometry("quad", vertices, indices, params.resources + "/shaders/vertInstanceSh.spv", params.resources + "/shaders/fragTextureSh.spv",
+									  true, createBindingDescr(), createAttrDescr(), createDescriptorSetLayoutBinding(), &pipelineReady);
+	if (result != sgrOK)
+		return result;
+	result = pipelineReady.get();
+	if (result != sgrOK)
+		return result;
+
+	result = sgr.addObjectInstance("quad0", "quad", 0);
+	if (result != sgrOK)
+		return result;
+
+	result = sgr.writeDescriptorSets("quad0", { (void*)uboBuffer, (void*)texture, (void*)instanceUBO });
+	if (result != sgrOK)
+		return result;
+
+	result = sgr.drawObject("quad0");
+	if (result != sgrOK)
+		return result;
+
+	// first frame applies pended descriptor updates
+	result = sgr.drawFrame();
+	if (result != sgrOK)
+		return result;
+
+	vkDeviceWaitIdle(LogicalDeviceManager::instance->logicalDevice);
+	return sgrOK;
+}
+
+//----------------------------------------------------------------------------- benchmarks
+
+void SgrMicroBench::findInstanceByName(BenchState& state)
+{
+	addFakeInstances(state.arg);
+
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < 64; i++)
+		names.push_back("instance" + std::to_string((i * 7919u) % state.arg));
+
+	state.resumeTiming();
+	for (uint64_t i = 0; i < state.iterations; i++)
+		benchSink += sgr.findInstanceByName(names[i % names.size()]).uboDataAlignment;
+	state.pauseTiming();
+}
+
+void SgrMicroBench::getPipelineByName(BenchState& state)
+{
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < geometriesCount; i++)
+		names.push_back("geometry" + std::to_string((i * 37u) % geometriesCount));
+
+	PipelineManager* pipelineManager = PipelineManager::instance;
+	state.resumeTiming();
+	for (uint64_t i = 0; i < state.iterations; i++)
+		benchSink += (uint64_t)pipelineManager->getPipelineByName(names[i % names.size()]);
+	state.pauseTiming();
+}
+
+void SgrMicroBench::addObjectInstance(BenchState& state)
+{
+	addFakeInstances(state.arg);
+
+	for (uint64_t i = 0; i < state.iterations; i++) {
+		state.resumeTiming();
+		sgr.addObjectInstance("benchInstance", "geometry" + std::to_string(i % geometriesCount), 0);
+		state.pauseTiming();
+
+		auto inserted = std::find_if(sgr.instances.rbegin(), sgr.instances.rend(), [](const SGR::SgrObjectInstance& instance) { return instance.name == "benchInstance"; });
+		sgr.instances.erase(std::next(inserted).base());
+	}
+}
+
+void SgrMicroBench::buildDrawingCommands(BenchState& state)
+{
+	addFakeInstances(state.arg);
+	state.itemsPerIteration = state.arg;
+
+	CommandManager* commandManager = CommandManager::instance;
+	for (uint64_t i = 0; i < state.iterations; i++) {
+		commandManager->deleteCommands();
+		commandManager->commands.resize(commandManager->commandBuffers.size());
+		sgr.unbindAllMeshesAndPiplines();
+
+		state.resumeTiming();
+		benchSink += sgr.buildDrawingCommands();
+		state.pauseTiming();
+	}
+
+	commandManager->deleteCommands();
+	commandManager->commands.resize(commandManager->commandBuffers.size());
+}
+
+void SgrMicroBench::createDescriptorSetWrites(BenchState& state)
+{
+	DescriptorManager* descriptorManager = DescriptorManager::instance;
+	DescriptorManager::SgrDescriptorInfo descriptorInfo = descriptorManager->getDescriptorInfoByName("geometry0");
+	std::vector<VkDescriptorSet> descriptorSets(fakeBuffersCount, VK_NULL_HANDLE);
+
+	state.resumeTiming();
+	for (uint64_t i = 0; i < state.iterations; i++)
+		benchSink += descriptorManager->createDescriptorSetWrites(descriptorSets, descriptorInfo).size();
+	state.pauseTiming();
+}
+
+void SgrMicroBench::createDynamicUniformMemory(BenchState& state)
+{
+	for (uint64_t i = 0; i < state.iterations; i++) {
+		SgrInstancesUniformBufferObject instancesData;
+		instancesData.instnaceCount = state.arg;
+		instancesData.instanceSize = sizeof(InstanceData);
+
+		state.resumeTiming();
+		benchSink += MemoryManager::createDynamicUniformMemory(instancesData);
+		state.pauseTiming();
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+		_aligned_free(instancesData.data);
+#else
+		free(instancesData.data);
+#endif
+	}
+}
+
+// begin + replay of cached commands + end of all command buffers, arg 0 gives cost of begin and end only
+void SgrMicroBench::executeCommands(BenchState& state)
+{
+	CommandManager* commandManager = CommandManager::instance;
+	vkDeviceWaitIdle(LogicalDeviceManager::instance->logicalDevice);
+	commandManager->deleteCommands();
+	commandManager->commands.resize(commandManager->commandBuffers.size());
+
+	if (state.arg > 0) {
+		PipelineManager::SgrPipeline* pipeline = PipelineManager::instance->getPipelineByName("quad");
+		DescriptorManager::SgrDescriptorSets descriptorSets = DescriptorManager::instance->getDescriptorSetsByName("quad0");
+		SGR::SgrObject& object = sgr.findObjectByName("quad");
+
+		commandManager->bindPipeline(&pipeline->pipeline);
+		commandManager->bindVertexBuffer({ object.vertices->vkBuffer });
+		commandManager->bindIndexBuffer(object.indices->vkBuffer);
+		for (uint32_t i = 0; i < state.arg; i++) {
+			for (size_t j = 0; j < commandManager->commandBuffers.size(); j++)
+				commandManager->bindDescriptorSet(&pipeline->pipelineLayout, static_cast<uint8_t>(j), descriptorSets.descriptorSets[j], 0, 1, { 0 });
+			commandManager->drawIndexed(object.indicesCount, 1, 0, 0, 0);
+		}
+		state.itemsPerIteration = state.arg;
+	}
+
+	state.resumeTiming();
+	for (uint64_t i = 0; i < state.iterations; i++) {
+		benchSink += commandManager->beginCommandBuffers();
+		benchSink += commandManager->executeCommands();
+		benchSink += commandManager->endInitCommandBuffers();
+	}
+	state.pauseTiming();
+}
+
+//----------------------------------------------------------------------------- runner
+
+std::vector<MicroBenchmark> getBenchmarks()
+{
+	std::vector<MicroBenchmark> benchmarks;
+
+	if (params.device) {
+		for (uint32_t count : { 0u, 1000u, 10000u })
+			benchmarks.push_back({ "executeCommands/" + std::to_string(count), SgrMicroBench::executeCommands, count });
+		return benchmarks;
+	}
+
+	benchmarks.push_back({ "getPipelineByName/64", SgrMicroBench::getPipelineByName, 64 });
+	benchmarks.push_back({ "createDescriptorSetWrites", SgrMicroBench::createDescriptorSetWrites, 0 });
+
+	// scene only grows, so all benchmarks of one size are executed before next size
+	for (uint32_t count : { 1000u, 10000u, 100000u }) {
+		if (count > params.maxInstances)
+			break;
+		std::string suffix = "/" + std::to_string(count);
+		benchmarks.push_back({ "findInstanceByName" + suffix, SgrMicroBench::findInstanceByName, count });
+		benchmarks.push_back({ "addObjectInstance" + suffix, SgrMicroBench::addObjectInstance, count });
+		benchmarks.push_back({ "buildDrawingCommands" + suffix, SgrMicroBench::buildDrawingCommands, count });
+		benchmarks.push_back({ "createDynamicUniformMemory" + suffix, SgrMicroBench::createDynamicUniformMemory, count });
+	}
+
+	return benchmarks;
+}
+
+// iterations are increased until one repetition takes minTime, median of repetitions is reported
+MicroBenchResult runBenchmark(const MicroBenchmark& benchmark)
+{
+	uint64_t iterations = 1;
+	uint64_t items = 1;
+	std::vector<double> samples;
+
+	while (samples.size() < params.repetitions) {
+		BenchState state(iterations, benchmark.arg);
+		benchmark.function(state);
+
+		double elapsed = state.getElapsed();
+		if (samples.empty() && elapsed < params.minTime) {
+			double scale = elapsed > 0 ? params.minTime * 1.2 / elapsed : 100.0;
+			iterations = (uint64_t)(iterations * std::min(100.0, std::max(2.0, scale)));
+			continue;
+		}
+
+		samples.push_back(elapsed / iterations);
+		items = std::max<uint64_t>(1, state.itemsPerIteration);
+	}
+
+	std::sort(samples.begin(), samples.end());
+	double median = samples[samples.size() / 2] * 1e9;
+	return { benchmark.name, iterations, median, median / items };
+}
+
+bool saveResults(const std::vector<MicroBenchResult>& results)
+{
+	FILE* file = fopen(params.out.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		fprintf(file, "    { \"name\": \"%s\", \"iterations\": %llu, \"nsPerIteration\": %.3f, \"nsPerItem\": %.3f }%s\n",
+				results[i].name.c_str(), (unsigned long long)results[i].iterations, results[i].nsPerIteration, results[i].nsPerItem,
+				i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	fclose(file);
+	return true;
+}
+
+void printHelp()
+{
+	printf("sgr_microbench - CPU microbenchmarks of SGR internals\n\n");
+	printf("  --filter TEXT       run only benchmarks which name contains TEXT\n");
+	printf("  --min-time SEC      minimum time of one repetition (default %.2f)\n", params.minTime);
+	printf("  --repetitions N     repetitions, median is reported (default %u)\n", params.repetitions);
+	printf("  --max-instances N   largest scene size (default %u)\n", params.maxInstances);
+	printf("  --device            init offscreen device and run command replay benchmarks\n");
+	printf("  --resources PATH    folder with shaders for --device (default %s)\n", params.resources.c_str());
+	printf("  --out FILE          JSON output\n");
+}
+
+bool parseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printHelp();
+			exit(0);
+		}
+		if (arg == "--device") {
+			params.device = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			printf("Missing value for %s\n", arg.c_str());
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--filter")
+			params.filter = value;
+		else if (arg == "--min-time")
+			params.minTime = std::max(0.001, atof(value.c_str()));
+		else if (arg == "--repetitions")
+			params.repetitions = std::max(1, atoi(value.c_str()));
+		else if (arg == "--max-instances")
+			params.maxInstances = std::max(1, atoi(value.c_str()));
+		else if (arg == "--resources")
+			params.resources = value;
+		else if (arg == "--out")
+			params.out = value;
+		else {
+			printf("Unknown argument %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv)) {
+		printHelp();
+		return 2;
+	}
+
+	if (params.device) {
+		SgrErrCode result = SgrMicroBench::initDeviceScene();
+		if (result != sgrOK) {
+			printf("Device scene init error %d\n", result);
+			return result;
+		}
+	} else
+		SgrMicroBench::initFakeDevice();
+
+	std::vector<MicroBenchResult> results;
+	printf("%-34s %12s %16s %14s\n", "benchmark", "iterations", "ns/iteration", "ns/item");
+	for (auto& benchmark : getBenchmarks()) {
+		if (!params.filter.empty() && benchmark.name.find(params.filter) == std::string::npos)
+			continue;
+
+		MicroBenchResult result = runBenchmark(benchmark);
+		printf("%-34s %12llu %16.1f %14.1f\n", result.name.c_str(), (unsigned long long)result.iterations, result.nsPerIteration, result.nsPerItem);
+		fflush(stdout);
+		results.push_back(result);
+	}
+
+	// fake scene has no device objects to release
+	if (params.device)
+		sgr.destroy();
+
+	if (!params.out.empty() && !saveResults(results)) {
+		printf("Can't write %s\n", params.out.c_str());
+		return 3;
+	}
+
+	return 0;
+}
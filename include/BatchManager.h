@@ -0,0 +1,91 @@
+#pragma once
+
+#include "utils.h"
+#include "CaptureManager.h"
+
+#include <deque>
+#include <map>
+
+class SGR;
+
+// One small scene rendered into own tile of offscreen image. Job camera replaces global UBO in bindings
+// of job instances written with it, job instances data replaces instance UBO the same way.
+struct SgrRenderJob {
+	std::vector<std::string> instances;  // instances drawn in job tile
+	SgrGlobalUniformBufferObject scene;  // camera of job tile
+	SgrInstancesUniformBufferObject instancesData; // in order of instances with instance UBO alignment, instance UBO is used if data is not set
+	SgrCaptureCallback output = nullptr; // receives tile pixels, they are valid only during call
+	void* userData = nullptr;
+};
+
+struct SgrBatchStats {
+	uint64_t jobsCompleted = 0;
+	uint64_t batchesSubmitted = 0;
+	float renderTime = 0.f; // seconds spent in SGR::renderJobs
+	float jobsPerSecond = 0.f;
+};
+
+// Renders queued jobs as atlas tiles of offscreen image, many jobs per queue submission.
+// Batches are recorded into own command buffers, so recording of next batch and readback of previous one
+// overlap with GPU work of current batch. Job cameras and instances data are written into ranges of slot
+// buffers with own descriptor sets, so uploads of next batch never touch data read by current one.
+class BatchManager {
+	friend class SGR;
+
+public:
+	static BatchManager* get();
+
+	SgrBatchStats getStats();
+
+private:
+	BatchManager();
+	~BatchManager();
+	BatchManager(const BatchManager&) = delete;
+	BatchManager& operator=(const BatchManager&) = delete;
+
+	static BatchManager* instance;
+
+	struct SgrBatchDraw {
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		uint32_t dynamicOffset = 0;
+	};
+
+	struct SgrBatchSlot {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		SgrBuffer* readback = nullptr;
+		void* mapped = nullptr;
+		std::vector<SgrRenderJob> jobs;
+		bool submitted = false;
+
+		SgrBuffer* sceneBuffer = nullptr;	  // job cameras, one aligned range per tile
+		SgrBuffer* instancesBuffer = nullptr; // jobs instances data, one dynamic range per drawn instance
+		void* sceneMapped = nullptr;
+		void* instancesMapped = nullptr;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE; // batch sets, reset when slot is reused
+		std::map<VkDescriptorType, uint32_t> poolDescriptors;
+		uint32_t poolSets = 0;
+		std::vector<SgrBatchDraw> draws; // instances of all jobs in drawing order
+	};
+
+	std::deque<SgrRenderJob> queue;
+	std::vector<SgrBatchSlot> slots; // one slot for each offscreen image
+	uint32_t tileWidth = 0;
+	uint32_t tileHeight = 0;
+	SgrBatchStats stats;
+
+	SgrErrCode initSlots();
+	void destroySlots();
+	SgrErrCode setTileSize(uint32_t width, uint32_t height);
+	uint32_t getTilesPerBatch();
+
+	SgrErrCode renderJobs(SGR* sgr);
+	SgrErrCode recordBatch(SGR* sgr, uint32_t slotIndex);
+	SgrErrCode uploadBatchData(SGR* sgr, uint32_t slotIndex);
+	SgrErrCode prepareSlotBuffer(SgrBuffer*& buffer, void*& mapped, VkDeviceSize size);
+	SgrErrCode prepareDescriptorPool(SgrBatchSlot& slot, const std::map<VkDescriptorType, uint32_t>& descriptors, uint32_t sets);
+	SgrErrCode submitBatch(SgrBatchSlot& slot);
+	void completeBatch(SgrBatchSlot& slot);
+
+	void destroy();
+};
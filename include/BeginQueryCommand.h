@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Command.h"
+
+class BeginQueryCommand : Command {
+
+public:
+	BeginQueryCommand(VkQueryPool* _queryPool, uint32_t _query, VkQueryControlFlags _flags) :
+		queryPool(_queryPool),
+		query(_query),
+		flags(_flags)
+	{
+		type = CommandType::BEGIN_QUERY;
+	}
+
+private:
+	VkQueryPool* queryPool;
+	uint32_t query;
+	VkQueryControlFlags flags;
+
+	SgrErrCode execute(VkCommandBuffer* cmdBuffer) override {
+		vkCmdBeginQuery(*cmdBuffer, *queryPool, query, flags);
+		return sgrOK;
+	}
+};
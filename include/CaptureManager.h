@@ -0,0 +1,109 @@
+#pragma once
+
+#include "utils.h"
+#include "MemoryManager.h"
+
+class SGR;
+class CommandManager;
+
+enum SgrCaptureFormat {
+	SGR_CAPTURE_RGBA, // render target pixels as is (RGBA8 or BGRA8)
+	SGR_CAPTURE_I420, // Y plane, U plane, V plane with half resolution chroma
+	SGR_CAPTURE_NV12  // Y plane, interleaved UV plane with half resolution chroma
+};
+
+// Frame pixels read back from GPU. Pixels are valid only while capture callback is executing.
+struct SgrCapturedFrame {
+	uint64_t frameNumber;
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch; // bytes in one row of first plane
+	VkFormat format;   // R8G8B8A8 or B8G8R8A8 depending on render target
+	SgrCaptureFormat captureFormat;
+	const uint8_t* pixels; // YUV planes follow each other without padding
+	size_t dataSize;
+};
+
+typedef void (*SgrCaptureCallback)(const SgrCapturedFrame& frame, void* userData);
+
+// Ring of host visible buffers. Frame image is copied into free buffer at the end of frame commands,
+// buffer is handed to callback when frame fence is signaled, so readback adds no waits of its own. Frame
+// commands are still recorded after graphics queue is drained, so readback does not overlap next frames.
+class CaptureManager {
+	friend class SGR;
+	friend class CommandManager;
+
+public:
+	static CaptureManager* get();
+
+	uint64_t getDroppedFramesCount();
+	bool isGPUConversionUsed();
+
+	// CPU reference of rgba2yuv.comp, also used when compute conversion is not available
+	static void convertRGBAToYUV(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, SgrCaptureFormat format, uint8_t* yuv);
+	static size_t getCaptureDataSize(uint32_t width, uint32_t height, SgrCaptureFormat format);
+
+private:
+	CaptureManager();
+	~CaptureManager();
+	CaptureManager(const CaptureManager&) = delete;
+	CaptureManager& operator=(const CaptureManager&) = delete;
+
+	static CaptureManager* instance;
+
+	struct SgrCaptureSlot {
+		SgrBuffer* buffer = nullptr;        // host visible readback
+		SgrBuffer* sourceBuffer = nullptr;  // device local copy of image for compute conversion
+		VkDescriptorSet conversionSet = VK_NULL_HANDLE;
+		std::vector<uint8_t> convertedData; // CPU conversion result
+		void* mapped = nullptr;
+		bool busy = false;
+		bool gpuConverted = false;
+		uint64_t frameNumber = 0; // submitted frame which writes into this slot
+		uint32_t width = 0;
+		uint32_t height = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+	};
+
+	std::vector<SgrCaptureSlot> slots;
+	SgrCaptureCallback callback = nullptr;
+	void* callbackUserData = nullptr;
+	SgrCaptureFormat captureFormat = SGR_CAPTURE_RGBA;
+	bool capturing = false;
+	int32_t recordedSlot = -1; // slot used by currently recorded frame commands
+	uint64_t droppedFrames = 0;
+
+	// compute RGBA -> YUV conversion, shader is compiled from Resources/ShaderExamples/rgba2yuv.comp
+	struct SgrConversionParams {
+		uint32_t width;
+		uint32_t height;
+		uint32_t bgra;
+		uint32_t nv12;
+	};
+
+	std::string conversionShaderPath;
+	bool conversionReady = false;
+	VkShaderModule conversionShader = VK_NULL_HANDLE;
+	VkDescriptorSetLayout conversionSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool conversionPool = VK_NULL_HANDLE;
+	VkPipelineLayout conversionPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline conversionPipeline = VK_NULL_HANDLE;
+
+	SgrErrCode initConversion(uint32_t setsCount);
+	void destroyConversion();
+	bool isGPUConversionPossible(uint32_t width, uint32_t height);
+	void recordConversionCommands(VkCommandBuffer commandBuffer, SgrCaptureSlot& slot);
+
+	SgrErrCode start(SgrCaptureCallback captureCallback, void* userData, uint8_t slotCount, SgrCaptureFormat format);
+	SgrErrCode stop(uint64_t completedFrame);
+
+	SgrErrCode prepareFrame();
+	void recordCopyCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void frameSubmitted(uint64_t frameNumber);
+	void deliverCompletedFrames(uint64_t completedFrame);
+
+	SgrErrCode prepareSlotBuffer(SgrCaptureSlot& slot);
+	void destroySlotBuffers(SgrCaptureSlot& slot);
+	void destroySlots();
+	void destroy();
+};
@@ -11,7 +11,10 @@ enum CommandType {
 	BIND_INDEX_BUFFER,
 	DRAW_INDEXED,
 	BIND_DESCRIPTOR_SETS,
-	BIND_PIPELINE
+	BIND_PIPELINE,
+	SET_RENDER_STATE,
+	BEGIN_QUERY,
+	END_QUERY
 };
 
 class Command {
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "Command.h"
 #include "PipelineManager.h"
+#include "RenderStatistics.h"
 
 class SGR;
 class RenderPassManager;
@@ -10,6 +11,10 @@ class SwapChainManager;
 class MemoryManager;
 class TextureManager;
 class UIManager;
+class BatchManager;
+class QueryManager;
+class TextureLoader;
+class SgrMicroBench;
 
 class CommandManager {
 private:
@@ -19,6 +24,10 @@ private:
 	friend class MemoryManager;
 	friend class TextureManager;
 	friend class UIManager;
+	friend class BatchManager;
+	friend class QueryManager;
+	friend class TextureLoader;
+	friend class SgrMicroBench;
 
 	CommandManager();
 	~CommandManager();
@@ -41,6 +50,11 @@ private:
 
 	std::vector<std::vector<Command*>> commands; // for each command buffer we have commands set
 	SgrErrCode executeCommands();
+	void deleteCommands();
+	void countCommand(Command* cmd, SgrRenderStats& stats);
+	std::vector<SgrRenderStats> bufferStats; // draw and bind counters of last recording of each command buffer
+	uint32_t recordedBuffersCount = 0;       // since last submitted frame
+
 	void addCmdToBuffer(int16_t bufferIndex, Command* newCmd);
 	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance, int16_t cmdBufferIndex = -1);
 	void bindVertexBuffer(std::vector<VkBuffer> vertexBuffers, VkDeviceSize* offsets = nullptr, int16_t cmdBufferIndex = -1);
@@ -48,6 +62,9 @@ private:
 	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance, int16_t cmdBufferIndex = -1);
 	void bindDescriptorSet(VkPipelineLayout* pipelineLayout, uint8_t cmdBufferIndex, VkDescriptorSet descriptorSet, uint32_t firstSet, uint32_t descriptorSetCount, std::vector<uint32_t> dynamicOffsets = std::vector<uint32_t>{});
 	void bindPipeline(VkPipeline* sgrPipeline, int16_t cmdBufferIndex = -1);
+	void setRenderState(SgrRenderState renderState, int16_t cmdBufferIndex = -1);
+	void beginQuery(VkQueryPool* queryPool, uint32_t query, VkQueryControlFlags flags, int16_t cmdBufferIndex = -1);
+	void endQuery(VkQueryPool* queryPool, uint32_t query, int16_t cmdBufferIndex = -1);
 
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer cmdBuffer);
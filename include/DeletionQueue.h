@@ -0,0 +1,88 @@
+#pragma once
+
+#include "utils.h"
+#include "SwapChainManager.h"
+
+#include <mutex>
+
+class SGR;
+struct SgrBuffer;
+
+// Vulkan objects which can still be referenced by submitted frames. They are destroyed
+// when fences of all frames submitted before retirement are signaled.
+class DeletionQueue {
+	friend class SGR;
+
+public:
+	static DeletionQueue* get();
+
+	void retireBuffer(VkBuffer buffer);
+	void retireImage(VkImage image);
+	void retireImageView(VkImageView imageView);
+	void retireSampler(VkSampler sampler);
+	void retireMemory(VkDeviceMemory memory);
+	void retireFramebuffer(VkFramebuffer framebuffer);
+	void retireSwapChain(VkSwapchainKHR swapChain);
+	void retireDescriptorPool(VkDescriptorPool descriptorPool);
+	void retireDescriptorSetLayout(VkDescriptorSetLayout setLayout);
+	void retirePipeline(VkPipeline pipeline);
+	void retirePipelineLayout(VkPipelineLayout pipelineLayout);
+
+	// all handles of resource are retired, struct itself is deleted immediately
+	void retireSgrBuffer(SgrBuffer* buffer);
+	void retireSgrImage(SgrImage* image);
+
+	size_t getRetiredCount();
+
+private:
+	DeletionQueue();
+	~DeletionQueue();
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	static DeletionQueue* instance;
+
+	enum SgrRetiredType {
+		SGR_RETIRED_BUFFER,
+		SGR_RETIRED_IMAGE,
+		SGR_RETIRED_IMAGE_VIEW,
+		SGR_RETIRED_SAMPLER,
+		SGR_RETIRED_MEMORY,
+		SGR_RETIRED_FRAMEBUFFER,
+		SGR_RETIRED_SWAPCHAIN,
+		SGR_RETIRED_DESCRIPTOR_POOL,
+		SGR_RETIRED_DESCRIPTOR_SET_LAYOUT,
+		SGR_RETIRED_PIPELINE,
+		SGR_RETIRED_PIPELINE_LAYOUT
+	};
+
+	struct SgrRetiredObject {
+		uint64_t lastUsedFrame;
+		SgrRetiredType type;
+		union {
+			VkBuffer buffer;
+			VkImage image;
+			VkImageView imageView;
+			VkSampler sampler;
+			VkDeviceMemory memory;
+			VkFramebuffer framebuffer;
+			VkSwapchainKHR swapChain;
+			VkDescriptorPool descriptorPool;
+			VkDescriptorSetLayout setLayout;
+			VkPipeline pipeline;
+			VkPipelineLayout pipelineLayout;
+		};
+	};
+
+	// frame numbers only grow, so objects are ordered by lastUsedFrame
+	std::vector<SgrRetiredObject> retiredObjects;
+	std::mutex retiredObjectsMutex; // resources can be released from loader threads
+	uint64_t lastSubmittedFrame = 0;
+
+	void retire(SgrRetiredObject object);
+	void destroyObject(const SgrRetiredObject& object);
+
+	void frameSubmitted(uint64_t frameNumber);
+	void destroyCompleted(uint64_t completedFrame);
+	void destroy();
+};
@@ -3,14 +3,22 @@
 #include "utils.h"
 #include "SwapChainManager.h"
 
+#include <unordered_map>
+
 class SGR;
 class PipelineManager;
 class UIManager;
+class SgrMicroBench;
+class TextureStreamer;
+class BatchManager;
 
 class DescriptorManager {
 	friend class SGR;
 	friend class PipelineManager;
 	friend class UIManager;
+	friend class SgrMicroBench;
+	friend class TextureStreamer;
+	friend class BatchManager;
 
 private:
 	DescriptorManager();
@@ -33,23 +41,34 @@ private:
 		std::string name;
 		VkDescriptorPool descriptorPool;
 		std::vector<VkDescriptorSet> descriptorSets;
+		std::vector<void*> data; // per binding data the sets are written with
 	};
 
 	std::vector<SgrDescriptorSets> allDescriptorSets;
 
 	SgrErrCode addNewDescriptorInfo(SgrDescriptorInfo& descrInfo);
+	SgrErrCode removeDescriptorInfo(std::string name);
+	SgrErrCode destroyDescriptorSets(std::string name);
 	SgrErrCode updateDescriptorSets(std::string instanceName, std::string infoName, std::vector<void*> data, bool force = false);
 
 	const SgrDescriptorInfo getDescriptorInfoByName(std::string name);
 	const SgrDescriptorSets getDescriptorSetsByName(std::string name);
 
 	struct SgrDescriptorPended {
-		int idx;
 		std::string name;
 		std::string infoName;
 		std::vector<void*> data;
 	};
 	std::vector<SgrDescriptorPended> pendedDescriptorsUpdate;
+	std::vector<SgrDescriptorPended> placeholderDescriptors; // written with placeholder of texture which is still loading
+	bool isWaitingForTextures(const SgrDescriptorPended& descr);
+	void promoteLoadedTextures();
+
+	std::unordered_map<std::string, SgrDescriptorPended> streamedDescriptors; // written with streamed texture handles
+	void rewriteStreamedTextures();
+	void reportStreamedTexturesUsage(const std::string& name);
+	void forgetStreamedTexture(SgrImage* handle); // drops every pending write which references unregistered handle
+	uint32_t descriptorWritesCount = 0; // since last submitted frame
 
 	VkDescriptorPool uiDescriptorPool;
 	SgrErrCode createDescriptorPoolForUI();
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Command.h"
+
+class EndQueryCommand : Command {
+
+public:
+	EndQueryCommand(VkQueryPool* _queryPool, uint32_t _query) :
+		queryPool(_queryPool),
+		query(_query)
+	{
+		type = CommandType::END_QUERY;
+	}
+
+private:
+	VkQueryPool* queryPool;
+	uint32_t query;
+
+	SgrErrCode execute(VkCommandBuffer* cmdBuffer) override {
+		vkCmdEndQuery(*cmdBuffer, *queryPool, query);
+		return sgrOK;
+	}
+};
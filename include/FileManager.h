@@ -3,9 +3,15 @@
 #include "utils.h"
 
 class ShaderManager;
+class PipelineManager;
+class CaptureManager;
+class TextureContainer;
 
 class FileManager {
 	friend class ShaderManager;
+	friend class PipelineManager;
+	friend class CaptureManager;
+	friend class TextureContainer;
 
 private:
 	FileManager();
@@ -16,6 +22,8 @@ private:
 	static FileManager* instance;
 
 	static std::vector<char> readFile(const std::string filename);
+	static bool readFileIfExists(const std::string filename, std::vector<char>& data);
+	static bool writeFile(const std::string filename, const std::vector<char>& data);
 public:
 	static FileManager* get();
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "utils.h"
+
+// CPU time of frame phases in seconds
+struct SgrFrameTimings {
+	float update = 0.f;    // user data update callback
+	float recording = 0.f; // descriptor update and command buffers recording
+	float acquire = 0.f;   // waiting for frame fence and swapchain image
+	float submit = 0.f;
+	float present = 0.f;
+	float frameTime = 0.f; // whole drawFrame without fps pacing sleep
+	float interval = 0.f;  // time since previous frame start
+};
+
+struct SgrFramePercentiles {
+	float p50 = 0.f;
+	float p95 = 0.f;
+	float p99 = 0.f;
+	float max = 0.f;
+};
+
+struct SgrFrameStats {
+	uint32_t framesInWindow = 0;
+	uint64_t totalFrames = 0;
+	uint64_t missedDeadlines = 0; // frames with frame time longer than 1/fpsDesired since start
+	SgrFramePercentiles update;
+	SgrFramePercentiles recording;
+	SgrFramePercentiles acquire;
+	SgrFramePercentiles submit;
+	SgrFramePercentiles present;
+	SgrFramePercentiles frameTime;
+	SgrFramePercentiles interval;
+};
+
+// Rolling window of last frames timings. Percentiles are recalculated only when stats are requested after new frames.
+class SgrFrameStatistics {
+public:
+	SgrFrameStatistics(uint32_t windowSize = 300);
+
+	void setWindowSize(uint32_t windowSize);
+	void addFrame(const SgrFrameTimings& timings, float deadline);
+	const SgrFrameStats& getStats();
+	void reset();
+
+private:
+	std::vector<SgrFrameTimings> window; // ring buffer
+	uint32_t windowSize;
+	uint32_t nextFrame = 0;
+	uint64_t totalFrames = 0;
+	uint64_t missedDeadlines = 0;
+
+	SgrFrameStats stats;
+	bool statsOutdated = false;
+
+	SgrFramePercentiles calculatePercentiles(float SgrFrameTimings::* field, std::vector<float>& values);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "utils.h"
+#include "CaptureManager.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+
+// Streams have size of the first written frame, frames of other size (after resize) are dropped and counted.
+enum SgrFrameWriterFormat {
+	SGR_FRAME_WRITER_PNG, // one png file per frame: <path>_<frame number>.png, YUV captured frames are dropped
+	SGR_FRAME_WRITER_RAW, // tightly packed frames in captured format appended to one file
+	SGR_FRAME_WRITER_Y4M  // YUV4MPEG2 stream with I420 frames, fastest with SGR_CAPTURE_I420 capture
+};
+
+// Sink for captured frames. Pixels are copied on the render thread, conversion and file writing are done
+// on own background thread. Use with SGR::startCapture(SgrFrameWriter::captureCallback, &writer).
+class SgrFrameWriter {
+public:
+	SgrFrameWriter(SgrFrameWriterFormat format, std::string path, uint32_t fps = 60, uint32_t maxQueuedFrames = 8);
+	~SgrFrameWriter();
+
+	static void captureCallback(const SgrCapturedFrame& frame, void* userData);
+
+	// writes all queued frames and closes output
+	void finish();
+
+	uint64_t getWrittenFramesCount();
+	uint64_t getDroppedFramesCount();
+
+private:
+	struct SgrQueuedFrame {
+		uint64_t frameNumber;
+		uint32_t width;
+		uint32_t height;
+		bool bgra;
+		SgrCaptureFormat captureFormat;
+		std::vector<uint8_t> pixels;
+	};
+
+	SgrFrameWriterFormat format;
+	std::string path;
+	uint32_t fps;
+	uint32_t maxQueuedFrames;
+
+	std::ofstream stream;
+	bool streamHeaderWritten = false;
+	uint32_t streamWidth = 0;  // of the first written frame
+	uint32_t streamHeight = 0;
+	SgrCaptureFormat streamCaptureFormat = SGR_CAPTURE_RGBA;
+
+	std::thread writerThread;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<SgrQueuedFrame> queue;
+	bool finishing = false;
+
+	std::atomic<uint64_t> writtenFrames{ 0 };
+	std::atomic<uint64_t> droppedFrames{ 0 };
+
+	void push(const SgrCapturedFrame& frame);
+	void writerLoop();
+	void writeFrame(SgrQueuedFrame& frame);
+};
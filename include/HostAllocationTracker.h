@@ -0,0 +1,109 @@
+#pragma once
+
+#include "utils.h"
+
+#include <mutex>
+#include <deque>
+
+// host memory requested by driver for one VkSystemAllocationScope
+struct SgrHostAllocationScopeStats {
+	uint64_t liveBytes = 0;
+	uint64_t liveAllocations = 0;
+	uint64_t peakBytes = 0;
+	uint64_t totalAllocations = 0;
+	uint64_t internalBytes = 0; // driver internal allocations, reported by notifications only
+};
+
+struct SgrHostAllocationStats {
+	bool enabled = false;
+	SgrHostAllocationScopeStats scopes[VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1]; // indexed by VkSystemAllocationScope
+
+	uint64_t liveBytes = 0;
+	uint64_t liveAllocations = 0;
+	uint64_t peakBytes = 0;
+	uint64_t totalAllocations = 0;
+
+	// churn of last completed drawFrame
+	uint64_t frameNumber = 0;
+	uint32_t frameAllocations = 0;
+	uint32_t frameFrees = 0;
+	uint64_t frameBytesAllocated = 0;
+
+	uint64_t steadyStateAllocations = 0; // allocations and reallocations in frame loop after warmup frames
+};
+
+// allocation made in steady state frame loop
+struct SgrHostAllocationEvent {
+	uint64_t frameNumber = 0;
+	size_t size = 0;
+	size_t alignment = 0;
+	VkSystemAllocationScope scope = VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+	bool reallocation = false;
+};
+
+// Optional VkAllocationCallbacks installed on all SGR vkCreate and vkDestroy calls.
+// Must be enabled before SGR init - objects have to be destroyed with the same allocator they were created with.
+class HostAllocationTracker {
+public:
+	static HostAllocationTracker* get();
+
+	// allocator for Vulkan calls, nullptr when tracking is disabled
+	static const VkAllocationCallbacks* getAllocator() { return allocator; }
+
+	void enable(uint32_t warmupFrames);
+	bool isEnabled();
+
+	void beginFrame(uint64_t frameNumber);
+	void endFrame();
+
+	SgrHostAllocationStats getStats();
+	std::vector<SgrHostAllocationEvent> getSteadyStateEvents();
+	void clearSteadyStateEvents();
+
+	static const char* getScopeName(VkSystemAllocationScope scope);
+
+private:
+	HostAllocationTracker();
+	~HostAllocationTracker();
+	HostAllocationTracker(const HostAllocationTracker&) = delete;
+	HostAllocationTracker& operator=(const HostAllocationTracker&) = delete;
+
+	static HostAllocationTracker* instance;
+	static const VkAllocationCallbacks* allocator;
+
+	VkAllocationCallbacks callbacks{};
+	std::mutex statsMutex; // driver can allocate from any thread
+	SgrHostAllocationStats stats;
+	uint64_t totalFrees = 0;
+	uint64_t totalBytesAllocated = 0;
+
+	bool inFrame = false;
+	uint64_t currentFrame = 0;
+	uint32_t warmupFrames = 0;
+	uint64_t frameStartAllocations = 0;
+	uint64_t frameStartFrees = 0;
+	uint64_t frameStartBytes = 0;
+
+	const size_t eventsHistorySize = 256;
+	std::deque<SgrHostAllocationEvent> steadyStateEvents;
+
+	// header placed before every returned block, keeps size for frees and reallocations
+	struct SgrAllocationHeader {
+		size_t size;
+		size_t offset; // from start of system allocation to returned block
+		VkSystemAllocationScope scope;
+	};
+
+	void onAllocation(size_t size, size_t alignment, VkSystemAllocationScope scope, bool reallocation);
+	void onFree(size_t size, VkSystemAllocationScope scope);
+
+	static void* allocateBlock(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static SgrAllocationHeader* getHeader(void* memory);
+	static void freeBlock(void* memory);
+
+	static void* VKAPI_PTR allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static void* VKAPI_PTR reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static void VKAPI_PTR freeCallback(void* userData, void* memory);
+	static void VKAPI_PTR internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static void VKAPI_PTR internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+};
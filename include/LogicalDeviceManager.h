@@ -11,6 +11,11 @@ class CommandManager;
 class TextureManager;
 class RenderPassManager;
 class UIManager;
+class CaptureManager;
+class BatchManager;
+class QueryManager;
+class TextureLoader;
+class SgrMicroBench;
 
 class LogicalDeviceManager {
 	friend class SGR;
@@ -22,6 +27,11 @@ class LogicalDeviceManager {
 	friend class TextureManager;
 	friend class RenderPassManager;
 	friend class UIManager;
+	friend class CaptureManager;
+	friend class BatchManager;
+	friend class QueryManager;
+	friend class TextureLoader;
+	friend class SgrMicroBench;
 
 public:
 
@@ -2,9 +2,17 @@
 
 #include "utils.h"
 #include "SwapChainManager.h"
+#include "RenderStatistics.h"
+
+#include <mutex>
+#include <unordered_map>
 
 class SGR;
 class TextureManager;
+class CaptureManager;
+class BatchManager;
+class DeletionQueue;
+class TextureLoader;
 
 struct SgrBuffer {
 	VkBuffer vkBuffer;
@@ -13,10 +21,56 @@ struct SgrBuffer {
 	VkDeviceSize blockRange; // for dynamic uniform buffer
 };
 
+// kind of resource which owns device memory, derived from buffer and image usage flags
+enum SgrMemoryCategory {
+	SGR_MEMORY_VERTEX,
+	SGR_MEMORY_INDEX,
+	SGR_MEMORY_UNIFORM,
+	SGR_MEMORY_TEXTURE,
+	SGR_MEMORY_STAGING,
+	SGR_MEMORY_RENDER_TARGET,
+	SGR_MEMORY_READBACK,
+	SGR_MEMORY_OTHER,
+	SGR_MEMORY_CATEGORY_COUNT
+};
+
+struct SgrMemoryUsage {
+	uint32_t allocations = 0;
+	VkDeviceSize allocatedBytes = 0; // size of VkDeviceMemory objects
+	VkDeviceSize usedBytes = 0;		 // requested by resources, rest is alignment padding
+};
+
+struct SgrMemoryHeapStats {
+	VkDeviceSize size = 0;
+	bool deviceLocal = false;
+
+	SgrMemoryUsage usage;			// SGR allocations only
+	VkDeviceSize unusedBytes = 0;	// allocated but not used by resources
+	float fragmentation = 0.f;		// unusedBytes / allocatedBytes
+
+	VkDeviceSize budget = 0;		// VK_EXT_memory_budget, 80% of heap size otherwise
+	VkDeviceSize processUsage = 0;	// whole process by VK_EXT_memory_budget, SGR allocations otherwise
+	VkDeviceSize available = 0;		// budget - processUsage
+
+	SgrMemoryUsage categories[SGR_MEMORY_CATEGORY_COUNT];
+};
+
+struct SgrMemoryStats {
+	bool budgetSupported = false;
+	uint32_t allocationsLimit = 0; // maxMemoryAllocationCount of device
+	SgrMemoryUsage total;
+	SgrMemoryUsage categories[SGR_MEMORY_CATEGORY_COUNT];
+	std::vector<SgrMemoryHeapStats> heaps;
+};
+
 class MemoryManager {
 	friend class SGR;
 	friend class TextureManager;
 	friend class SwapChainManager;
+	friend class CaptureManager;
+	friend class BatchManager;
+	friend class DeletionQueue;
+	friend class TextureLoader;
 
 	MemoryManager();
 	~MemoryManager();
@@ -31,15 +85,32 @@ class MemoryManager {
 	SgrErrCode createBufferUsingStaging(SgrBuffer*& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, void* data);
 	void	   copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 	static void destroyBuffer(SgrBuffer* buffer);
+	void releaseBuffer(SgrBuffer* buffer); // destroyed when frames in flight are completed
 
 	SgrErrCode createVertexBuffer(SgrBuffer*& buffer, VkDeviceSize size, void* vertexData);
 	SgrErrCode createIndexBuffer(SgrBuffer*& buffer, VkDeviceSize size, void* indexData);
 
-	static void copyBufferToImage(SgrBuffer* buffer, SgrImage* image);
 	static void copyDataToBuffer(SgrBuffer* buffer, void* data);
 
 	std::vector<SgrBuffer*> allocatedBuffers;
 
+	static SgrRenderStats frameStats; // uploads and allocations since last submitted frame
+
+	// every SGR VkDeviceMemory, resources have dedicated allocations
+	struct SgrMemoryAllocation {
+		uint32_t typeIndex;
+		VkDeviceSize allocatedSize;
+		VkDeviceSize usedSize;
+		SgrMemoryCategory category;
+	};
+	std::unordered_map<VkDeviceMemory, SgrMemoryAllocation> memoryAllocations;
+	std::mutex memoryAllocationsMutex;
+
+	static SgrMemoryCategory getBufferCategory(VkBufferUsageFlags usage);
+	static SgrMemoryCategory getImageCategory(VkImageUsageFlags usage);
+	static void registerAllocation(VkDeviceMemory memory, uint32_t typeIndex, VkDeviceSize allocatedSize, VkDeviceSize usedSize, SgrMemoryCategory category);
+	static void unregisterAllocation(VkDeviceMemory memory);
+
 public:
 	static MemoryManager* get();
 	SgrErrCode createUniformBuffer(SgrBuffer*& buffer, VkDeviceSize size);
@@ -47,4 +118,7 @@ public:
 	SgrErrCode createDynamicUniformBuffer(SgrBuffer*& buffer, VkDeviceSize size, VkDeviceSize blockRange);
 
 	SgrErrCode destroyAllocatedBuffers();
+
+	SgrMemoryStats getMemoryStats();
+	static const char* getMemoryCategoryName(SgrMemoryCategory category);
 };
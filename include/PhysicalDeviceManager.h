@@ -7,6 +7,7 @@ class SwapChainManager;
 class MemoryManager;
 class TextureManager;
 class UIManager;
+class SgrMicroBench;
 
 struct SgrPhysicalDevice {
 	VkPhysicalDevice vkPhysDevice;
@@ -17,6 +18,13 @@ struct SgrPhysicalDevice {
 	std::optional<uint8_t> fixedPresentQueue; // fixed index of queue with present support
 	VkPhysicalDeviceProperties props;
 
+	// extended dynamic state support, filled for picked device
+	bool extendedDynamicState = false;
+	bool extendedDynamicState3PolygonMode = false;
+	bool dynamicPrimitiveTopologyUnrestricted = false;
+
+	bool memoryBudget = false; // VK_EXT_memory_budget enabled
+
 	bool operator==(const SgrPhysicalDevice& comp) const
 	{
 		if (this->vkPhysDevice == comp.vkPhysDevice) {
@@ -33,6 +41,8 @@ private:
 	friend class MemoryManager;
 	friend class TextureManager;
 	friend class UIManager;
+	friend class SgrMicroBench;
+	friend class BatchManager;
 
 	static PhysicalDeviceManager* instance;
 
@@ -47,6 +57,7 @@ private:
 	bool isSupportRequiredExtentions(SgrPhysicalDevice sgrDevice, std::vector<std::string> requiredExtensions);
 	bool isSupportAnySwapChainMode(SgrPhysicalDevice sgrDevice);
 	bool isSupportSamplerAnisotropy(SgrPhysicalDevice sgrDevice);
+	void setupExtendedDynamicStateSupport(SgrPhysicalDevice& sgrDevice, std::vector<std::string>& requiredExtensions);
 
 	SgrErrCode findPhysicalDeviceRequired(std::vector<VkQueueFlagBits> requiredQueues,
 										 std::vector<std::string> requiredExtensions,
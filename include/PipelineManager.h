@@ -4,24 +4,32 @@
 
 #include "ShaderManager.h"
 #include "DescriptorManager.h"
+#include "ThreadPool.h"
 
 class SGR;
 class CommandManager;
 class SwapChainManager;
 class BindDescriptorSetCommand;
+class SetRenderStateCommand;
+class SgrMicroBench;
 
 class PipelineManager {
 	friend class SGR;
 	friend class CommandManager;
 	friend class SwapChainManager;
 	friend class BindDescriptorSetCommand;
+	friend class SetRenderStateCommand;
+	friend class SgrMicroBench;
 
 public:
 	struct SgrPipeline {
 		std::string name = "empty";
 		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 		VkPipeline pipeline = VK_NULL_HANDLE;
-		bool filled;
+		SgrRenderState renderState; // only state which is not set dynamically
+		bool ready = false; // pipeline compiled and can be bound
+		bool failed = false; // compilation failed, draws using pipeline report error until it is retried
+		std::shared_future<SgrErrCode> compilation;
 	};
 
 	static PipelineManager* get();
@@ -35,11 +43,49 @@ private:
 
 	std::vector<SgrPipeline*> pipelines;
 
-	SgrErrCode createAndAddPipeline(std::string name, ShaderManager::SgrShader objectShaders, DescriptorManager::SgrDescriptorInfo descriptorInfo, bool filled);
+	// render state which can be set per draw with extended dynamic state extensions
+	struct SgrDynamicStateSupport {
+		bool extendedDynamicState = false; // cull mode, depth test and write, topology
+		bool polygonMode = false;
+		bool topologyUnrestricted = false; // topology can be changed to other topology class
+		PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+		PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+		PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+		PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+		PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode = nullptr;
+	};
+	SgrDynamicStateSupport dynamicStateSupport;
+
+	SgrErrCode initDynamicStateSupport();
+	SgrRenderState getPipelineKeyState(SgrRenderState state);
+	bool isRenderStateDynamic();
+	void cmdSetRenderState(VkCommandBuffer commandBuffer, SgrRenderState renderState);
+	SgrPipeline* getPipelineVariant(std::string name, SgrRenderState state);
+
+	// pipeline cache is seeded from disk on init and written back on destroy
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	std::string pipelineCacheDirectory;
+	const std::string pipelineCacheFileName = "sgr_pipeline_cache.bin";
+
+	SgrErrCode initPipelineCache();
+	SgrErrCode savePipelineCache();
+	void destroyPipelineCache();
+	bool isPipelineCacheDataValid(const std::vector<char>& cacheData);
+	std::string getPipelineCacheFilePath();
+
+	SgrErrCode createAndAddPipeline(std::string name, ShaderManager::SgrShader objectShaders, DescriptorManager::SgrDescriptorInfo descriptorInfo, SgrRenderState renderState,
+									std::shared_future<SgrErrCode>* compilation = nullptr);
+	std::shared_future<SgrErrCode> compilePipelineAsync(ShaderManager::SgrShader objectShaders,
+														DescriptorManager::SgrDescriptorInfo descriptorInfo,
+														SgrPipeline* sgrPipeline);
+	bool pollCompiledPipelines(); // true if some compilation finished, successfully or not
+	void retryPipeline(SgrPipeline* sgrPipeline);
+	void waitAllPipelines();
 	SgrErrCode createPipeline(ShaderManager::SgrShader objectShaders, 
 							  DescriptorManager::SgrDescriptorInfo descriptorInfo,
 							  SgrPipeline& sgrPipeline);
 	SgrErrCode destroyAllPipelines();
+	SgrErrCode destroyPipelines(std::string name); // all render state variants of geometry
 	SgrErrCode reinitAllPipelines();
 	SgrPipeline* getPipelineByName(std::string name);
 };
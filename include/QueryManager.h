@@ -0,0 +1,143 @@
+#pragma once
+
+#include "utils.h"
+
+#include <deque>
+#include <array>
+
+class SGR;
+class CommandManager;
+
+// points of frame command buffer where GPU timestamps are written
+enum SgrTimestamp {
+	SGR_TIMESTAMP_FRAME_BEGIN,
+	SGR_TIMESTAMP_SCENE_BEGIN,     // render pass begun, viewport set
+	SGR_TIMESTAMP_SCENE_END,       // scene draw commands executed
+	SGR_TIMESTAMP_UI_END,          // ImGui draw data recorded
+	SGR_TIMESTAMP_RENDER_PASS_END,
+	SGR_TIMESTAMP_FRAME_END,       // after frame capture copy
+	SGR_TIMESTAMP_COUNT
+};
+
+// GPU time of frame parts in seconds
+struct SgrGpuFrameTimings {
+	uint64_t frameNumber = 0;
+	float frame = 0.f;
+	float renderPass = 0.f;
+	float scene = 0.f;
+	float ui = 0.f;
+	float readback = 0.f; // capture copy and conversion after render pass
+	float uploads = 0.f;  // single time upload commands submitted since previous frame
+};
+
+// pipeline statistics and occlusion results of drawn instances
+struct SgrPipelineStats {
+	uint64_t inputVertices = 0;
+	uint64_t inputPrimitives = 0;
+	uint64_t vertexShaderInvocations = 0;
+	uint64_t clippingInvocations = 0;
+	uint64_t clippingPrimitives = 0;
+	uint64_t fragmentShaderInvocations = 0;
+	uint64_t samplesPassed = 0; // occlusion query
+
+	SgrPipelineStats& operator+=(const SgrPipelineStats& other)
+	{
+		inputVertices += other.inputVertices;
+		inputPrimitives += other.inputPrimitives;
+		vertexShaderInvocations += other.vertexShaderInvocations;
+		clippingInvocations += other.clippingInvocations;
+		clippingPrimitives += other.clippingPrimitives;
+		fragmentShaderInvocations += other.fragmentShaderInvocations;
+		samplesPassed += other.samplesPassed;
+		return *this;
+	}
+};
+
+struct SgrQueryGroupStats {
+	std::string group; // empty for instances without query group
+	SgrPipelineStats stats;
+};
+
+struct SgrFramePipelineStats {
+	uint64_t frameNumber = 0;
+	SgrPipelineStats total;
+	std::vector<SgrQueryGroupStats> groups;
+};
+
+// Timestamp queries of each frame command buffer are read when frame is already completed,
+// so resolving adds no waits for GPU of its own.
+class QueryManager {
+	friend class SGR;
+	friend class CommandManager;
+
+public:
+	static QueryManager* get();
+
+	bool isSupported();
+	bool isPipelineStatisticsSupported();
+
+private:
+	QueryManager();
+	~QueryManager();
+	QueryManager(const QueryManager&) = delete;
+	QueryManager& operator=(const QueryManager&) = delete;
+
+	static QueryManager* instance;
+
+	bool supported = false;
+	double timestampPeriod = 1.0; // nanoseconds in one tick
+	uint64_t timestampMask = ~0ULL;
+
+	VkQueryPool timestampPool = VK_NULL_HANDLE;
+	uint32_t buffersCount = 0;
+	std::vector<uint64_t> pendingFrames;  // frame submitted with each command buffer, 0 if none
+	std::vector<float> pendingUploads;
+
+	VkQueryPool uploadPool = VK_NULL_HANDLE;
+	float uploadTime = 0.f;
+
+	std::deque<SgrGpuFrameTimings> history;
+	const size_t historySize = 64;
+
+	// Draws are split into segments by query group of consecutive instances, each segment is covered
+	// by one pipeline statistics and one occlusion query. Queries of same type can not be nested,
+	// so frame totals are sums of segments.
+	static const uint32_t maxStatisticsSegments = 64;
+	static const uint32_t statisticsCount = 6;
+	bool statisticsSupported = false;
+	bool statisticsEnabled = false;
+	bool preciseOcclusion = false;
+	VkQueryPool statisticsPool = VK_NULL_HANDLE;
+	VkQueryPool occlusionPool = VK_NULL_HANDLE;
+	std::vector<std::string> segmentGroups; // group of each segment in recorded commands
+	std::deque<SgrFramePipelineStats> statisticsHistory;
+
+	SgrErrCode init();
+	SgrErrCode initFrameQueries(uint32_t commandBuffersCount);
+	void destroyFrameQueries();
+	void destroy();
+
+	void resetFrameQueries(VkCommandBuffer commandBuffer, uint32_t bufferIndex);
+	void writeTimestamp(VkCommandBuffer commandBuffer, uint32_t bufferIndex, SgrTimestamp timestamp);
+	void frameSubmitted(uint32_t bufferIndex, uint64_t frameNumber);
+	void resolveFrames();
+
+	SgrErrCode setStatisticsEnabled(bool enable);
+	SgrErrCode initStatisticsQueries();
+	void destroyStatisticsQueries();
+	void clearStatisticsSegments();
+	int32_t addStatisticsSegment(const std::string& group); // returns segment index, -1 if there are no more queries
+	void recordSegmentBegin(int32_t segment);
+	void recordSegmentEnd(int32_t segment);
+	void resolveStatistics(uint32_t bufferIndex, uint64_t frameNumber);
+
+	void beginUploadQueries(VkCommandBuffer commandBuffer);
+	void endUploadQueries(VkCommandBuffer commandBuffer);
+	void resolveUploadQueries();
+
+	float ticksToSeconds(uint64_t begin, uint64_t end);
+	bool getLastFrameTimings(SgrGpuFrameTimings& timings);
+	bool getFrameTimings(uint64_t frameNumber, SgrGpuFrameTimings& timings);
+	bool getLastPipelineStats(SgrFramePipelineStats& stats);
+	bool getPipelineStats(uint64_t frameNumber, SgrFramePipelineStats& stats);
+};
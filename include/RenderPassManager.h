@@ -7,6 +7,7 @@ class SwapChainManager;
 class CommandManager;
 class SGR;
 class UIManager;
+class BatchManager;
 
 class RenderPassManager {
 	friend class PipelineManager;
@@ -14,6 +15,7 @@ class RenderPassManager {
 	friend class CommandManager;
 	friend class SGR;
 	friend class UIManager;
+	friend class BatchManager;
 	
 private:
 	RenderPassManager();
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "utils.h"
+
+// Counters of one submitted frame. Draw and bind counters are taken from the submitted command buffer,
+// other counters are accumulated since previous submitted frame.
+struct SgrRenderStats {
+	uint64_t frameNumber = 0;
+
+	uint32_t drawCalls = 0;
+	uint64_t triangles = 0; // triangle list topology is assumed
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorSetBinds = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+
+	uint32_t descriptorUpdates = 0; // descriptor writes
+	uint64_t bytesUploaded = 0;     // host writes into buffer memory, staging included
+	uint32_t commandBuffersRecorded = 0;
+	uint32_t allocations = 0;       // device memory allocations
+
+	SgrRenderStats& operator+=(const SgrRenderStats& other)
+	{
+		drawCalls += other.drawCalls;
+		triangles += other.triangles;
+		pipelineBinds += other.pipelineBinds;
+		descriptorSetBinds += other.descriptorSetBinds;
+		vertexBufferBinds += other.vertexBufferBinds;
+		indexBufferBinds += other.indexBufferBinds;
+		descriptorUpdates += other.descriptorUpdates;
+		bytesUploaded += other.bytesUploaded;
+		commandBuffersRecorded += other.commandBuffersRecorded;
+		allocations += other.allocations;
+		return *this;
+	}
+};
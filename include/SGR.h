@@ -17,11 +17,25 @@
 #include "TextureManager.h"
 #include "RenderPassManager.h"
 #include "UserInterface.h"
-
-#define ON_SCREEN_RENDER true
+#include "ThreadPool.h"
+#include "CaptureManager.h"
+#include "FrameWriter.h"
+#include "BatchManager.h"
+#include "FrameStatistics.h"
+#include "QueryManager.h"
+#include "Trace.h"
+#include "RenderStatistics.h"
+#include "HostAllocationTracker.h"
+#include "DeletionQueue.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "TextureAtlas.h"
 
 #pragma pack(push, 1) // Disable padding
 class SGR {
+	friend class BatchManager;
+	friend class SgrMicroBench; // CPU microbenchmarks of internal paths
+
 public:
 	struct SgrObject {
 		std::string name;
@@ -29,6 +43,7 @@ public:
 		SgrBuffer* indices;
 		uint16_t indicesCount;
 		bool meshDataAndPiplineBinded = false;
+		SgrRenderState renderState;
 	};
 
 	struct SgrObjectInstance {
@@ -36,10 +51,12 @@ public:
 		std::string geometry;
 		uint32_t 	uboDataAlignment;
 		bool		needToDraw = false;
+		std::optional<SgrRenderState> renderState; // overrides geometry render state
+		std::string queryGroup;                    // pipeline statistics group
 	};
 
-	SgrBuffer* UBO;
-	SgrBuffer* dynamicUBO;
+	SgrBuffer* UBO = nullptr;
+	SgrBuffer* dynamicUBO = nullptr;
 
 	SGR(std::string appName = "Simple graphic application", uint8_t appVersionMajor = 1, uint8_t appVersionMinor = 0);
 	~SGR(); 
@@ -63,6 +80,22 @@ public:
 	 */
 	SgrErrCode init(uint32_t windowWidth = 0, uint32_t windowHeight = 0, const char *windowName = "");
 
+	/**
+	 * Init SGR without window, surface and swapchain. Frames are rendered into SGR owned images,
+	 * drawFrame and draw API are the same as for window mode.
+	 * 
+	 * \param width of render images
+	 * \param height of render images
+	 * \return 
+	 */
+	SgrErrCode initOffscreen(uint32_t width, uint32_t height);
+
+	/**
+	 * Change size of offscreen render target. Old images are destroyed when frames in flight are completed.
+	 */
+	SgrErrCode resizeOffscreen(uint32_t width, uint32_t height);
+	bool isOffscreen();
+
 	SgrErrCode destroy();
 
 	/**
@@ -79,13 +112,34 @@ public:
 
 	void setRequiredQueueFamilies(std::vector<VkQueueFlagBits> reqFam);
 
+	/**
+	 * Add new geometry. Pipeline for geometry is compiled in background, instances of this geometry
+	 * are not drawn until pipeline is ready.
+	 * 
+	 * \param pipelineReady optional handle to wait or check pipeline compilation result
+	 */
 	SgrErrCode addNewObjectGeometry(std::string name, std::vector<SgrVertex> vertices, std::vector<uint16_t> indices,
 									std::string shaderVert, std::string shaderFrag, bool filled,
 									std::vector<VkVertexInputBindingDescription> bindingDescriptions,
 									std::vector<VkVertexInputAttributeDescription> attributDescrtions,
-									std::vector<VkDescriptorSetLayoutBinding> setDescriptorSetsLayoutBinding);
+									std::vector<VkDescriptorSetLayoutBinding> setDescriptorSetsLayoutBinding,
+									std::shared_future<SgrErrCode>* pipelineReady = nullptr);
 
 	SgrErrCode addObjectInstance(std::string name, std::string geometry, uint32_t dynamicUBOalignment);
+
+	/**
+	 * Remove geometry or instance without device idle. Buffers, descriptor sets and pipelines are destroyed
+	 * when frames in flight are completed. Geometry can be removed only when all its instances are removed.
+	 */
+	SgrErrCode removeObjectGeometry(std::string name);
+	SgrErrCode removeObjectInstance(std::string name);
+
+	/**
+	 * Set polygon mode, cull mode, depth test/write and topology for all instances of geometry
+	 * or for one instance only.
+	 */
+	SgrErrCode setObjectRenderState(std::string geometry, SgrRenderState renderState);
+	SgrErrCode setInstanceRenderState(std::string instanceName, SgrRenderState renderState);
 	SgrErrCode writeDescriptorSets(std::string name, std::vector<void*> data);
 
 	SgrErrCode setupGlobalUniformBufferObject(SgrBuffer* uboBuffer);
@@ -103,11 +157,112 @@ public:
 
 	bool setFPSDesired(uint8_t fps);
 
+	/**
+	 * Frame timings percentiles over window of last frames. Missed deadline is frame with CPU frame time
+	 * longer than 1/fpsDesired. Percentiles are recalculated only once after new frames.
+	 */
+	const SgrFrameStats& getFrameStats();
+	void setFrameStatsWindow(uint32_t framesCount);
+	void resetFrameStats();
+
+	/**
+	 * Draw, bind, upload and allocation counters of last submitted frame.
+	 */
+	const SgrRenderStats& getRenderStats();
+
+	/**
+	 * Pipeline statistics (vertex, clipping, fragment invocations) and occlusion samples of scene draws.
+	 * Instances can be tagged by query group to get results of draw groups separately.
+	 * Results are read asynchronously with delay of few frames like GPU timings.
+	 */
+	SgrErrCode enablePipelineStatistics(bool enable);
+	SgrErrCode setInstanceQueryGroup(std::string instanceName, std::string group);
+	bool getLastPipelineStats(SgrFramePipelineStats& stats);
+	bool getPipelineStats(uint64_t frameNumber, SgrFramePipelineStats& stats);
+
+	/**
+	 * GPU timings of frames are read from timestamp queries when frame is already completed,
+	 * so latest timings are available with delay of few frames.
+	 * \param frameNumber number of submitted frame, timings are kept for last 64 frames
+	 */
+	bool isGpuTimingSupported();
+	bool getLastGpuFrameTimings(SgrGpuFrameTimings& timings);
+	bool getGpuFrameTimings(uint64_t frameNumber, SgrGpuFrameTimings& timings);
+
+	/**
+	 * Save recorded CPU trace events of all threads in Chrome trace JSON format.
+	 * Events are recorded only if SGR is built with SGR_ENABLE_TRACE option.
+	 * \param path output json file path
+	 */
+	SgrErrCode saveTrace(std::string path);
+	void setTraceEnabled(bool enable);
+
+	/**
+	 * Install VkAllocationCallbacks on all SGR Vulkan objects and count driver host memory per allocation scope.
+	 * Should be called before init. Allocations made inside drawFrame after warmup frames are reported as steady state events.
+	 * 
+	 * \param warmupFrames first frames which are expected to allocate (pipelines, descriptor updates)
+	 */
+	SgrErrCode enableHostAllocationTracking(uint32_t warmupFrames = 5);
+	SgrHostAllocationStats getHostAllocationStats();
+	std::vector<SgrHostAllocationEvent> getSteadyStateHostAllocations();
+
+	/**
+	 * Device memory of SGR resources per heap and per category (vertex, index, uniform, texture, staging...).
+	 * Heap budget and usage of whole process are reported by VK_EXT_memory_budget if device supports it,
+	 * otherwise budget is estimated as 80% of heap size.
+	 */
+	SgrMemoryStats getMemoryStats();
+
 	SgrErrCode getWindow(GLFWwindow* &ptr);
 	SgrErrCode setApplicationLogo(std::string path);
 
 	void enableDebugMode();
 
+	/**
+	 * Set directory where pipeline cache file will be stored between runs.
+	 * Should be called before init. Executable directory is used by default.
+	 * 
+	 * \param directory
+	 */
+	void setPipelineCacheDirectory(std::string directory);
+
+	/**
+	 * Start copying of every rendered frame into ring of host visible buffers. Callback is called from drawFrame
+	 * when frame is completed by GPU (next frame, because drawFrame drains graphics queue before recording).
+	 * If all buffers are still in use frame is dropped instead of waiting for them.
+	 * 
+	 * \param callback receives frame pixels, they are valid only during call
+	 * \param userData passed to callback as is, SgrFrameWriter can be used here with SgrFrameWriter::captureCallback
+	 * \param slotCount number of readback buffers
+	 * \param format YUV formats are converted by compute shader if it is set by setCaptureConversionShader, otherwise on CPU
+	 * \return 
+	 */
+	SgrErrCode startCapture(SgrCaptureCallback callback, void* userData = nullptr, uint8_t slotCount = 3, SgrCaptureFormat format = SGR_CAPTURE_RGBA);
+	SgrErrCode stopCapture();
+
+	/**
+	 * Set path to compiled Resources/ShaderExamples/rgba2yuv.comp. Should be called before startCapture.
+	 * 
+	 * \param spvPath
+	 */
+	void setCaptureConversionShader(std::string spvPath);
+
+	/**
+	 * Batch rendering for offscreen mode. Offscreen image is split into tiles of given size,
+	 * each queued job is drawn into own tile and tile pixels are passed to job output callback.
+	 * Every job has own camera and optionally own instances data, so the same instances can be drawn by many jobs.
+	 * Jobs instances data should not be changed until renderJobs returns.
+	 * 
+	 * \param tileWidth
+	 * \param tileHeight
+	 * \return 
+	 */
+	SgrErrCode setBatchTileSize(uint32_t tileWidth, uint32_t tileHeight);
+	SgrErrCode submitRenderJob(SgrRenderJob job);
+	SgrErrCode renderJobs(); // renders all queued jobs, returns when all outputs are called
+	SgrBatchStats getBatchStats();
+
 	SgrErrCode drawUIElement(SgrUIElement& uiElement);
 	void setupUICallback();
 
@@ -129,9 +284,12 @@ private:
 	bool manualWindow;
 	GLFWwindow* window = nullptr;
 
+	bool offscreen = false; // render without window into SGR owned images
+
 	bool commandsBuilded = false;
+	bool commandsOutdated = false; // command buffers were reallocated and need full rebuild
 
-	VkInstance vulkanInstance;
+	VkInstance vulkanInstance = VK_NULL_HANDLE;
 
 	std::vector<VkQueueFlagBits> requiredQueueFamilies;
 	std::vector<std::string> instanceRequiredExtensions;
@@ -147,6 +305,12 @@ private:
 	RenderPassManager* renderPassManager;
 	ShaderManager* shaderManager;
 	UIManager* uiManager;
+	CaptureManager* captureManager;
+	BatchManager* batchManager;
+	QueryManager* queryManager;
+	DeletionQueue* deletionQueue;
+	TextureLoader* textureLoader;
+	TextureStreamer* textureStreamer;
 
 	uint8_t maxFrameInFlight;
 	uint8_t currentFrame;
@@ -160,12 +324,35 @@ private:
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 	std::vector<VkFence> inFlightFences;
 	std::vector<VkFence> imagesInFlight;
+	std::vector<uint64_t> inFlightFrames; // number of frame submitted with each in flight fence
+
+	uint64_t submittedFrame = 0;
+	uint64_t getCompletedFrame();
+
+	bool frameDrawing = false;
+
+	SgrFrameStatistics frameStatistics;
+	SgrFrameTimings frameTimings; // timings of frame in progress
+	SgrTime_t lastFrameStartTime;
+	bool frameCounted = false;
+	void addFrameTimings(float frameTime);
+
+	SgrRenderStats renderStats; // of last submitted frame
+	void collectRenderStats(uint32_t imageIndex);
+	SgrErrCode renderFrame();
+	SgrErrCode renderOffscreenFrame();
+	SgrErrCode recordFrameCommands();
+
+	SgrErrCode initRenderTargets();
 
 	SgrErrCode initSyncObjects();
 
 	SgrErrCode initVulkanInstance();
 
 	SgrErrCode buildDrawingCommands(bool rebuild = false);
+	SgrErrCode recordInstanceDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex, std::string instanceName, PipelineManager::SgrPipeline*& boundPipeline,
+								  VkDescriptorSet descriptorSet = VK_NULL_HANDLE, uint32_t dynamicOffset = 0); // set and offset of batch draw replace instance ones
+	SgrErrCode recreateSwapChain();
 
 	// validation layer block
 	const std::vector<const char*> requiredValidationLayers = {"VK_LAYER_KHRONOS_validation"};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Command.h"
+#include "PipelineManager.h"
+
+class SetRenderStateCommand : Command {
+
+public:
+	SetRenderStateCommand(SgrRenderState _renderState) :
+		renderState(_renderState)
+	{
+		type = CommandType::SET_RENDER_STATE;
+	}
+
+private:
+	SgrRenderState renderState;
+
+	SgrErrCode execute(VkCommandBuffer* cmdBuffer) override {
+		PipelineManager::instance->cmdSetRenderState(*cmdBuffer, renderState);
+		return sgrOK;
+	}
+};
@@ -30,6 +30,7 @@ private:
 
 	SgrErrCode createShaders(std::string name, std::string vertexShaderPath, std::string fragmentShaderPath);
 	SgrErrCode destroyShaders(std::string name);
+	SgrErrCode removeShaders(std::string name);
 	SgrErrCode destroyAllShaders();
 	SgrShader getShadersByName(std::string name);
 
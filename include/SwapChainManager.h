@@ -8,6 +8,8 @@ class CommandManager;
 class DescriptorManager;
 class TextureManager;
 class WindowManager;
+class CaptureManager;
+class BatchManager;
 
 struct SgrSwapChainDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -31,6 +33,7 @@ struct SgrImage {
 	VkDeviceMemory memory;
 	VkImageView	view;
 	VkSampler sampler;
+	uint32_t mipLevels = 1;
 };
 
 struct AllocatedImageData {
@@ -45,6 +48,8 @@ class SwapChainManager {
 	friend class DescriptorManager;
 	friend class TextureManager;
 	friend class WindowManager;
+	friend class CaptureManager;
+	friend class BatchManager;
 
 public:
 	static SwapChainManager* get();
@@ -53,6 +58,7 @@ public:
 	VkExtent2D getExtent();
 	VkFormat getImageFormat();
 	SgrErrCode getDepthFormat(VkFormat& depthFormat);
+	bool isOffscreen();
 
 	SgrErrCode findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features, VkFormat& resFormat);
 
@@ -67,11 +73,13 @@ private:
 	void destroy(VkInstance instance);
 
 	void setSwapChainDeviceCapabilities(VkPhysicalDevice device);
-	SgrErrCode initSwapChain();
-	SgrErrCode cleanOldSwapChain();
+	SgrErrCode initSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	SgrErrCode reinitSwapChain();
 
-	VkSurfaceKHR surface;
+	// resources of replaced swapchain are passed to deletion queue, frames in flight can still use them
+	void retireSwapChain();
+
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 	VkSurfaceFormatKHR surfaceFormat;
 	VkPresentModeKHR presentMode;
 
@@ -80,11 +88,11 @@ private:
 	SgrErrCode createDepthResources();
 	void setupSwapChainProperties();
 
-	static SgrErrCode createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView);
+	static SgrErrCode createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView, uint32_t mipLevels = 1);
 	static SgrErrCode createImage(SgrImage*& image);
 	static SgrErrCode transitionImageLayout(SgrImage* image, VkImageLayout oldLayout, VkImageLayout newLayout);
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	SgrSwapChainDetails details;
 	uint32_t imageCount;
 	std::vector<VkImage> images;
@@ -96,6 +104,13 @@ private:
 
 	SgrErrCode initFrameBuffers();
 
+	// offscreen mode: SGR owned color images are used instead of swapchain images
+	bool offscreen = false;
+	const uint32_t offscreenImageCount = 2;
+	std::vector<SgrImage*> offscreenImages;
+	SgrErrCode initOffscreen(uint32_t width, uint32_t height);
+	SgrErrCode reinitOffscreen(uint32_t width, uint32_t height);
+
 	static std::vector<AllocatedImageData> createdImages;
 	static std::vector<VkImageView*> createdImageViews;
 };
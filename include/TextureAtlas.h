@@ -0,0 +1,72 @@
+#pragma once
+
+#include "utils.h"
+#include "SwapChainManager.h"
+
+#include <unordered_map>
+
+struct SgrAtlasSprite {
+	uint32_t page = 0;
+	glm::vec2 startText = glm::vec2(0.f, 0.f); // uv of left top corner
+	glm::vec2 endText = glm::vec2(0.f, 0.f);	  // uv of right bottom corner
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Packs many small RGBA images into few square atlas pages with skyline bottom-left packer. Sprites can be
+// inserted at any time, they are uploaded by flush(). Every sprite is surrounded by padding filled with its
+// edge texels, page has only mip levels which don't sample through padding into neighbour sprites.
+class SgrTextureAtlas {
+public:
+	SgrTextureAtlas(uint32_t pageSize = 2048, uint32_t padding = 4, bool mipmaps = true);
+	~SgrTextureAtlas();
+
+	// sprite with already added name is returned without insertion
+	SgrErrCode addSprite(std::string name, void* rgbaPixels, uint32_t width, uint32_t height, SgrAtlasSprite& sprite);
+	SgrErrCode addSpriteFromFile(std::string name, std::string path, SgrAtlasSprite& sprite);
+	bool getSprite(std::string name, SgrAtlasSprite& sprite);
+
+	// upload sprites added after previous flush, must be called from render thread before they are drawn
+	SgrErrCode flush();
+
+	uint32_t getPageCount();
+	SgrImage* getPageImage(uint32_t page); // nullptr before first flush of page
+
+	// startText and deltaText of instance data for sprite drawn on mesh rectangle from startMesh to endMesh
+	static void getInstanceTexCoords(const SgrAtlasSprite& sprite, glm::vec2 startMesh, glm::vec2 endMesh, glm::vec2& startText, glm::vec2& deltaText);
+
+	// release page textures, descriptor sets which use them must be rewritten or removed
+	void destroy();
+
+private:
+	struct SgrSkylineNode {
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	struct SgrAtlasPage {
+		std::vector<SgrSkylineNode> skyline; // top edge of packed area from left to right
+		std::vector<uint8_t> pixels;
+		SgrImage* image = nullptr;
+		bool dirty = false;
+		VkOffset2D dirtyMin = { 0, 0 };
+		VkOffset2D dirtyMax = { 0, 0 };
+	};
+
+	const uint32_t pageSize;
+	const uint32_t padding;
+	const bool mipmaps;
+
+	std::vector<SgrAtlasPage> pages;
+	std::unordered_map<std::string, SgrAtlasSprite> sprites;
+
+	void addPage();
+	bool findPosition(const SgrAtlasPage& page, uint32_t width, uint32_t height, size_t& nodeIndex, uint32_t& y);
+	bool fitsAtNode(const SgrAtlasPage& page, size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& y);
+	void insertNode(SgrAtlasPage& page, size_t nodeIndex, uint32_t width, uint32_t height, uint32_t y);
+	void copySprite(SgrAtlasPage& page, const uint8_t* rgbaPixels, uint32_t width, uint32_t height, uint32_t x, uint32_t y,
+					uint32_t cellWidth, uint32_t cellHeight);
+	uint32_t getPageLevels();
+	SgrErrCode uploadPage(SgrAtlasPage& page);
+};
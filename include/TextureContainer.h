@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils.h"
+
+struct SgrTextureLevel {
+	size_t offset; // into SgrTextureContainer::data
+	size_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Texture with stored mip chain read from KTX2 or DDS file. Level 0 is the largest one.
+struct SgrTextureContainer {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<SgrTextureLevel> levels;
+	std::vector<char> data; // whole file, levels point inside it
+};
+
+// Reader of pre-compressed texture files. Only 2D textures without array layers, faces and
+// KTX2 supercompression are accepted, pixel data is not transcoded.
+class TextureContainer {
+public:
+	static SgrErrCode read(const std::string& path, SgrTextureContainer& texture);
+
+	// block size in texels and bytes, false for formats which can't be loaded
+	static bool getFormatBlock(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes);
+
+private:
+	static SgrErrCode parseKtx2(SgrTextureContainer& texture);
+	static SgrErrCode parseDds(SgrTextureContainer& texture);
+	static VkFormat getDdsFormat(uint32_t fourCC, uint32_t dxgiFormat);
+};
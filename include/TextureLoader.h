@@ -0,0 +1,100 @@
+#pragma once
+
+#include "utils.h"
+#include "SwapChainManager.h"
+
+#include <mutex>
+#include <future>
+#include <unordered_map>
+
+class SGR;
+class TextureManager;
+class DescriptorManager;
+class TextureStreamer;
+struct SgrBuffer;
+
+enum SgrTextureState {
+	SGR_TEXTURE_READY,
+	SGR_TEXTURE_LOADING, // decoding on worker thread or waiting for upload fence
+	SGR_TEXTURE_FAILED   // file can't be decoded, placeholder is used forever
+};
+
+struct SgrTextureLoaderStats {
+	uint32_t loading = 0;	 // requested textures which are not ready yet
+	uint64_t loaded = 0;
+	uint64_t failed = 0;
+	uint64_t uploadBatches = 0; // queue submissions, many textures per submission
+	uint64_t bytesUploaded = 0;
+};
+
+// Textures are decoded by ThreadPool workers, decoded pixels are copied into staging buffers of upload slots
+// and uploaded by one submission per slot from render thread without waiting. Descriptor sets which use
+// texture before its upload fence is signaled get placeholder texture and are rewritten when it is ready.
+class TextureLoader {
+	friend class SGR;
+	friend class TextureManager;
+	friend class DescriptorManager;
+	friend class TextureStreamer;
+
+public:
+	static TextureLoader* get();
+
+	// maxSize limits bigger side of loaded texture, image is halved on worker thread until it fits
+	SgrErrCode loadTextureAsync(std::string path, SgrImage*& image, uint32_t maxSize = 0);
+	SgrTextureState getTextureState(SgrImage* image);
+	SgrErrCode waitAll(); // decode and upload all requested textures, render thread only
+
+	SgrTextureLoaderStats getStats();
+
+private:
+	TextureLoader();
+	~TextureLoader();
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	static TextureLoader* instance;
+
+	struct SgrDecodedTexture {
+		SgrImage* image = nullptr;
+		unsigned char* pixels = nullptr; // stbi allocated, nullptr if decoding failed
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	struct SgrUploadSlot {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		SgrBuffer* staging = nullptr;
+		void* mapped = nullptr;
+		std::vector<SgrImage*> images;
+		bool submitted = false;
+	};
+
+	const uint32_t uploadSlotCount = 2;
+	const VkDeviceSize stagingSize = 16 * 1024 * 1024; // grows for bigger textures
+	std::vector<SgrUploadSlot> slots;
+
+	SgrImage* placeholder = nullptr;
+
+	std::mutex texturesMutex; // states and decoded list are filled by workers
+	std::unordered_map<SgrImage*, SgrTextureState> textureStates; // ready textures are removed
+	std::vector<SgrDecodedTexture> decodedTextures;
+	std::vector<std::shared_future<void>> decodeJobs;
+	std::unordered_map<SgrImage*, VkExtent2D> sourceExtents; // file size of downscaled textures, until taken
+	SgrTextureLoaderStats stats;
+
+	static void downscale(SgrDecodedTexture& decoded, uint32_t maxSize);
+	bool takeSourceExtent(SgrImage* image, VkExtent2D& extent); // known once downscaled texture is decoded
+
+	bool isTextureReady(SgrImage* image);
+	SgrImage* getPlaceholder();
+
+	SgrErrCode initSlots();
+	SgrErrCode update();	// called every frame before descriptor updates
+	void completeUploads(bool wait);
+	SgrErrCode submitUploads();
+	SgrErrCode recordUpload(SgrUploadSlot& slot, VkDeviceSize offset, SgrDecodedTexture& decoded);
+	void setTextureState(SgrImage* image, SgrTextureState state);
+
+	void destroy();
+};
@@ -2,30 +2,107 @@
 
 #include "utils.h"
 #include "SwapChainManager.h"
+#include "TextureLoader.h"
+
+#include <map>
+#include <mutex>
 
 class SGR;
+class TextureLoader;
+class SgrTextureAtlas;
+
+// Sampler parameters, textures with equal parameters share one VkSampler
+struct SgrSamplerDesc {
+	VkFilter magFilter = VK_FILTER_LINEAR;
+	VkFilter minFilter = VK_FILTER_LINEAR;
+	VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	bool anisotropy = true; // ignored if device doesn't support it
+	float mipLodBias = 0.f;
+	float minLod = 0.f;
+	float maxLod = VK_LOD_CLAMP_NONE; // levels are limited by image view, so any mip count fits
+	VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+};
 
 class TextureManager {
 	friend class SGR;
+	friend class TextureLoader;
+	friend class SgrTextureAtlas;
+	friend class TextureStreamer;
 
 public:
 	static TextureManager* get();
 
 	static SgrErrCode createTextureImage(std::string image_path, SgrImage*& image);
 	static SgrErrCode createFontTextureImage(void* fontPixels, const uint32_t fontWidth, const uint32_t fontHeight, SgrImage*& image);
+	static SgrErrCode createTextureImageFromPixels(void* rgbaPixels, const uint32_t width, const uint32_t height, SgrImage*& image);
+
+	/**
+	 * Load block-compressed KTX2 or DDS texture with its stored mip chain. Paths are tried in order and first
+	 * file which format can be sampled by device is used, so one texture can be shipped as BC7, ASTC and ETC2 files.
+	 */
+	static SgrErrCode createCompressedTextureImage(const std::vector<std::string>& paths, SgrImage*& image);
+	static bool isTextureFormatSupported(VkFormat format);
+
+	/**
+	 * Decode file on worker thread and upload it without blocking. Image pointer is valid immediately,
+	 * descriptor sets written with it use placeholder texture until upload is completed.
+	 * Must be called after SGR init.
+	 */
+	static SgrErrCode loadTextureImageAsync(std::string image_path, SgrImage*& image);
+	static SgrTextureState getTextureState(SgrImage* image);
+	static SgrErrCode waitAsyncTextures();
+
+	/**
+	 * Release texture created by TextureManager. Texture is destroyed when frames in flight are completed,
+	 * descriptor sets which use it should be rewritten or removed before next frame.
+	 */
+	static SgrErrCode destroyTextureImage(SgrImage*& image);
+
+	/**
+	 * Shared sampler from cache, created on first request. Cached samplers live until SGR is destroyed.
+	 */
+	static SgrErrCode getSampler(const SgrSamplerDesc& desc, VkSampler& sampler);
+	static size_t getSamplerCount();
+
+	/**
+	 * Change filtering or addressing of texture, e.g. nearest filter for pixel art.
+	 * Descriptor sets written with texture before should be rewritten.
+	 */
+	static SgrErrCode setTextureSampler(SgrImage* image, const SgrSamplerDesc& desc);
 
 	static SgrErrCode destroyAllSamplers();
 
+	/**
+	 * Generate full mip chain on GPU for textures created after this call, synchronous and async ones.
+	 * Font texture never has mips. Disabled by default.
+	 */
+	static void setMipmapGeneration(bool enable);
+
 private:
 	static TextureManager* instance;
 	TextureManager();
 	TextureManager(const TextureManager&) = delete;
 	TextureManager& operator=(const TextureManager&) = delete;
 
-	static SgrErrCode createImage(void* pixels, const uint32_t width, const uint32_t height, VkFormat format , SgrImage*& image);
+	static SgrErrCode createImage(void* pixels, const uint32_t width, const uint32_t height, VkFormat format , SgrImage*& image, bool generateMipmaps);
+	static SgrErrCode initTextureImage(SgrImage* image, const uint32_t width, const uint32_t height, VkFormat format, bool generateMipmaps);
+	static void recordImageUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, SgrImage* image);
+	static void recordMipmapGeneration(VkCommandBuffer commandBuffer, SgrImage* image); // level 0 written, all levels in transfer dst layout
+	static void recordLevelsUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, const std::vector<VkBufferImageCopy>& regions, SgrImage* image);
+	static bool getMipmapBlitFilter(VkFormat format, VkFilter& filter);
+
+	// rewrites rectangle of level 0 of RGBA texture and regenerates its mips, previous content is kept when initialized
+	static SgrErrCode updateTextureRegion(SgrImage* image, void* rgbaPixels, VkOffset2D offset, VkExtent2D extent, bool initialized);
+
+	static bool mipmapGeneration;
 
-	static std::vector<VkSampler*> createdSamplers;
+	// whole VkSamplerCreateInfo except sType, pNext and flags
+	using SgrSamplerKey = std::array<uint32_t, 15>;
+	static SgrSamplerKey getSamplerKey(const VkSamplerCreateInfo& samplerInfo);
 
-protected:
-	static SgrErrCode createTextureSampler(VkSampler& sampler);
+	static std::map<SgrSamplerKey, VkSampler> samplerCache;
+	static std::mutex samplerCacheMutex;
 };
\ No newline at end of file
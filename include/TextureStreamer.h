@@ -0,0 +1,86 @@
+#pragma once
+
+#include "utils.h"
+#include "SwapChainManager.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+class SGR;
+class DescriptorManager;
+
+struct SgrTextureStreamerStats {
+	uint32_t registered = 0;
+	uint32_t resident = 0;		// textures with full resolution image uploaded
+	uint32_t loading = 0;		// full resolution images requested and not uploaded yet
+	uint64_t loads = 0;
+	uint64_t evictions = 0;
+	VkDeviceSize residentBytes = 0; // full resolution images, low resolution ones are always resident
+	VkDeviceSize loadingBytes = 0;	// estimated size of requested images, reserved in budget
+	VkDeviceSize budget = 0;
+};
+
+// Textures registered by path are referenced by handle image which owns no Vulkan objects. Descriptor sets
+// written with handle get its low resolution version, which is always resident, until full resolution image
+// is loaded by TextureLoader. Full resolution is requested when instance which uses texture is drawn, least
+// recently used ones are released when budget is exceeded. DescriptorManager rewrites sets of changed handles.
+// Render thread only.
+class TextureStreamer {
+	friend class SGR;
+	friend class DescriptorManager;
+
+public:
+	static TextureStreamer* get();
+
+	SgrErrCode registerTexture(std::string path, SgrImage*& handle);
+
+	/**
+	 * Release handle with its images. Descriptor sets written with handle must be rewritten or removed before
+	 * next frame, their pending rewrites are dropped.
+	 */
+	SgrErrCode unregisterTexture(SgrImage*& handle);
+
+	void setBudget(VkDeviceSize bytes);
+	void markUsed(SgrImage* handle); // usage which isn't visible from drawn instances, e.g. prefetch
+
+	SgrTextureStreamerStats getStats();
+
+private:
+	TextureStreamer();
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	static TextureStreamer* instance;
+
+	struct SgrStreamedTexture {
+		std::string path;
+		SgrImage* lowRes = nullptr;
+		SgrImage* fullRes = nullptr;
+		bool fullResident = false;
+		bool failed = false; // full resolution can't be loaded, low one is used forever
+		uint64_t lastUsedFrame = 0;
+		VkExtent2D fullExtent = { 0, 0 }; // known when low resolution version is decoded
+		VkDeviceSize loadingBytes = 0;	  // reserved for requested full resolution image
+	};
+
+	const uint32_t lowResSize = 64;
+	const uint32_t maxLoadingTextures = 8;
+	VkDeviceSize budget = 256 * 1024 * 1024;
+
+	std::unordered_map<SgrImage*, SgrStreamedTexture> textures; // by handle
+	std::unordered_set<SgrImage*> changedTextures; // resident version changed by last update
+	uint64_t currentFrame = 1;
+	SgrTextureStreamerStats stats;
+
+	bool hasTextures();
+	SgrImage* resolve(SgrImage* image);	// resident version of handle, other images are returned as is
+	bool isResidencyChanged(SgrImage* image);
+
+	SgrErrCode update(); // called every frame after TextureLoader update and before descriptor updates
+	void evictLeastRecentlyUsed(VkDeviceSize targetBytes); // until resident and loading bytes fit target
+	static VkDeviceSize getImageBytes(uint32_t width, uint32_t height, uint32_t mipLevels);
+	static VkDeviceSize getImageBytes(SgrImage* image);
+
+	void destroy();
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "utils.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <queue>
+#include <memory>
+
+class SGR;
+class PipelineManager;
+
+// Simple fixed size pool of worker threads for background jobs (pipeline compilation etc.)
+class ThreadPool {
+	friend class SGR;
+	friend class PipelineManager;
+
+public:
+	static ThreadPool* get();
+
+	template<typename F>
+	std::shared_future<std::invoke_result_t<F>> submit(F job)
+	{
+		using ResultType = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(job);
+		std::shared_future<ResultType> result = task->get_future().share();
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			jobs.push([task]() { (*task)(); });
+		}
+		queueCondition.notify_one();
+
+		return result;
+	}
+
+	uint32_t getWorkersCount();
+
+private:
+	ThreadPool();
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool* instance;
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+
+	void workerLoop();
+	void destroy();
+};
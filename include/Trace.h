@@ -0,0 +1,76 @@
+#pragma once
+
+#include "utils.h"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+
+// Scoped CPU trace markers. Compiled out completely unless SGR is built with SGR_ENABLE_TRACE option,
+// name must be string literal - only pointer is stored.
+#ifdef SGR_ENABLE_TRACE
+	#define SGR_TRACE_CONCAT_IMPL(a, b) a##b
+	#define SGR_TRACE_CONCAT(a, b) SGR_TRACE_CONCAT_IMPL(a, b)
+	#define SGR_TRACE_SCOPE(name) SgrTraceScope SGR_TRACE_CONCAT(sgrTraceScope, __LINE__)(name)
+#else
+	#define SGR_TRACE_SCOPE(name)
+#endif
+
+struct SgrTraceEvent {
+	const char* name = nullptr;
+	uint64_t begin = 0;    // nanoseconds since trace start
+	uint64_t duration = 0;
+};
+
+// Ring of last events of one thread. Only owner thread writes, so writing is lock-free,
+// reader drops events which could be overwritten while they were copied.
+struct SgrTraceBuffer {
+	std::vector<SgrTraceEvent> events;
+	std::atomic<uint64_t> written{0};
+	uint32_t threadIndex = 0;
+};
+
+class TraceManager {
+public:
+	static TraceManager* get();
+
+	static const uint32_t eventsPerThread = 16384;
+
+	bool isCompiled();
+	void setEnabled(bool enable);
+	bool isEnabled();
+
+	void addEvent(const char* name, SgrTime_t begin, SgrTime_t end);
+
+	// Chrome/Perfetto trace format, can be opened in chrome://tracing or ui.perfetto.dev
+	SgrErrCode saveChromeTrace(std::string path);
+	void clear();
+
+private:
+	TraceManager();
+	~TraceManager();
+	TraceManager(const TraceManager&) = delete;
+	TraceManager& operator=(const TraceManager&) = delete;
+
+	static TraceManager* instance;
+
+	std::atomic<bool> enabled{true};
+	SgrTime_t traceStart;
+	std::atomic<uint64_t> clearedAt{0};
+
+	// buffers are kept until process exit, so events of finished threads are still dumped
+	std::vector<std::unique_ptr<SgrTraceBuffer>> buffers;
+	std::mutex buffersMutex;
+
+	SgrTraceBuffer* getThreadBuffer();
+};
+
+class SgrTraceScope {
+public:
+	SgrTraceScope(const char* name) : name(name), begin(SgrTime::now()) { ; }
+	~SgrTraceScope() { TraceManager::get()->addEvent(name, begin, SgrTime::now()); }
+
+private:
+	const char* name;
+	SgrTime_t begin;
+};
@@ -57,6 +57,7 @@ public:
     SgrErrCode drawElement(SgrUIElement& element);
 
     void uiRender();
+    void setImageCount(uint8_t imageCount);
     void setupUICallback();
 private:
     static UIManager* _instance;
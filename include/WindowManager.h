@@ -44,7 +44,6 @@ private:
 
 	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 	static void windowPosCallback(GLFWwindow* window, int xpos, int ypos);
-	void requestUpdateSwapChain();
 
 	void destroy();
 
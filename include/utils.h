@@ -48,6 +48,23 @@ struct SgrInstancesUniformBufferObject {
 	size_t dataSize = 0;
 };
 
+// rasterization state of drawn geometry. Set dynamically per draw if device supports extended dynamic state,
+// otherwise separate pipeline variant is created for each used state
+struct SgrRenderState {
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+	bool depthTest = true;
+	bool depthWrite = true;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	bool operator==(const SgrRenderState& comp) const
+	{
+		return polygonMode == comp.polygonMode && cullMode == comp.cullMode &&
+			   depthTest == comp.depthTest && depthWrite == comp.depthWrite && topology == comp.topology;
+	}
+	bool operator!=(const SgrRenderState& comp) const { return !(*this == comp); }
+};
+
 enum SgrErrCode
 {
 	sgrOK,
@@ -111,7 +128,22 @@ enum SgrErrCode
 	sgrDebugMessengerDestructionFailed,
 	sgrDescriptorsSetsUpdated,
 	sgrDescriptorPoolCreateError,
-	sgrResetCommandBuffersError
+	sgrResetCommandBuffersError,
+	sgrInitPipelineCacheError,
+	sgrSavePipelineCacheError,
+	sgrInitOffscreenError,
+	sgrMapMemoryError,
+	sgrCaptureNotSupported,
+	sgrBatchRenderError,
+	sgrInitQueryPoolError,
+	sgrSaveTraceError,
+	sgrQueryNotSupported,
+	sgrHostAllocationTrackingError,
+	sgrGeometryInUse,
+	sgrTextureLoadInProgress,
+	sgrUnsupportedTextureContainer,
+	sgrTextureFormatNotSupported,
+	sgrAtlasSpriteTooLarge
 };
 
 #if __APPLE__
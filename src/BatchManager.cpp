@@ -0,0 +1,540 @@
+#include "BatchManager.h"
+#include "SGR.h"
+
+BatchManager* BatchManager::instance = nullptr;
+
+BatchManager::BatchManager() { ; }
+BatchManager::~BatchManager() { ; }
+
+BatchManager* BatchManager::get()
+{
+	if (instance == nullptr) {
+		instance = new BatchManager();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+SgrBatchStats BatchManager::getStats()
+{
+	return stats;
+}
+
+SgrErrCode BatchManager::setTileSize(uint32_t width, uint32_t height)
+{
+	VkExtent2D extent = SwapChainManager::get()->extent;
+	if (width == 0 || height == 0 || width > extent.width || height > extent.height)
+		return sgrBatchRenderError;
+
+	tileWidth = width;
+	tileHeight = height;
+
+	return sgrOK;
+}
+
+uint32_t BatchManager::getTilesPerBatch()
+{
+	VkExtent2D extent = SwapChainManager::get()->extent;
+	return (extent.width / tileWidth) * (extent.height / tileHeight);
+}
+
+SgrErrCode BatchManager::initSlots()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+
+	slots.resize(swapChainManager->imageCount);
+	for (auto& slot : slots) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = CommandManager::instance->commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS)
+			return sgrInitCommandBuffersError;
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(device, &fenceInfo, HostAllocationTracker::getAllocator(), &slot.fence) != VK_SUCCESS)
+			return sgrInitSyncObjectsError;
+
+		// whole atlas is read back, jobs get their tiles by row pitch
+		VkDeviceSize size = VkDeviceSize(swapChainManager->extent.width) * swapChainManager->extent.height * 4;
+		SgrErrCode resultCreateBuffer = MemoryManager::get()->createBuffer(slot.readback, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		if (resultCreateBuffer == sgrNoSuitableMemoryFinded)
+			resultCreateBuffer = MemoryManager::get()->createBuffer(slot.readback, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (resultCreateBuffer != sgrOK)
+			return resultCreateBuffer;
+
+		if (vkMapMemory(device, slot.readback->bufferMemory, 0, size, 0, &slot.mapped) != VK_SUCCESS)
+			return sgrMapMemoryError;
+	}
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::renderJobs(SGR* sgr)
+{
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	if (!swapChainManager->offscreen)
+		return sgrBatchRenderError;
+
+	if (tileWidth == 0 || tileHeight == 0) {
+		tileWidth = swapChainManager->extent.width;
+		tileHeight = swapChainManager->extent.height;
+	}
+
+	if (slots.empty()) {
+		SgrErrCode resultInit = initSlots();
+		if (resultInit != sgrOK)
+			return resultInit;
+	}
+
+	SgrTime_t startTime = SgrTime::now();
+
+	uint32_t tilesPerBatch = getTilesPerBatch();
+	uint32_t slotIndex = 0;
+	uint32_t idleSlots = 0;
+
+	// slots are used in ring order, while GPU renders one batch the next one is recorded
+	while (idleSlots < slots.size()) {
+		SgrBatchSlot& slot = slots[slotIndex];
+
+		if (slot.submitted) {
+			vkWaitForFences(LogicalDeviceManager::instance->logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+			completeBatch(slot);
+		}
+
+		if (queue.empty()) {
+			idleSlots++;
+		} else {
+			idleSlots = 0;
+			while (!queue.empty() && slot.jobs.size() < tilesPerBatch) {
+				slot.jobs.push_back(queue.front());
+				queue.pop_front();
+			}
+
+			SgrErrCode resultRecord = recordBatch(sgr, slotIndex);
+			if (resultRecord != sgrOK)
+				return resultRecord;
+
+			SgrErrCode resultSubmit = submitBatch(slot);
+			if (resultSubmit != sgrOK)
+				return resultSubmit;
+		}
+
+		slotIndex = (slotIndex + 1) % slots.size();
+	}
+
+	stats.renderTime += getTimeDuration(startTime, SgrTime::now());
+	if (stats.renderTime > 0.f)
+		stats.jobsPerSecond = stats.jobsCompleted / stats.renderTime;
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::recordBatch(SGR* sgr, uint32_t slotIndex)
+{
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	SgrBatchSlot& slot = slots[slotIndex];
+	VkCommandBuffer commandBuffer = slot.commandBuffer;
+
+	// previous batch of slot is completed, so its ranges and sets are reused while other slots render
+	SgrErrCode resultUpload = uploadBatchData(sgr, slotIndex);
+	if (resultUpload != sgrOK)
+		return resultUpload;
+
+	if (vkResetCommandBuffer(commandBuffer, 0) != VK_SUCCESS)
+		return sgrResetCommandBuffersError;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		return sgrBeginCommandBufferError;
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = RenderPassManager::get()->renderPass;
+	renderPassInfo.framebuffer = swapChainManager->framebuffers[slotIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainManager->extent;
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	clearValues[1].depthStencil = {1.0f, 0};
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	uint32_t columns = swapChainManager->extent.width / tileWidth;
+	PipelineManager::SgrPipeline* boundPipeline = nullptr;
+	size_t drawIndex = 0;
+
+	for (size_t job = 0; job < slot.jobs.size(); job++) {
+		VkRect2D tile{};
+		tile.offset = { int32_t((job % columns) * tileWidth), int32_t((job / columns) * tileHeight) };
+		tile.extent = { tileWidth, tileHeight };
+
+		// pipelines use dynamic viewport and scissor, so each job is drawn into own tile
+		VkViewport viewport{};
+		viewport.x = (float)tile.offset.x;
+		viewport.y = (float)tile.offset.y;
+		viewport.width = (float)tileWidth;
+		viewport.height = (float)tileHeight;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &tile);
+
+		for (auto& instanceName : slot.jobs[job].instances) {
+			SgrBatchDraw& draw = slot.draws[drawIndex++];
+			SgrErrCode resultDraw = sgr->recordInstanceDraw(commandBuffer, slotIndex, instanceName, boundPipeline, draw.descriptorSet, draw.dynamicOffset);
+			if (resultDraw != sgrOK)
+				return resultDraw;
+		}
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	// render pass leaves offscreen image in transfer source layout
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapChainManager->images[slotIndex];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swapChainManager->extent.width, swapChainManager->extent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, swapChainManager->images[slotIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						   slot.readback->vkBuffer, 1, &region);
+
+	VkBufferMemoryBarrier bufferBarrier{};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = slot.readback->vkBuffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+						 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		return sgrEndCommandBufferError;
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::uploadBatchData(SGR* sgr, uint32_t slotIndex)
+{
+	SGR_TRACE_SCOPE("BatchManager::uploadBatchData");
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	DescriptorManager* descriptorManager = DescriptorManager::get();
+	SgrBatchSlot& slot = slots[slotIndex];
+
+	// camera is bound to non dynamic binding, so every tile range is aligned as descriptor offset
+	VkDeviceSize minUboAlignment = PhysicalDeviceManager::instance->pickedPhysicalDevice.props.limits.minUniformBufferOffsetAlignment;
+	VkDeviceSize sceneStride = sizeof(SgrGlobalUniformBufferObject);
+	if (minUboAlignment > 0)
+		sceneStride = (sceneStride + minUboAlignment - 1) / minUboAlignment * minUboAlignment;
+	VkDeviceSize instanceStride = sgr->dynamicUBO != nullptr ? sgr->dynamicUBO->blockRange : 0;
+
+	struct SgrBatchSource {
+		VkDescriptorSet descriptorSet;
+		std::vector<void*> data;	// bindings data of instance sets
+		const DescriptorManager::SgrDescriptorInfo* info;
+		size_t job;
+		size_t instanceIndex;	// in job instances
+		uint32_t dynamicOffset; // in instance UBO
+		int64_t dataIndex;		// range in instances buffer, -1 if instance UBO is used
+	};
+
+	// descriptor infos are copied by getter, so they are taken once per geometry
+	std::unordered_map<std::string, DescriptorManager::SgrDescriptorInfo> infos;
+	std::vector<SgrBatchSource> sources;
+	std::map<VkDescriptorType, uint32_t> descriptors;
+	int64_t dataCount = 0;
+
+	for (size_t job = 0; job < slot.jobs.size(); job++) {
+		const SgrRenderJob& renderJob = slot.jobs[job];
+		for (size_t instanceIndex = 0; instanceIndex < renderJob.instances.size(); instanceIndex++) {
+			SGR::SgrObjectInstance& instance = sgr->findInstanceByName(renderJob.instances[instanceIndex]);
+			if (instance.name == "empty")
+				return sgrMissingInstance;
+
+			DescriptorManager::SgrDescriptorSets descrSets = descriptorManager->getDescriptorSetsByName(instance.name);
+			if (descrSets.name == "empty")
+				return sgrMissingDescriptorSets;
+
+			auto info = infos.find(instance.geometry);
+			if (info == infos.end()) {
+				info = infos.insert({ instance.geometry, descriptorManager->getDescriptorInfoByName(instance.geometry) }).first;
+				if (info->second.name == "empty")
+					return sgrMissingDescriptorSets;
+			}
+
+			for (auto& binding : info->second.setLayoutBinding)
+				descriptors[binding.descriptorType] += binding.descriptorCount;
+
+			bool ownData = renderJob.instancesData.data != nullptr;
+			sources.push_back({ descrSets.descriptorSets[slotIndex], descrSets.data, &info->second, job, instanceIndex, instance.uboDataAlignment, ownData ? dataCount++ : -1 });
+		}
+	}
+
+	SgrErrCode resultPrepare = prepareSlotBuffer(slot.sceneBuffer, slot.sceneMapped, std::max<VkDeviceSize>(slot.jobs.size(), 1) * sceneStride);
+	if (resultPrepare != sgrOK)
+		return resultPrepare;
+	if (dataCount > 0) {
+		resultPrepare = prepareSlotBuffer(slot.instancesBuffer, slot.instancesMapped, dataCount * instanceStride);
+		if (resultPrepare != sgrOK)
+			return resultPrepare;
+	}
+	resultPrepare = prepareDescriptorPool(slot, descriptors, static_cast<uint32_t>(sources.size()));
+	if (resultPrepare != sgrOK)
+		return resultPrepare;
+
+	for (size_t job = 0; job < slot.jobs.size(); job++)
+		memcpy((uint8_t*)slot.sceneMapped + job * sceneStride, &slot.jobs[job].scene, sizeof(SgrGlobalUniformBufferObject));
+
+	slot.draws.assign(sources.size(), SgrBatchDraw());
+	if (sources.empty())
+		return sgrOK;
+
+	std::vector<VkDescriptorSetLayout> layouts;
+	for (auto& source : sources)
+		layouts.push_back(source.info->setLayouts[slotIndex]);
+
+	std::vector<VkDescriptorSet> descriptorSets(sources.size());
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = slot.descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+		return sgrInitDescriptorSetsError;
+
+	// writes are applied before copies, so redirected bindings are only written and others only copied
+	std::deque<VkDescriptorBufferInfo> bufferInfos;
+	std::vector<VkWriteDescriptorSet> writes;
+	std::vector<VkCopyDescriptorSet> copies;
+	for (size_t i = 0; i < sources.size(); i++) {
+		SgrBatchSource& source = sources[i];
+
+		slot.draws[i].descriptorSet = descriptorSets[i];
+		slot.draws[i].dynamicOffset = source.dynamicOffset;
+		if (source.dataIndex >= 0) {
+			const SgrInstancesUniformBufferObject& instancesData = slot.jobs[source.job].instancesData;
+			slot.draws[i].dynamicOffset = static_cast<uint32_t>(source.dataIndex * instanceStride);
+			memcpy((uint8_t*)slot.instancesMapped + source.dataIndex * instanceStride,
+				   (const uint8_t*)instancesData.data + source.instanceIndex * instancesData.dynamicAlignment, instanceStride);
+		}
+
+		for (size_t k = 0; k < source.info->setLayoutBinding.size(); k++) {
+			const VkDescriptorSetLayoutBinding& binding = source.info->setLayoutBinding[k];
+			// only bindings written with global and instance UBOs are replaced, other uniform buffers belong to user
+			void* bindingData = k < source.data.size() ? source.data[k] : nullptr;
+			bool sceneBinding = binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && binding.descriptorCount == 1 &&
+								sgr->UBO != nullptr && bindingData == sgr->UBO;
+			bool dataBinding = binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && binding.descriptorCount == 1 &&
+							   source.dataIndex >= 0 && sgr->dynamicUBO != nullptr && bindingData == sgr->dynamicUBO;
+
+			if (!sceneBinding && !dataBinding) {
+				VkCopyDescriptorSet copy{};
+				copy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+				copy.srcSet = source.descriptorSet;
+				copy.srcBinding = binding.binding;
+				copy.dstSet = descriptorSets[i];
+				copy.dstBinding = binding.binding;
+				copy.descriptorCount = binding.descriptorCount;
+				copies.push_back(copy);
+				continue;
+			}
+
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = sceneBinding ? slot.sceneBuffer->vkBuffer : slot.instancesBuffer->vkBuffer;
+			bufferInfo.offset = sceneBinding ? source.job * sceneStride : 0;
+			bufferInfo.range = sceneBinding ? sizeof(SgrGlobalUniformBufferObject) : instanceStride;
+			bufferInfos.push_back(bufferInfo);
+
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = descriptorSets[i];
+			write.dstBinding = binding.binding;
+			write.dstArrayElement = 0;
+			write.descriptorType = binding.descriptorType;
+			write.descriptorCount = 1;
+			write.pBufferInfo = &bufferInfos.back();
+			writes.push_back(write);
+		}
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), static_cast<uint32_t>(copies.size()), copies.data());
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::prepareSlotBuffer(SgrBuffer*& buffer, void*& mapped, VkDeviceSize size)
+{
+	if (buffer != nullptr && buffer->size >= size)
+		return sgrOK;
+
+	// buffer only grows, it is used by completed batch of this slot only
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	if (buffer != nullptr) {
+		vkUnmapMemory(device, buffer->bufferMemory);
+		MemoryManager::destroyBuffer(buffer);
+		buffer = nullptr;
+		mapped = nullptr;
+	}
+
+	SgrErrCode resultCreateBuffer = MemoryManager::get()->createBuffer(buffer, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (resultCreateBuffer != sgrOK)
+		return resultCreateBuffer;
+
+	if (vkMapMemory(device, buffer->bufferMemory, 0, size, 0, &mapped) != VK_SUCCESS)
+		return sgrMapMemoryError;
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::prepareDescriptorPool(SgrBatchSlot& slot, const std::map<VkDescriptorType, uint32_t>& descriptors, uint32_t sets)
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	bool fits = slot.descriptorPool != VK_NULL_HANDLE && sets <= slot.poolSets;
+	for (auto& descriptor : descriptors)
+		fits = fits && descriptor.second <= slot.poolDescriptors[descriptor.first];
+
+	if (fits) {
+		vkResetDescriptorPool(device, slot.descriptorPool, 0);
+		return sgrOK;
+	}
+
+	if (slot.descriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(device, slot.descriptorPool, HostAllocationTracker::getAllocator());
+	slot.descriptorPool = VK_NULL_HANDLE;
+
+	// pool grows to largest batch, so it is recreated only few times
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (auto& descriptor : descriptors) {
+		uint32_t& capacity = slot.poolDescriptors[descriptor.first];
+		capacity = std::max(capacity, descriptor.second);
+	}
+	for (auto& descriptor : slot.poolDescriptors)
+		if (descriptor.second > 0)
+			poolSizes.push_back({ descriptor.first, descriptor.second });
+	slot.poolSets = std::max(std::max(slot.poolSets, sets), 1u);
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = slot.poolSets;
+	if (vkCreateDescriptorPool(device, &poolInfo, HostAllocationTracker::getAllocator(), &slot.descriptorPool) != VK_SUCCESS)
+		return sgrDescriptorPoolCreateError;
+
+	return sgrOK;
+}
+
+SgrErrCode BatchManager::submitBatch(SgrBatchSlot& slot)
+{
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+	vkResetFences(LogicalDeviceManager::instance->logicalDevice, 1, &slot.fence);
+	if (vkQueueSubmit(LogicalDeviceManager::instance->graphicsQueue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+		return sgrQueueSubmitFailed;
+
+	slot.submitted = true;
+	stats.batchesSubmitted++;
+
+	return sgrOK;
+}
+
+void BatchManager::completeBatch(SgrBatchSlot& slot)
+{
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	uint32_t atlasWidth = swapChainManager->extent.width;
+	uint32_t columns = atlasWidth / tileWidth;
+
+	for (size_t job = 0; job < slot.jobs.size(); job++) {
+		size_t tileX = (job % columns) * tileWidth;
+		size_t tileY = (job / columns) * tileHeight;
+
+		SgrCapturedFrame tile;
+		tile.frameNumber = stats.jobsCompleted;
+		tile.width = tileWidth;
+		tile.height = tileHeight;
+		tile.rowPitch = atlasWidth * 4;
+		tile.format = swapChainManager->imageFormat;
+		tile.captureFormat = SGR_CAPTURE_RGBA;
+		tile.pixels = (const uint8_t*)slot.mapped + (tileY * atlasWidth + tileX) * 4;
+		tile.dataSize = size_t(tile.rowPitch) * (tileHeight - 1) + size_t(tileWidth) * 4;
+
+		if (slot.jobs[job].output != nullptr)
+			slot.jobs[job].output(tile, slot.jobs[job].userData);
+
+		stats.jobsCompleted++;
+	}
+
+	slot.jobs.clear();
+	slot.submitted = false;
+}
+
+void BatchManager::destroySlots()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	for (auto& slot : slots) {
+		vkDestroyFence(device, slot.fence, HostAllocationTracker::getAllocator());
+		if (slot.readback != nullptr) {
+			vkUnmapMemory(device, slot.readback->bufferMemory);
+			MemoryManager::destroyBuffer(slot.readback);
+		}
+		for (SgrBuffer* buffer : { slot.sceneBuffer, slot.instancesBuffer }) {
+			if (buffer != nullptr) {
+				vkUnmapMemory(device, buffer->bufferMemory);
+				MemoryManager::destroyBuffer(buffer);
+			}
+		}
+		if (slot.descriptorPool != VK_NULL_HANDLE)
+			vkDestroyDescriptorPool(device, slot.descriptorPool, HostAllocationTracker::getAllocator());
+		vkFreeCommandBuffers(device, CommandManager::instance->commandPool, 1, &slot.commandBuffer);
+	}
+	slots.clear();
+}
+
+void BatchManager::destroy()
+{
+	destroySlots();
+	queue.clear();
+
+	delete instance;
+	instance = nullptr;
+}
@@ -0,0 +1,510 @@
+#include "CaptureManager.h"
+#include "LogicalDeviceManager.h"
+#include "SwapChainManager.h"
+#include "FileManager.h"
+#include "HostAllocationTracker.h"
+
+CaptureManager* CaptureManager::instance = nullptr;
+
+CaptureManager::CaptureManager() { ; }
+CaptureManager::~CaptureManager() { ; }
+
+CaptureManager* CaptureManager::get()
+{
+	if (instance == nullptr) {
+		instance = new CaptureManager();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+uint64_t CaptureManager::getDroppedFramesCount()
+{
+	return droppedFrames;
+}
+
+bool CaptureManager::isGPUConversionUsed()
+{
+	return conversionReady;
+}
+
+size_t CaptureManager::getCaptureDataSize(uint32_t width, uint32_t height, SgrCaptureFormat format)
+{
+	if (format == SGR_CAPTURE_RGBA)
+		return size_t(width) * height * 4;
+
+	size_t chromaSize = size_t((width + 1) / 2) * ((height + 1) / 2);
+	return size_t(width) * height + 2 * chromaSize;
+}
+
+void CaptureManager::convertRGBAToYUV(const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, SgrCaptureFormat format, uint8_t* yuv)
+{
+	auto toByte = [](float value) { return (uint8_t)std::min(255.f, std::max(0.f, value + 0.5f)); };
+	uint32_t red = bgra ? 2 : 0;
+	uint32_t blue = bgra ? 0 : 2;
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			const uint8_t* pixel = pixels + (size_t(y) * width + x) * 4;
+			yuv[size_t(y) * width + x] = toByte(0.299f * pixel[red] + 0.587f * pixel[1] + 0.114f * pixel[blue]);
+		}
+	}
+
+	// chroma is averaged over 2x2 block, edge pixels are repeated for odd sizes
+	uint32_t chromaWidth = (width + 1) / 2;
+	uint32_t chromaHeight = (height + 1) / 2;
+	size_t lumaSize = size_t(width) * height;
+	size_t chromaSize = size_t(chromaWidth) * chromaHeight;
+	for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+		for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+			float r = 0.f, g = 0.f, b = 0.f;
+			for (uint32_t dy = 0; dy < 2; dy++) {
+				for (uint32_t dx = 0; dx < 2; dx++) {
+					uint32_t px = std::min(cx * 2 + dx, width - 1);
+					uint32_t py = std::min(cy * 2 + dy, height - 1);
+					const uint8_t* pixel = pixels + (size_t(py) * width + px) * 4;
+					r += pixel[red];
+					g += pixel[1];
+					b += pixel[blue];
+				}
+			}
+			r /= 4.f;
+			g /= 4.f;
+			b /= 4.f;
+
+			uint8_t u = toByte(-0.168736f * r - 0.331264f * g + 0.5f * b + 128.f);
+			uint8_t v = toByte(0.5f * r - 0.418688f * g - 0.081312f * b + 128.f);
+			size_t chromaIndex = size_t(cy) * chromaWidth + cx;
+			if (format == SGR_CAPTURE_NV12) {
+				yuv[lumaSize + chromaIndex * 2] = u;
+				yuv[lumaSize + chromaIndex * 2 + 1] = v;
+			} else {
+				yuv[lumaSize + chromaIndex] = u;
+				yuv[lumaSize + chromaSize + chromaIndex] = v;
+			}
+		}
+	}
+}
+
+bool CaptureManager::isGPUConversionPossible(uint32_t width, uint32_t height)
+{
+	// shader writes whole 32 bit words of 8x2 pixel blocks
+	return conversionReady && width % 8 == 0 && height % 2 == 0;
+}
+
+SgrErrCode CaptureManager::initConversion(uint32_t setsCount)
+{
+	std::vector<char> shaderCode;
+	if (conversionShaderPath.empty() || !FileManager::readFileIfExists(conversionShaderPath, shaderCode))
+		return sgrCaptureNotSupported;
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	VkShaderModuleCreateInfo shaderInfo{};
+	shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderInfo.codeSize = shaderCode.size();
+	shaderInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+	if (vkCreateShaderModule(device, &shaderInfo, HostAllocationTracker::getAllocator(), &conversionShader) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, HostAllocationTracker::getAllocator(), &conversionSetLayout) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = setsCount * 2;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = setsCount;
+	if (vkCreateDescriptorPool(device, &poolInfo, HostAllocationTracker::getAllocator(), &conversionPool) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	std::vector<VkDescriptorSetLayout> layouts(setsCount, conversionSetLayout);
+	std::vector<VkDescriptorSet> sets(setsCount);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = conversionPool;
+	allocInfo.descriptorSetCount = setsCount;
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	for (uint32_t i = 0; i < setsCount; i++)
+		slots[i].conversionSet = sets[i];
+
+	VkPushConstantRange pushRange{};
+	pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushRange.offset = 0;
+	pushRange.size = sizeof(SgrConversionParams);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &conversionSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, HostAllocationTracker::getAllocator(), &conversionPipelineLayout) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = conversionShader;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = conversionPipelineLayout;
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, HostAllocationTracker::getAllocator(), &conversionPipeline) != VK_SUCCESS)
+		return sgrCaptureNotSupported;
+
+	conversionReady = true;
+	return sgrOK;
+}
+
+void CaptureManager::destroyConversion()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	vkDestroyPipeline(device, conversionPipeline, HostAllocationTracker::getAllocator());
+	vkDestroyPipelineLayout(device, conversionPipelineLayout, HostAllocationTracker::getAllocator());
+	vkDestroyDescriptorPool(device, conversionPool, HostAllocationTracker::getAllocator());
+	vkDestroyDescriptorSetLayout(device, conversionSetLayout, HostAllocationTracker::getAllocator());
+	vkDestroyShaderModule(device, conversionShader, HostAllocationTracker::getAllocator());
+
+	conversionPipeline = VK_NULL_HANDLE;
+	conversionPipelineLayout = VK_NULL_HANDLE;
+	conversionPool = VK_NULL_HANDLE;
+	conversionSetLayout = VK_NULL_HANDLE;
+	conversionShader = VK_NULL_HANDLE;
+	conversionReady = false;
+}
+
+void CaptureManager::recordConversionCommands(VkCommandBuffer commandBuffer, SgrCaptureSlot& slot)
+{
+	VkBufferMemoryBarrier sourceBarrier{};
+	sourceBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	sourceBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	sourceBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	sourceBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sourceBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	sourceBarrier.buffer = slot.sourceBuffer->vkBuffer;
+	sourceBarrier.offset = 0;
+	sourceBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+						 0, 0, nullptr, 1, &sourceBarrier, 0, nullptr);
+
+	SgrConversionParams params;
+	params.width = slot.width;
+	params.height = slot.height;
+	params.bgra = slot.format == VK_FORMAT_B8G8R8A8_SRGB || slot.format == VK_FORMAT_B8G8R8A8_UNORM;
+	params.nv12 = captureFormat == SGR_CAPTURE_NV12;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, conversionPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, conversionPipelineLayout, 0, 1, &slot.conversionSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, conversionPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+
+	// 8x8 workgroup of invocations, each invocation converts 8x2 pixels
+	uint32_t groupsX = (slot.width / 8 + 7) / 8;
+	uint32_t groupsY = (slot.height / 2 + 7) / 8;
+	vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+}
+
+SgrErrCode CaptureManager::start(SgrCaptureCallback captureCallback, void* userData, uint8_t slotCount, SgrCaptureFormat format)
+{
+	if (captureCallback == nullptr || slotCount == 0)
+		return sgrIncorrectPointer;
+
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	if (!swapChainManager->offscreen &&
+		!(swapChainManager->details.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+		return sgrCaptureNotSupported;
+
+	if (capturing)
+		return sgrOK;
+
+	callback = captureCallback;
+	callbackUserData = userData;
+	captureFormat = format;
+	slots.resize(slotCount);
+	recordedSlot = -1;
+	droppedFrames = 0;
+	capturing = true;
+
+	// without compiled conversion shader YUV frames are converted on CPU
+	if (format != SGR_CAPTURE_RGBA && initConversion(slotCount) != sgrOK)
+		destroyConversion();
+
+	return sgrOK;
+}
+
+SgrErrCode CaptureManager::stop(uint64_t completedFrame)
+{
+	if (!capturing)
+		return sgrOK;
+
+	deliverCompletedFrames(completedFrame);
+	destroySlots();
+	capturing = false;
+	callback = nullptr;
+	callbackUserData = nullptr;
+
+	return sgrOK;
+}
+
+SgrErrCode CaptureManager::prepareFrame()
+{
+	recordedSlot = -1;
+	if (!capturing)
+		return sgrOK;
+
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (!slots[i].busy) {
+			SgrErrCode resultPrepare = prepareSlotBuffer(slots[i]);
+			if (resultPrepare != sgrOK)
+				return resultPrepare;
+
+			recordedSlot = static_cast<int32_t>(i);
+			return sgrOK;
+		}
+	}
+
+	// consumer is slower than renderer, frame is skipped instead of waiting for readback
+	droppedFrames++;
+	return sgrOK;
+}
+
+SgrErrCode CaptureManager::prepareSlotBuffer(SgrCaptureSlot& slot)
+{
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	VkExtent2D extent = swapChainManager->extent;
+	VkFormat format = swapChainManager->imageFormat;
+	bool gpuConverted = isGPUConversionPossible(extent.width, extent.height);
+
+	if (slot.buffer != nullptr && slot.width == extent.width && slot.height == extent.height &&
+		slot.format == format && slot.gpuConverted == gpuConverted)
+		return sgrOK;
+
+	destroySlotBuffers(slot);
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	MemoryManager* memoryManager = MemoryManager::get();
+
+	// with GPU conversion only converted YUV data is transferred to host memory
+	VkDeviceSize rgbaSize = getCaptureDataSize(extent.width, extent.height, SGR_CAPTURE_RGBA);
+	VkDeviceSize size = gpuConverted ? getCaptureDataSize(extent.width, extent.height, captureFormat) : rgbaSize;
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (gpuConverted)
+		usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+	// cached memory is much faster for CPU reads, coherent is fallback
+	SgrErrCode resultCreateBuffer = memoryManager->createBuffer(slot.buffer, size, usage,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	if (resultCreateBuffer == sgrNoSuitableMemoryFinded)
+		resultCreateBuffer = memoryManager->createBuffer(slot.buffer, size, usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (resultCreateBuffer != sgrOK)
+		return resultCreateBuffer;
+
+	if (vkMapMemory(device, slot.buffer->bufferMemory, 0, size, 0, &slot.mapped) != VK_SUCCESS)
+		return sgrMapMemoryError;
+
+	if (gpuConverted) {
+		resultCreateBuffer = memoryManager->createBuffer(slot.sourceBuffer, rgbaSize,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (resultCreateBuffer != sgrOK)
+			return resultCreateBuffer;
+
+		std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+		bufferInfos[0].buffer = slot.sourceBuffer->vkBuffer;
+		bufferInfos[0].offset = 0;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = slot.buffer->vkBuffer;
+		bufferInfos[1].offset = 0;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = slot.conversionSet;
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	slot.width = extent.width;
+	slot.height = extent.height;
+	slot.format = format;
+	slot.gpuConverted = gpuConverted;
+
+	return sgrOK;
+}
+
+void CaptureManager::destroySlotBuffers(SgrCaptureSlot& slot)
+{
+	if (slot.buffer != nullptr) {
+		vkUnmapMemory(LogicalDeviceManager::instance->logicalDevice, slot.buffer->bufferMemory);
+		MemoryManager::destroyBuffer(slot.buffer);
+	}
+	if (slot.sourceBuffer != nullptr)
+		MemoryManager::destroyBuffer(slot.sourceBuffer);
+
+	slot.buffer = nullptr;
+	slot.sourceBuffer = nullptr;
+	slot.mapped = nullptr;
+}
+
+void CaptureManager::recordCopyCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	if (recordedSlot < 0)
+		return;
+
+	SwapChainManager* swapChainManager = SwapChainManager::get();
+	SgrCaptureSlot& slot = slots[recordedSlot];
+	VkImage image = swapChainManager->images[imageIndex];
+
+	// render pass leaves image in present layout for window mode and in transfer layout for offscreen
+	VkImageLayout renderedLayout = swapChainManager->offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = renderedLayout;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { slot.width, slot.height, 1 };
+
+	VkBuffer copyDestination = slot.gpuConverted ? slot.sourceBuffer->vkBuffer : slot.buffer->vkBuffer;
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, copyDestination, 1, &region);
+
+	if (renderedLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = renderedLayout;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = 0;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	if (slot.gpuConverted)
+		recordConversionCommands(commandBuffer, slot);
+
+	// make copied data visible for host after frame fence
+	VkBufferMemoryBarrier bufferBarrier{};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.srcAccessMask = slot.gpuConverted ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = slot.buffer->vkBuffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+
+	VkPipelineStageFlags writeStage = slot.gpuConverted ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+	vkCmdPipelineBarrier(commandBuffer, writeStage, VK_PIPELINE_STAGE_HOST_BIT,
+						 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+void CaptureManager::frameSubmitted(uint64_t frameNumber)
+{
+	if (recordedSlot < 0)
+		return;
+
+	slots[recordedSlot].busy = true;
+	slots[recordedSlot].frameNumber = frameNumber;
+	recordedSlot = -1;
+}
+
+void CaptureManager::deliverCompletedFrames(uint64_t completedFrame)
+{
+	// frames are handed to callback in submission order
+	std::vector<SgrCaptureSlot*> completedSlots;
+	for (auto& slot : slots)
+		if (slot.busy && slot.frameNumber <= completedFrame)
+			completedSlots.push_back(&slot);
+
+	std::sort(completedSlots.begin(), completedSlots.end(),
+			  [](const SgrCaptureSlot* a, const SgrCaptureSlot* b) { return a->frameNumber < b->frameNumber; });
+
+	for (auto slot : completedSlots) {
+		SgrCapturedFrame frame;
+		frame.frameNumber = slot->frameNumber;
+		frame.width = slot->width;
+		frame.height = slot->height;
+		frame.rowPitch = captureFormat == SGR_CAPTURE_RGBA ? slot->width * 4 : slot->width;
+		frame.format = slot->format;
+		frame.captureFormat = captureFormat;
+		frame.pixels = (const uint8_t*)slot->mapped;
+		frame.dataSize = getCaptureDataSize(slot->width, slot->height, captureFormat);
+
+		if (captureFormat != SGR_CAPTURE_RGBA && !slot->gpuConverted) {
+			bool bgra = slot->format == VK_FORMAT_B8G8R8A8_SRGB || slot->format == VK_FORMAT_B8G8R8A8_UNORM;
+			slot->convertedData.resize(frame.dataSize);
+			convertRGBAToYUV(frame.pixels, slot->width, slot->height, bgra, captureFormat, slot->convertedData.data());
+			frame.pixels = slot->convertedData.data();
+		}
+
+		if (callback != nullptr)
+			callback(frame, callbackUserData);
+
+		slot->busy = false;
+	}
+}
+
+void CaptureManager::destroySlots()
+{
+	for (auto& slot : slots)
+		destroySlotBuffers(slot);
+	slots.clear();
+	recordedSlot = -1;
+
+	destroyConversion();
+}
+
+void CaptureManager::destroy()
+{
+	destroySlots();
+	delete instance;
+	instance = nullptr;
+}
@@ -10,7 +10,13 @@
 #include "DrawIndexedCommand.h"
 #include "BindDescriptorSetCommand.h"
 #include "BindPipelineCommand.h"
+#include "SetRenderStateCommand.h"
+#include "BeginQueryCommand.h"
+#include "EndQueryCommand.h"
 #include "UserInterface.h"
+#include "CaptureManager.h"
+#include "QueryManager.h"
+#include "HostAllocationTracker.h"
 
 CommandManager* CommandManager::instance = nullptr;
 
@@ -34,7 +40,7 @@ SgrErrCode CommandManager::initCommandPool()
     poolInfo.queueFamilyIndex = PhysicalDeviceManager::get()->getPickedPhysicalDevice().fixedGraphicsQueue.value();
     poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-    if (vkCreateCommandPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    if (vkCreateCommandPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, HostAllocationTracker::getAllocator(), &commandPool) != VK_SUCCESS)
         return sgrInitCommandPoolError;
 
     return sgrOK;
@@ -42,6 +48,8 @@ SgrErrCode CommandManager::initCommandPool()
 
 SgrErrCode CommandManager::beginCommandBuffers()
 {
+    bufferStats.assign(commandBuffers.size(), SgrRenderStats());
+
     for (size_t i = 0; i < commandBuffers.size(); i++) {
         // firstly we should to reset all command buffers
         if (vkResetCommandBuffer(commandBuffers[i], 0 /*VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT*/) != VK_SUCCESS)
@@ -55,6 +63,10 @@ SgrErrCode CommandManager::beginCommandBuffers()
         if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
             return sgrBeginCommandBufferError;
 
+        // query reset is not allowed inside render pass
+        QueryManager::get()->resetFrameQueries(commandBuffers[i], static_cast<uint32_t>(i));
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_FRAME_BEGIN);
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = RenderPassManager::get()->renderPass;
@@ -70,6 +82,23 @@ SgrErrCode CommandManager::beginCommandBuffers()
         renderPassInfo.pClearValues = clearValues.data();
 
         vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        // pipelines use dynamic viewport and scissor
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)SwapChainManager::get()->extent.width;
+        viewport.height = (float)SwapChainManager::get()->extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = SwapChainManager::get()->extent;
+        vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_SCENE_BEGIN);
     }
 
     return sgrOK;
@@ -96,7 +125,7 @@ SgrErrCode CommandManager::initCommandBuffers()
     if (vkAllocateCommandBuffers(LogicalDeviceManager::instance->logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
         return sgrInitCommandBuffersError;
 
-    return sgrOK;
+    return QueryManager::get()->initFrameQueries(static_cast<uint32_t>(commandBuffers.size()));
 }
 
 SgrErrCode CommandManager::freeCommandBuffers(bool cleanOldCommands)
@@ -104,15 +133,24 @@ SgrErrCode CommandManager::freeCommandBuffers(bool cleanOldCommands)
     vkFreeCommandBuffers(LogicalDeviceManager::instance->logicalDevice, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
     commandBuffers.clear();
 
-    if (cleanOldCommands) {
-        for (auto cmd : commands[0])
-            delete cmd;
-        commands.clear();
-    }
+    if (cleanOldCommands)
+        deleteCommands();
 
     return sgrOK;
 }
 
+void CommandManager::deleteCommands()
+{
+    // shared commands are in all buffers lists, per buffer commands only in one
+    std::set<Command*> uniqueCommands;
+    for (auto& bufferCommands : commands)
+        uniqueCommands.insert(bufferCommands.begin(), bufferCommands.end());
+
+    for (auto cmd : uniqueCommands)
+        delete cmd;
+    commands.clear();
+}
+
 void CommandManager::addCmdToBuffer(int16_t bufferIndex, Command* newCmd)
 {
     if (bufferIndex == -1) {
@@ -160,10 +198,37 @@ void CommandManager::bindPipeline(VkPipeline* sgrPipeline, int16_t cmdBufferInde
     addCmdToBuffer(cmdBufferIndex, (Command*)newBindPipelineCmd);
 }
 
+void CommandManager::setRenderState(SgrRenderState renderState, int16_t cmdBufferIndex)
+{
+    SetRenderStateCommand* newSetRenderStateCmd = new SetRenderStateCommand(renderState);
+    addCmdToBuffer(cmdBufferIndex, (Command*)newSetRenderStateCmd);
+}
+
+void CommandManager::beginQuery(VkQueryPool* queryPool, uint32_t query, VkQueryControlFlags flags, int16_t cmdBufferIndex)
+{
+    BeginQueryCommand* newBeginQueryCmd = new BeginQueryCommand(queryPool, query, flags);
+    addCmdToBuffer(cmdBufferIndex, (Command*)newBeginQueryCmd);
+}
+
+void CommandManager::endQuery(VkQueryPool* queryPool, uint32_t query, int16_t cmdBufferIndex)
+{
+    EndQueryCommand* newEndQueryCmd = new EndQueryCommand(queryPool, query);
+    addCmdToBuffer(cmdBufferIndex, (Command*)newEndQueryCmd);
+}
+
 SgrErrCode CommandManager::endInitCommandBuffers()
 {
+    // buffers begun before rebuild are freed without ending, so only ended ones are counted
+    recordedBuffersCount += static_cast<uint32_t>(commandBuffers.size());
+
     for (size_t i = 0; i < commandBuffers.size(); i++) {
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_UI_END);
         vkCmdEndRenderPass(commandBuffers[i]);
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_RENDER_PASS_END);
+
+        // readback of rendered image if frame capture is active
+        CaptureManager::get()->recordCopyCommands(commandBuffers[i], static_cast<uint32_t>(i));
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_FRAME_END);
 
         if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
             return sgrEndCommandBufferError;
@@ -181,12 +246,48 @@ SgrErrCode CommandManager::executeCommands()
             if (resultCmd != sgrOK) {
                 return resultCmd;
             }           
+            countCommand(commands[i][j], bufferStats[i]);
         }
+        QueryManager::get()->writeTimestamp(commandBuffers[i], static_cast<uint32_t>(i), SGR_TIMESTAMP_SCENE_END);
     }
 
     return sgrOK;
 }
 
+void CommandManager::countCommand(Command* cmd, SgrRenderStats& stats)
+{
+    switch (cmd->getType()) {
+        case CommandType::DRAW:
+        {
+            DrawCommand* drawCmd = (DrawCommand*)cmd;
+            stats.drawCalls++;
+            stats.triangles += uint64_t(drawCmd->vertexCount / 3) * drawCmd->instanceCount;
+            break;
+        }
+        case CommandType::DRAW_INDEXED:
+        {
+            DrawIndexedCommand* drawCmd = (DrawIndexedCommand*)cmd;
+            stats.drawCalls++;
+            stats.triangles += uint64_t(drawCmd->indexCount / 3) * drawCmd->instanceCount;
+            break;
+        }
+        case CommandType::BIND_PIPELINE:
+            stats.pipelineBinds++;
+            break;
+        case CommandType::BIND_DESCRIPTOR_SETS:
+            stats.descriptorSetBinds++;
+            break;
+        case CommandType::BIND_VERTEX_BUFFER:
+            stats.vertexBufferBinds++;
+            break;
+        case CommandType::BIND_INDEX_BUFFER:
+            stats.indexBufferBinds++;
+            break;
+        default:
+            break;
+    }
+}
+
 VkCommandBuffer CommandManager::beginSingleTimeCommands()
 {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -203,12 +304,14 @@ VkCommandBuffer CommandManager::beginSingleTimeCommands()
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    QueryManager::get()->beginUploadQueries(commandBuffer);
 
     return commandBuffer;
 }
 
 void CommandManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
 {
+    QueryManager::get()->endUploadQueries(cmdBuffer);
     vkEndCommandBuffer(cmdBuffer);
 
     VkSubmitInfo submitInfo{};
@@ -219,6 +322,7 @@ void CommandManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
     VkQueue graphicsQueue = LogicalDeviceManager::instance->graphicsQueue;
     vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(graphicsQueue);
+    QueryManager::get()->resolveUploadQueries();
 
     vkFreeCommandBuffers(LogicalDeviceManager::instance->logicalDevice, commandPool, 1, &cmdBuffer);
 }
@@ -226,11 +330,9 @@ void CommandManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
 void CommandManager::destroy()
 {
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
-    for (auto cmd : commands[0])
-        delete cmd;
-    commands.clear();
+    deleteCommands();
     freeCommandBuffers();
     commandBuffers.clear();
-    vkDestroyCommandPool(device, commandPool, nullptr);
+    vkDestroyCommandPool(device, commandPool, HostAllocationTracker::getAllocator());
     delete instance;
 }
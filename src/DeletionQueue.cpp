@@ -0,0 +1,213 @@
+#include "DeletionQueue.h"
+#include "LogicalDeviceManager.h"
+#include "MemoryManager.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
+
+DeletionQueue* DeletionQueue::instance = nullptr;
+
+DeletionQueue::DeletionQueue() { ; }
+DeletionQueue::~DeletionQueue() { ; }
+
+DeletionQueue* DeletionQueue::get()
+{
+	if (instance == nullptr)
+		instance = new DeletionQueue();
+
+	return instance;
+}
+
+void DeletionQueue::retire(SgrRetiredObject object)
+{
+	std::unique_lock<std::mutex> lock(retiredObjectsMutex);
+	object.lastUsedFrame = lastSubmittedFrame;
+	retiredObjects.push_back(object);
+}
+
+void DeletionQueue::retireBuffer(VkBuffer buffer)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_BUFFER;
+	object.buffer = buffer;
+	retire(object);
+}
+
+void DeletionQueue::retireImage(VkImage image)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_IMAGE;
+	object.image = image;
+	retire(object);
+}
+
+void DeletionQueue::retireImageView(VkImageView imageView)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_IMAGE_VIEW;
+	object.imageView = imageView;
+	retire(object);
+}
+
+void DeletionQueue::retireSampler(VkSampler sampler)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_SAMPLER;
+	object.sampler = sampler;
+	retire(object);
+}
+
+void DeletionQueue::retireMemory(VkDeviceMemory memory)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_MEMORY;
+	object.memory = memory;
+	retire(object);
+}
+
+void DeletionQueue::retireFramebuffer(VkFramebuffer framebuffer)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_FRAMEBUFFER;
+	object.framebuffer = framebuffer;
+	retire(object);
+}
+
+void DeletionQueue::retireSwapChain(VkSwapchainKHR swapChain)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_SWAPCHAIN;
+	object.swapChain = swapChain;
+	retire(object);
+}
+
+void DeletionQueue::retireDescriptorPool(VkDescriptorPool descriptorPool)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_DESCRIPTOR_POOL;
+	object.descriptorPool = descriptorPool;
+	retire(object);
+}
+
+void DeletionQueue::retireDescriptorSetLayout(VkDescriptorSetLayout setLayout)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_DESCRIPTOR_SET_LAYOUT;
+	object.setLayout = setLayout;
+	retire(object);
+}
+
+void DeletionQueue::retirePipeline(VkPipeline pipeline)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_PIPELINE;
+	object.pipeline = pipeline;
+	retire(object);
+}
+
+void DeletionQueue::retirePipelineLayout(VkPipelineLayout pipelineLayout)
+{
+	SgrRetiredObject object{};
+	object.type = SGR_RETIRED_PIPELINE_LAYOUT;
+	object.pipelineLayout = pipelineLayout;
+	retire(object);
+}
+
+void DeletionQueue::retireSgrBuffer(SgrBuffer* buffer)
+{
+	if (buffer == nullptr)
+		return;
+
+	retireBuffer(buffer->vkBuffer);
+	retireMemory(buffer->bufferMemory);
+	delete buffer;
+}
+
+void DeletionQueue::retireSgrImage(SgrImage* image)
+{
+	if (image == nullptr)
+		return;
+
+	if (image->sampler != VK_NULL_HANDLE)
+		retireSampler(image->sampler);
+	if (image->view != VK_NULL_HANDLE)
+		retireImageView(image->view);
+	retireImage(image->vkImage);
+	retireMemory(image->memory);
+	delete image;
+}
+
+size_t DeletionQueue::getRetiredCount()
+{
+	std::unique_lock<std::mutex> lock(retiredObjectsMutex);
+	return retiredObjects.size();
+}
+
+void DeletionQueue::frameSubmitted(uint64_t frameNumber)
+{
+	std::unique_lock<std::mutex> lock(retiredObjectsMutex);
+	lastSubmittedFrame = frameNumber;
+}
+
+void DeletionQueue::destroyObject(const SgrRetiredObject& object)
+{
+	VkDevice device = LogicalDeviceManager::get()->getLogicalDevice();
+	const VkAllocationCallbacks* allocator = HostAllocationTracker::getAllocator();
+
+	switch (object.type) {
+		case SGR_RETIRED_BUFFER:
+			vkDestroyBuffer(device, object.buffer, allocator);
+			break;
+		case SGR_RETIRED_IMAGE:
+			vkDestroyImage(device, object.image, allocator);
+			break;
+		case SGR_RETIRED_IMAGE_VIEW:
+			vkDestroyImageView(device, object.imageView, allocator);
+			break;
+		case SGR_RETIRED_SAMPLER:
+			vkDestroySampler(device, object.sampler, allocator);
+			break;
+		case SGR_RETIRED_MEMORY:
+			MemoryManager::unregisterAllocation(object.memory);
+			vkFreeMemory(device, object.memory, allocator);
+			break;
+		case SGR_RETIRED_FRAMEBUFFER:
+			vkDestroyFramebuffer(device, object.framebuffer, allocator);
+			break;
+		case SGR_RETIRED_SWAPCHAIN:
+			vkDestroySwapchainKHR(device, object.swapChain, allocator);
+			break;
+		case SGR_RETIRED_DESCRIPTOR_POOL:
+			vkDestroyDescriptorPool(device, object.descriptorPool, allocator); // sets are freed with pool
+			break;
+		case SGR_RETIRED_DESCRIPTOR_SET_LAYOUT:
+			vkDestroyDescriptorSetLayout(device, object.setLayout, allocator);
+			break;
+		case SGR_RETIRED_PIPELINE:
+			vkDestroyPipeline(device, object.pipeline, allocator);
+			break;
+		case SGR_RETIRED_PIPELINE_LAYOUT:
+			vkDestroyPipelineLayout(device, object.pipelineLayout, allocator);
+			break;
+	}
+}
+
+void DeletionQueue::destroyCompleted(uint64_t completedFrame)
+{
+	SGR_TRACE_SCOPE("DeletionQueue::destroyCompleted");
+
+	std::unique_lock<std::mutex> lock(retiredObjectsMutex);
+
+	size_t completedCount = 0;
+	while (completedCount < retiredObjects.size() && retiredObjects[completedCount].lastUsedFrame <= completedFrame)
+		destroyObject(retiredObjects[completedCount++]);
+
+	// vector keeps capacity, retiring in steady state does not allocate
+	retiredObjects.erase(retiredObjects.begin(), retiredObjects.begin() + completedCount);
+}
+
+void DeletionQueue::destroy()
+{
+	destroyCompleted(UINT64_MAX);
+	delete instance;
+	instance = nullptr;
+}
@@ -1,6 +1,11 @@
 #include "DescriptorManager.h"
 #include "LogicalDeviceManager.h"
 #include "MemoryManager.h"
+#include "DeletionQueue.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
 
 DescriptorManager* DescriptorManager::instance = nullptr;
 
@@ -24,7 +29,7 @@ SgrErrCode DescriptorManager::createDescriptorSetLayout(SgrDescriptorInfo& descr
     layoutInfo.pBindings = descrInfo.setLayoutBinding.data();
 
     VkDescriptorSetLayout newLayout;
-    if (vkCreateDescriptorSetLayout(LogicalDeviceManager::instance->logicalDevice, &layoutInfo, nullptr, &newLayout) != VK_SUCCESS)
+    if (vkCreateDescriptorSetLayout(LogicalDeviceManager::instance->logicalDevice, &layoutInfo, HostAllocationTracker::getAllocator(), &newLayout) != VK_SUCCESS)
         return sgrInitDefaultUBODescriptorSetLayoutError;
 
     std::vector<VkDescriptorSetLayout> newSetLayouts(SwapChainManager::instance->imageCount, newLayout);
@@ -52,7 +57,7 @@ SgrErrCode DescriptorManager::createDescriptorPool(SgrDescriptorInfo& descrInfo,
     poolInfo.maxSets = swapChainImageCount;
     poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
  
-    if (vkCreateDescriptorPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, nullptr, &descrPool) != VK_SUCCESS) {
+    if (vkCreateDescriptorPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, HostAllocationTracker::getAllocator(), &descrPool) != VK_SUCCESS) {
         return sgrInitDefaultUBODescriptorPoolError;
 	}
 
@@ -61,32 +66,31 @@ SgrErrCode DescriptorManager::createDescriptorPool(SgrDescriptorInfo& descrInfo,
 
 SgrErrCode DescriptorManager::createDescriptorSets(std::string name, SgrDescriptorInfo& descrInfo)
 {
-	SgrDescriptorSets* newSets = nullptr;
-
+    // existing sets are recreated in place, their old pool is already retired
     auto it = std::find_if(allDescriptorSets.begin(), allDescriptorSets.end(), [&name](const SgrDescriptorSets& descr){ return descr.name == name; });
-    if (it != allDescriptorSets.end())
-        newSets = &(*it);
-    else
-        newSets = new SgrDescriptorSets{};
+    SgrDescriptorSets newSets{};
+    newSets.name = name;
 
-	SgrErrCode resultCreateDescriptorPool = createDescriptorPool(descrInfo, newSets->descriptorPool);
+	SgrErrCode resultCreateDescriptorPool = createDescriptorPool(descrInfo, newSets.descriptorPool);
 	if (resultCreateDescriptorPool != sgrOK)
 		return resultCreateDescriptorPool;
 
     uint32_t swapChainImageCount = SwapChainManager::instance->imageCount;
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = newSets->descriptorPool;
+    allocInfo.descriptorPool = newSets.descriptorPool;
     allocInfo.descriptorSetCount = swapChainImageCount;
     allocInfo.pSetLayouts = descrInfo.setLayouts.data();
-	newSets->descriptorSets.resize(swapChainImageCount);
-    if (vkAllocateDescriptorSets(LogicalDeviceManager::instance->logicalDevice, &allocInfo, newSets->descriptorSets.data()) != VK_SUCCESS)
+	newSets.descriptorSets.resize(swapChainImageCount);
+    if (vkAllocateDescriptorSets(LogicalDeviceManager::instance->logicalDevice, &allocInfo, newSets.descriptorSets.data()) != VK_SUCCESS) {
+        vkDestroyDescriptorPool(LogicalDeviceManager::instance->logicalDevice, newSets.descriptorPool, HostAllocationTracker::getAllocator());
 		return sgrInitDescriptorSetsError;
+    }
 
-	newSets->name = name;
-
-    if (it == allDescriptorSets.end())
-	    allDescriptorSets.push_back(*newSets);
+    if (it != allDescriptorSets.end())
+        *it = newSets;
+    else
+	    allDescriptorSets.push_back(newSets);
     return sgrOK;
 }
 
@@ -99,11 +103,17 @@ SgrErrCode DescriptorManager::addNewDescriptorInfo(SgrDescriptorInfo& descrInfo)
 
 SgrErrCode DescriptorManager::updateDescriptorSets()
 {
-    VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+    SGR_TRACE_SCOPE("DescriptorManager::updateDescriptorSets");
+
+    promoteLoadedTextures();
+    rewriteStreamedTextures();
+
     int i = 0;
     for (auto& descr : pendedDescriptorsUpdate) {
-        vkFreeDescriptorSets(device, allDescriptorSets[descr.idx].descriptorPool, allDescriptorSets[descr.idx].descriptorSets.size(), allDescriptorSets[descr.idx].descriptorSets.data());
-        vkDestroyDescriptorPool(device, allDescriptorSets[descr.idx].descriptorPool, nullptr);
+        // sets of previous frames stay valid until these frames are completed
+        SgrDescriptorSets oldSets = getDescriptorSetsByName(descr.name);
+        if (oldSets.name != "empty")
+            DeletionQueue::get()->retireDescriptorPool(oldSets.descriptorPool);
 
         if (updateDescriptorSets(descr.name, descr.infoName, descr.data, true) == sgrOK)
             i++;
@@ -120,6 +130,86 @@ SgrErrCode DescriptorManager::updateDescriptorSets()
     return sgrOK;
 }
 
+bool DescriptorManager::isWaitingForTextures(const SgrDescriptorPended& descr)
+{
+    SgrDescriptorInfo info = getDescriptorInfoByName(descr.infoName);
+    for (size_t k = 0; k < info.setLayoutBinding.size() && k < descr.data.size(); k++) {
+        if (info.setLayoutBinding[k].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER &&
+            TextureLoader::get()->getTextureState(TextureStreamer::get()->resolve((SgrImage*)descr.data[k])) == SGR_TEXTURE_LOADING)
+            return true;
+    }
+
+    return false;
+}
+
+void DescriptorManager::promoteLoadedTextures()
+{
+    // sets with placeholder are rewritten like usual pended update when their textures are uploaded
+    for (size_t i = 0; i < placeholderDescriptors.size();) {
+        SgrDescriptorPended& descr = placeholderDescriptors[i];
+        if (isWaitingForTextures(descr)) {
+            i++;
+            continue;
+        }
+
+        // newer write of the same sets replaces placeholder anyway
+        bool pended = std::any_of(pendedDescriptorsUpdate.begin(), pendedDescriptorsUpdate.end(),
+            [&descr](const SgrDescriptorPended& pendedDescr) { return pendedDescr.name == descr.name; });
+        if (!pended)
+            pendedDescriptorsUpdate.push_back(descr);
+
+        placeholderDescriptors.erase(placeholderDescriptors.begin() + i);
+    }
+}
+
+void DescriptorManager::rewriteStreamedTextures()
+{
+    TextureStreamer* textureStreamer = TextureStreamer::get();
+    if (!textureStreamer->hasTextures())
+        return;
+
+    // handle pointers can't match other bindings data, so bindings types are not checked
+    for (auto& it : streamedDescriptors) {
+        const SgrDescriptorPended& descr = it.second;
+        bool changed = std::any_of(descr.data.begin(), descr.data.end(),
+            [textureStreamer](void* binding) { return textureStreamer->isResidencyChanged((SgrImage*)binding); });
+        if (!changed)
+            continue;
+
+        bool pended = std::any_of(pendedDescriptorsUpdate.begin(), pendedDescriptorsUpdate.end(),
+            [&descr](const SgrDescriptorPended& pendedDescr) { return pendedDescr.name == descr.name; });
+        if (!pended)
+            pendedDescriptorsUpdate.push_back(descr);
+    }
+}
+
+void DescriptorManager::reportStreamedTexturesUsage(const std::string& name)
+{
+    auto it = streamedDescriptors.find(name);
+    if (it == streamedDescriptors.end())
+        return;
+
+    TextureStreamer* textureStreamer = TextureStreamer::get();
+    for (void* binding : it->second.data)
+        textureStreamer->markUsed((SgrImage*)binding);
+}
+
+void DescriptorManager::forgetStreamedTexture(SgrImage* handle)
+{
+    auto referencesHandle = [handle](const SgrDescriptorPended& descr) {
+        return std::find(descr.data.begin(), descr.data.end(), (void*)handle) != descr.data.end(); };
+
+    pendedDescriptorsUpdate.erase(std::remove_if(pendedDescriptorsUpdate.begin(), pendedDescriptorsUpdate.end(), referencesHandle), pendedDescriptorsUpdate.end());
+    placeholderDescriptors.erase(std::remove_if(placeholderDescriptors.begin(), placeholderDescriptors.end(), referencesHandle), placeholderDescriptors.end());
+
+    for (auto it = streamedDescriptors.begin(); it != streamedDescriptors.end();) {
+        if (referencesHandle(it->second))
+            it = streamedDescriptors.erase(it);
+        else
+            it++;
+    }
+}
+
 SgrErrCode DescriptorManager::updateDescriptorSets(std::string name, std::string infoName, std::vector<void*> data, bool force)
 {
 	SgrDescriptorInfo info = getDescriptorInfoByName(infoName);
@@ -137,7 +227,7 @@ SgrErrCode DescriptorManager::updateDescriptorSets(std::string name, std::string
     }
 
     if (i != allDescriptorSets.size() && !force) {
-        SgrDescriptorPended descr{(int)i, name, infoName, data};
+        SgrDescriptorPended descr{name, infoName, data};
         pendedDescriptorsUpdate.push_back(descr);
         return sgrOK;
     } else {
@@ -148,6 +238,10 @@ SgrErrCode DescriptorManager::updateDescriptorSets(std::string name, std::string
 	}
 
     std::vector<std::vector<VkWriteDescriptorSet>> descriptorWrites = createDescriptorSetWrites(getDescriptorSetsByName(name).descriptorSets, info);
+    TextureLoader* textureLoader = TextureLoader::get();
+    TextureStreamer* textureStreamer = TextureStreamer::get();
+    bool waitingForTextures = false;
+    bool streamedTextures = false;
 
     for (size_t j = 0; j < descriptorWrites.size(); j++) {
 
@@ -169,9 +263,20 @@ SgrErrCode DescriptorManager::updateDescriptorSets(std::string name, std::string
                 }
                 case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
                 {   
+                    // streamed texture handle is replaced by its resident version
+                    SgrImage* image = textureStreamer->resolve((SgrImage*)data[k]);
+                    streamedTextures |= image != (SgrImage*)data[k];
+
+                    // texture which is not uploaded yet is replaced, failed one keeps placeholder forever
+                    SgrTextureState textureState = textureLoader->getTextureState(image);
+                    if (textureState != SGR_TEXTURE_READY) {
+                        waitingForTextures |= textureState == SGR_TEXTURE_LOADING;
+                        image = textureLoader->getPlaceholder();
+                    }
+
                     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                    imageInfo.imageView = ((SgrImage*)data[k])->view;
-                    imageInfo.sampler = ((SgrImage*)data[k])->sampler;
+                    imageInfo.imageView = image->view;
+                    imageInfo.sampler = image->sampler;
 
                     descriptorWriteForSetOneBinding.pImageInfo = &imageInfo;
                     break;
@@ -190,8 +295,22 @@ SgrErrCode DescriptorManager::updateDescriptorSets(std::string name, std::string
             }
         }
         vkUpdateDescriptorSets(LogicalDeviceManager::instance->logicalDevice, static_cast<uint32_t>(descriptorWrites[j].size()), descriptorWrites[j].data(), 0, nullptr);
+        descriptorWritesCount += static_cast<uint32_t>(descriptorWrites[j].size());
     }
 
+    auto written = std::find_if(allDescriptorSets.begin(), allDescriptorSets.end(), [&name](const SgrDescriptorSets& descr){ return descr.name == name; });
+    if (written != allDescriptorSets.end())
+        written->data = data;
+
+    placeholderDescriptors.erase(std::remove_if(placeholderDescriptors.begin(), placeholderDescriptors.end(),
+        [&name](const SgrDescriptorPended& descr) { return descr.name == name; }), placeholderDescriptors.end());
+    if (waitingForTextures)
+        placeholderDescriptors.push_back(SgrDescriptorPended{ name, infoName, data });
+
+    streamedDescriptors.erase(name);
+    if (streamedTextures)
+        streamedDescriptors[name] = SgrDescriptorPended{ name, infoName, data };
+
     return sgrOK;
 }
 
@@ -242,6 +361,37 @@ const DescriptorManager::SgrDescriptorSets DescriptorManager::getDescriptorSetsB
     return emptyDescriptorSets;
 }
 
+SgrErrCode DescriptorManager::destroyDescriptorSets(std::string name)
+{
+    // pended update would recreate sets of removed instance
+    pendedDescriptorsUpdate.erase(std::remove_if(pendedDescriptorsUpdate.begin(), pendedDescriptorsUpdate.end(),
+        [&name](const SgrDescriptorPended& descr) { return descr.name == name; }), pendedDescriptorsUpdate.end());
+    placeholderDescriptors.erase(std::remove_if(placeholderDescriptors.begin(), placeholderDescriptors.end(),
+        [&name](const SgrDescriptorPended& descr) { return descr.name == name; }), placeholderDescriptors.end());
+    streamedDescriptors.erase(name);
+
+    auto it = std::find_if(allDescriptorSets.begin(), allDescriptorSets.end(), [&name](const SgrDescriptorSets& descr){ return descr.name == name; });
+    if (it == allDescriptorSets.end())
+        return sgrMissingDescriptorSets;
+
+    DeletionQueue::get()->retireDescriptorPool(it->descriptorPool);
+    allDescriptorSets.erase(it);
+    return sgrOK;
+}
+
+SgrErrCode DescriptorManager::removeDescriptorInfo(std::string name)
+{
+    auto it = std::find_if(descriptorInfos.begin(), descriptorInfos.end(), [&name](const SgrDescriptorInfo& descr){ return descr.name == name; });
+    if (it == descriptorInfos.end())
+        return sgrDescriptorsWithUnknownInfo;
+
+    // all set layouts are the same handle
+    if (!it->setLayouts.empty())
+        DeletionQueue::get()->retireDescriptorSetLayout(it->setLayouts[0]);
+    descriptorInfos.erase(it);
+    return sgrOK;
+}
+
 SgrErrCode DescriptorManager::destroyDescriptorsData()
 {
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
@@ -250,12 +400,12 @@ SgrErrCode DescriptorManager::destroyDescriptorsData()
         vkFreeDescriptorSets(device, descrSets.descriptorPool, descrSets.descriptorSets.size(), descrSets.descriptorSets.data());
 
     for (auto& descrSets : allDescriptorSets)
-        vkDestroyDescriptorPool(device, descrSets.descriptorPool, nullptr);
+        vkDestroyDescriptorPool(device, descrSets.descriptorPool, HostAllocationTracker::getAllocator());
 
     for (auto& descrInfo : descriptorInfos)
-        vkDestroyDescriptorSetLayout(device, descrInfo.setLayouts[0], nullptr);
+        vkDestroyDescriptorSetLayout(device, descrInfo.setLayouts[0], HostAllocationTracker::getAllocator());
 
-    vkDestroyDescriptorPool(device, uiDescriptorPool, nullptr);
+    vkDestroyDescriptorPool(device, uiDescriptorPool, HostAllocationTracker::getAllocator());
 
     return sgrOK;
 }
@@ -284,7 +434,7 @@ SgrErrCode DescriptorManager::createDescriptorPoolForUI()
 	pool_info.poolSizeCount = std::size(pool_sizes);
 	pool_info.pPoolSizes = pool_sizes;
 
-	if(vkCreateDescriptorPool(LogicalDeviceManager::instance->logicalDevice, &pool_info, nullptr, &uiDescriptorPool) != VK_SUCCESS)
+	if(vkCreateDescriptorPool(LogicalDeviceManager::instance->logicalDevice, &pool_info, HostAllocationTracker::getAllocator(), &uiDescriptorPool) != VK_SUCCESS)
         return sgrDescriptorPoolCreateError;
 
     return sgrOK;
@@ -33,3 +33,38 @@ std::vector<char> FileManager::readFile(const std::string filename)
 
     return buffer;
 }
+
+
+bool FileManager::readFileIfExists(const std::string filename, std::vector<char>& data)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    size_t fileSize = (size_t)file.tellg();
+    data.resize(fileSize);
+
+    file.seekg(0);
+    file.read(data.data(), fileSize);
+
+    bool readSuccess = file.good();
+    file.close();
+
+    return readSuccess;
+}
+
+bool FileManager::writeFile(const std::string filename, const std::vector<char>& data)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    file.write(data.data(), data.size());
+
+    bool writeSuccess = file.good();
+    file.close();
+
+    return writeSuccess;
+}
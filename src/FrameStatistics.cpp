@@ -0,0 +1,91 @@
+#include "FrameStatistics.h"
+
+#include <cmath>
+
+SgrFrameStatistics::SgrFrameStatistics(uint32_t windowSize) : windowSize(windowSize > 0 ? windowSize : 1)
+{
+	window.reserve(this->windowSize);
+}
+
+void SgrFrameStatistics::setWindowSize(uint32_t windowSize)
+{
+	this->windowSize = windowSize > 0 ? windowSize : 1;
+	window.clear();
+	window.reserve(this->windowSize);
+	nextFrame = 0;
+	statsOutdated = true;
+}
+
+void SgrFrameStatistics::addFrame(const SgrFrameTimings& timings, float deadline)
+{
+	if (window.size() < windowSize)
+		window.push_back(timings);
+	else
+		window[nextFrame] = timings;
+	nextFrame = (nextFrame + 1) % windowSize;
+
+	totalFrames++;
+	if (deadline > 0.f && timings.frameTime > deadline)
+		missedDeadlines++;
+
+	statsOutdated = true;
+}
+
+SgrFramePercentiles SgrFrameStatistics::calculatePercentiles(float SgrFrameTimings::* field, std::vector<float>& values)
+{
+	SgrFramePercentiles percentiles;
+	values.clear();
+	for (auto& frame : window)
+		values.push_back(frame.*field);
+
+	if (values.empty())
+		return percentiles;
+
+	std::sort(values.begin(), values.end());
+
+	// nearest rank percentile
+	auto rank = [&values](float p) {
+		size_t index = static_cast<size_t>(std::ceil(p * values.size()));
+		return values[index > 0 ? index - 1 : 0];
+	};
+
+	percentiles.p50 = rank(0.50f);
+	percentiles.p95 = rank(0.95f);
+	percentiles.p99 = rank(0.99f);
+	percentiles.max = values.back();
+
+	return percentiles;
+}
+
+const SgrFrameStats& SgrFrameStatistics::getStats()
+{
+	if (!statsOutdated)
+		return stats;
+
+	std::vector<float> values;
+	values.reserve(window.size());
+
+	stats.framesInWindow = static_cast<uint32_t>(window.size());
+	stats.totalFrames = totalFrames;
+	stats.missedDeadlines = missedDeadlines;
+	stats.update = calculatePercentiles(&SgrFrameTimings::update, values);
+	stats.recording = calculatePercentiles(&SgrFrameTimings::recording, values);
+	stats.acquire = calculatePercentiles(&SgrFrameTimings::acquire, values);
+	stats.submit = calculatePercentiles(&SgrFrameTimings::submit, values);
+	stats.present = calculatePercentiles(&SgrFrameTimings::present, values);
+	stats.frameTime = calculatePercentiles(&SgrFrameTimings::frameTime, values);
+	stats.interval = calculatePercentiles(&SgrFrameTimings::interval, values);
+
+	statsOutdated = false;
+	return stats;
+}
+
+void SgrFrameStatistics::reset()
+{
+	window.clear();
+	nextFrame = 0;
+	totalFrames = 0;
+	missedDeadlines = 0;
+	stats = SgrFrameStats();
+	statsOutdated = false;
+}
@@ -0,0 +1,179 @@
+#include "FrameWriter.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+SgrFrameWriter::SgrFrameWriter(SgrFrameWriterFormat format, std::string path, uint32_t fps, uint32_t maxQueuedFrames)
+	: format(format), path(path), fps(fps), maxQueuedFrames(maxQueuedFrames)
+{
+	if (format != SGR_FRAME_WRITER_PNG)
+		stream.open(path, std::ios::binary | std::ios::trunc);
+
+	writerThread = std::thread(&SgrFrameWriter::writerLoop, this);
+}
+
+SgrFrameWriter::~SgrFrameWriter()
+{
+	finish();
+}
+
+void SgrFrameWriter::captureCallback(const SgrCapturedFrame& frame, void* userData)
+{
+	if (userData == nullptr)
+		return;
+
+	((SgrFrameWriter*)userData)->push(frame);
+}
+
+void SgrFrameWriter::push(const SgrCapturedFrame& frame)
+{
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		if (finishing || queue.size() >= maxQueuedFrames) {
+			// writing is slower than rendering, render thread is never blocked by disk
+			droppedFrames++;
+			return;
+		}
+	}
+
+	SgrQueuedFrame queuedFrame;
+	queuedFrame.frameNumber = frame.frameNumber;
+	queuedFrame.width = frame.width;
+	queuedFrame.height = frame.height;
+	queuedFrame.bgra = frame.format == VK_FORMAT_B8G8R8A8_SRGB || frame.format == VK_FORMAT_B8G8R8A8_UNORM;
+	queuedFrame.captureFormat = frame.captureFormat;
+
+	// only copy here, mapped pixels are reused by capture ring after callback
+	if (frame.captureFormat == SGR_CAPTURE_RGBA) {
+		uint32_t packedRow = frame.width * 4;
+		queuedFrame.pixels.resize(size_t(packedRow) * frame.height);
+		for (uint32_t row = 0; row < frame.height; row++)
+			memcpy(queuedFrame.pixels.data() + size_t(row) * packedRow, frame.pixels + size_t(row) * frame.rowPitch, packedRow);
+	} else {
+		queuedFrame.pixels.assign(frame.pixels, frame.pixels + frame.dataSize);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(queuedFrame));
+	}
+	queueCondition.notify_one();
+}
+
+void SgrFrameWriter::writerLoop()
+{
+	while (true) {
+		SgrQueuedFrame frame;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return finishing || !queue.empty(); });
+			if (finishing && queue.empty())
+				return;
+
+			frame = std::move(queue.front());
+			queue.pop_front();
+		}
+		writeFrame(frame);
+	}
+}
+
+void SgrFrameWriter::writeFrame(SgrQueuedFrame& frame)
+{
+	bool rgba = frame.captureFormat == SGR_CAPTURE_RGBA;
+	if (rgba && frame.bgra && format != SGR_FRAME_WRITER_Y4M) {
+		for (size_t i = 0; i < frame.pixels.size(); i += 4)
+			std::swap(frame.pixels[i], frame.pixels[i + 2]);
+	}
+
+	if (format == SGR_FRAME_WRITER_PNG) {
+		if (!rgba) {
+			droppedFrames++;
+			return;
+		}
+
+		char frameNumber[32];
+		snprintf(frameNumber, sizeof(frameNumber), "_%06llu.png", (unsigned long long)frame.frameNumber);
+		std::string fileName = path + frameNumber;
+		if (stbi_write_png(fileName.c_str(), frame.width, frame.height, 4, frame.pixels.data(), frame.width * 4))
+			writtenFrames++;
+		return;
+	}
+
+	if (!stream.is_open())
+		return;
+
+	// stream has no place for new size, raw stream has no size at all
+	if (!streamHeaderWritten) {
+		streamWidth = frame.width;
+		streamHeight = frame.height;
+		streamCaptureFormat = frame.captureFormat;
+	} else if (frame.width != streamWidth || frame.height != streamHeight ||
+			   (format == SGR_FRAME_WRITER_RAW && frame.captureFormat != streamCaptureFormat)) {
+		droppedFrames++;
+		return;
+	}
+
+	if (format == SGR_FRAME_WRITER_RAW) {
+		streamHeaderWritten = true;
+		stream.write((const char*)frame.pixels.data(), frame.pixels.size());
+		writtenFrames++;
+		return;
+	}
+
+	if (!streamHeaderWritten) {
+		stream << "YUV4MPEG2 W" << frame.width << " H" << frame.height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+		streamHeaderWritten = true;
+	}
+
+	stream << "FRAME\n";
+
+	if (frame.captureFormat == SGR_CAPTURE_I420) {
+		stream.write((const char*)frame.pixels.data(), frame.pixels.size());
+		writtenFrames++;
+		return;
+	}
+
+	std::vector<uint8_t> yuv(CaptureManager::getCaptureDataSize(frame.width, frame.height, SGR_CAPTURE_I420));
+	if (rgba) {
+		CaptureManager::convertRGBAToYUV(frame.pixels.data(), frame.width, frame.height, frame.bgra, SGR_CAPTURE_I420, yuv.data());
+	} else {
+		// NV12 -> I420, luma is the same, interleaved chroma is split into planes
+		size_t lumaSize = size_t(frame.width) * frame.height;
+		size_t chromaSize = (yuv.size() - lumaSize) / 2;
+		memcpy(yuv.data(), frame.pixels.data(), lumaSize);
+		for (size_t i = 0; i < chromaSize; i++) {
+			yuv[lumaSize + i] = frame.pixels[lumaSize + i * 2];
+			yuv[lumaSize + chromaSize + i] = frame.pixels[lumaSize + i * 2 + 1];
+		}
+	}
+
+	stream.write((const char*)yuv.data(), yuv.size());
+	writtenFrames++;
+}
+
+void SgrFrameWriter::finish()
+{
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		if (finishing)
+			return;
+		finishing = true;
+	}
+	queueCondition.notify_all();
+
+	if (writerThread.joinable())
+		writerThread.join();
+
+	if (stream.is_open())
+		stream.close();
+}
+
+uint64_t SgrFrameWriter::getWrittenFramesCount()
+{
+	return writtenFrames;
+}
+
+uint64_t SgrFrameWriter::getDroppedFramesCount()
+{
+	return droppedFrames;
+}
@@ -0,0 +1,235 @@
+#include "HostAllocationTracker.h"
+
+#include <cstring>
+
+HostAllocationTracker* HostAllocationTracker::instance = nullptr;
+const VkAllocationCallbacks* HostAllocationTracker::allocator = nullptr;
+
+HostAllocationTracker::HostAllocationTracker() { ; }
+HostAllocationTracker::~HostAllocationTracker() { ; }
+
+// tracker is never destroyed, driver can free memory of instance level objects until process exit
+HostAllocationTracker* HostAllocationTracker::get()
+{
+	static std::once_flag created;
+	std::call_once(created, []() { instance = new HostAllocationTracker(); });
+	return instance;
+}
+
+void HostAllocationTracker::enable(uint32_t warmupFrames)
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+	if (allocator != nullptr)
+		return;
+
+	this->warmupFrames = warmupFrames;
+	stats.enabled = true;
+
+	callbacks.pUserData = this;
+	callbacks.pfnAllocation = allocationCallback;
+	callbacks.pfnReallocation = reallocationCallback;
+	callbacks.pfnFree = freeCallback;
+	callbacks.pfnInternalAllocation = internalAllocationCallback;
+	callbacks.pfnInternalFree = internalFreeCallback;
+	allocator = &callbacks;
+}
+
+bool HostAllocationTracker::isEnabled()
+{
+	return allocator != nullptr;
+}
+
+void HostAllocationTracker::beginFrame(uint64_t frameNumber)
+{
+	if (!isEnabled())
+		return;
+
+	std::unique_lock<std::mutex> lock(statsMutex);
+	inFrame = true;
+	currentFrame = frameNumber;
+	frameStartAllocations = stats.totalAllocations;
+	frameStartFrees = totalFrees;
+	frameStartBytes = totalBytesAllocated;
+}
+
+void HostAllocationTracker::endFrame()
+{
+	if (!isEnabled())
+		return;
+
+	std::unique_lock<std::mutex> lock(statsMutex);
+	inFrame = false;
+	stats.frameNumber = currentFrame;
+	stats.frameAllocations = static_cast<uint32_t>(stats.totalAllocations - frameStartAllocations);
+	stats.frameFrees = static_cast<uint32_t>(totalFrees - frameStartFrees);
+	stats.frameBytesAllocated = totalBytesAllocated - frameStartBytes;
+}
+
+SgrHostAllocationStats HostAllocationTracker::getStats()
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+std::vector<SgrHostAllocationEvent> HostAllocationTracker::getSteadyStateEvents()
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+	return std::vector<SgrHostAllocationEvent>(steadyStateEvents.begin(), steadyStateEvents.end());
+}
+
+void HostAllocationTracker::clearSteadyStateEvents()
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+	steadyStateEvents.clear();
+}
+
+const char* HostAllocationTracker::getScopeName(VkSystemAllocationScope scope)
+{
+	switch (scope) {
+		case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+		case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+		case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+		case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+		case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+		default: return "unknown";
+	}
+}
+
+void HostAllocationTracker::onAllocation(size_t size, size_t alignment, VkSystemAllocationScope scope, bool reallocation)
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+
+	SgrHostAllocationScopeStats& scopeStats = stats.scopes[scope];
+	scopeStats.liveBytes += size;
+	scopeStats.liveAllocations++;
+	scopeStats.totalAllocations++;
+	scopeStats.peakBytes = std::max(scopeStats.peakBytes, scopeStats.liveBytes);
+
+	stats.liveBytes += size;
+	stats.liveAllocations++;
+	stats.totalAllocations++;
+	stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+	totalBytesAllocated += size;
+
+	if (!inFrame || currentFrame <= warmupFrames)
+		return;
+
+	stats.steadyStateAllocations++;
+
+	SgrHostAllocationEvent event;
+	event.frameNumber = currentFrame;
+	event.size = size;
+	event.alignment = alignment;
+	event.scope = scope;
+	event.reallocation = reallocation;
+	steadyStateEvents.push_back(event);
+	if (steadyStateEvents.size() > eventsHistorySize)
+		steadyStateEvents.pop_front();
+}
+
+void HostAllocationTracker::onFree(size_t size, VkSystemAllocationScope scope)
+{
+	std::unique_lock<std::mutex> lock(statsMutex);
+
+	stats.scopes[scope].liveBytes -= size;
+	stats.scopes[scope].liveAllocations--;
+	stats.liveBytes -= size;
+	stats.liveAllocations--;
+	totalFrees++;
+}
+
+void* HostAllocationTracker::allocateBlock(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	// header must be aligned too and returned block keeps requested alignment
+	alignment = std::max(alignment, alignof(SgrAllocationHeader));
+	alignment = std::max(alignment, sizeof(void*));
+	size_t offset = (sizeof(SgrAllocationHeader) + alignment - 1) / alignment * alignment;
+
+	void* base = nullptr;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+	base = _aligned_malloc(offset + size, alignment);
+#else
+	if (posix_memalign(&base, alignment, offset + size) != 0)
+		base = nullptr;
+#endif
+	if (base == nullptr)
+		return nullptr;
+
+	void* memory = (char*)base + offset;
+	SgrAllocationHeader* header = getHeader(memory);
+	header->size = size;
+	header->offset = offset;
+	header->scope = scope;
+	return memory;
+}
+
+HostAllocationTracker::SgrAllocationHeader* HostAllocationTracker::getHeader(void* memory)
+{
+	return (SgrAllocationHeader*)memory - 1;
+}
+
+void HostAllocationTracker::freeBlock(void* memory)
+{
+	void* base = (char*)memory - getHeader(memory)->offset;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+	_aligned_free(base);
+#else
+	::free(base);
+#endif
+}
+
+void* VKAPI_PTR HostAllocationTracker::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	void* memory = allocateBlock(size, alignment, scope);
+	if (memory != nullptr)
+		((HostAllocationTracker*)userData)->onAllocation(size, alignment, scope, false);
+	return memory;
+}
+
+void* VKAPI_PTR HostAllocationTracker::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+	if (original == nullptr)
+		return allocationCallback(userData, size, alignment, scope);
+
+	if (size == 0) {
+		freeCallback(userData, original);
+		return nullptr;
+	}
+
+	void* memory = allocateBlock(size, alignment, scope);
+	if (memory == nullptr)
+		return nullptr; // original block stays valid
+
+	SgrAllocationHeader* originalHeader = getHeader(original);
+	memcpy(memory, original, std::min(size, originalHeader->size));
+	tracker->onFree(originalHeader->size, originalHeader->scope);
+	tracker->onAllocation(size, alignment, scope, true);
+	freeBlock(original);
+
+	return memory;
+}
+
+void VKAPI_PTR HostAllocationTracker::freeCallback(void* userData, void* memory)
+{
+	if (memory == nullptr)
+		return;
+
+	SgrAllocationHeader* header = getHeader(memory);
+	((HostAllocationTracker*)userData)->onFree(header->size, header->scope);
+	freeBlock(memory);
+}
+
+void VKAPI_PTR HostAllocationTracker::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+	std::unique_lock<std::mutex> lock(tracker->statsMutex);
+	tracker->stats.scopes[scope].internalBytes += size;
+}
+
+void VKAPI_PTR HostAllocationTracker::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	HostAllocationTracker* tracker = (HostAllocationTracker*)userData;
+	std::unique_lock<std::mutex> lock(tracker->statsMutex);
+	tracker->stats.scopes[scope].internalBytes -= size;
+}
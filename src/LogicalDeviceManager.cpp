@@ -1,5 +1,6 @@
 #include "LogicalDeviceManager.h"
 #include "PhysicalDeviceManager.h"
+#include "HostAllocationTracker.h"
 
 LogicalDeviceManager* LogicalDeviceManager::instance;
 
@@ -45,6 +46,21 @@ SgrErrCode LogicalDeviceManager::initLogicalDevice()
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &sgrDevice.deviceFeatures;
 
+    // extended dynamic state features are enabled only if extensions were picked with device
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features{};
+    eds3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    eds3Features.extendedDynamicState3PolygonMode = VK_TRUE;
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT eds1Features{};
+    eds1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    eds1Features.extendedDynamicState = VK_TRUE;
+
+    if (sgrDevice.extendedDynamicState) {
+        createInfo.pNext = &eds1Features;
+        if (sgrDevice.extendedDynamicState3PolygonMode)
+            eds1Features.pNext = &eds3Features;
+    }
+
     std::vector<const char*> enabledExtensions;
     uint32_t enabledExtensionsCount = static_cast<uint32_t>(physDeviceManager->getEnabledExtensions()->size());
     for (uint8_t i = 0; i < enabledExtensionsCount; i++) {
@@ -55,7 +71,7 @@ SgrErrCode LogicalDeviceManager::initLogicalDevice()
     createInfo.ppEnabledExtensionNames = enabledExtensions.data();
     createInfo.enabledLayerCount = 0;
 
-    if (vkCreateDevice(sgrDevice.vkPhysDevice, &createInfo, nullptr, &logicalDevice) != VK_SUCCESS)
+    if (vkCreateDevice(sgrDevice.vkPhysDevice, &createInfo, HostAllocationTracker::getAllocator(), &logicalDevice) != VK_SUCCESS)
         return sgrInitLogicalDeviceError;
 
     vkGetDeviceQueue(logicalDevice, sgrDevice.fixedGraphicsQueue.value(), 0, &graphicsQueue);
@@ -65,6 +81,6 @@ SgrErrCode LogicalDeviceManager::initLogicalDevice()
 
 void LogicalDeviceManager::destroy()
 {
-    vkDestroyDevice(logicalDevice, nullptr);
+    vkDestroyDevice(logicalDevice, HostAllocationTracker::getAllocator());
     delete instance;
 }
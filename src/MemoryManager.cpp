@@ -2,8 +2,12 @@
 #include "LogicalDeviceManager.h"
 #include "PhysicalDeviceManager.h"
 #include "CommandManager.h"
+#include "DeletionQueue.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
 
 MemoryManager* MemoryManager::instance;
+SgrRenderStats MemoryManager::frameStats;
 
 MemoryManager::MemoryManager() { ; }
 MemoryManager::~MemoryManager() { ; }
@@ -47,7 +51,7 @@ SgrErrCode MemoryManager::createBuffer(SgrBuffer*& buffer, VkDeviceSize size, Vk
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &newBuffer->vkBuffer) != VK_SUCCESS)
+    if (vkCreateBuffer(device, &bufferInfo, HostAllocationTracker::getAllocator(), &newBuffer->vkBuffer) != VK_SUCCESS)
         return sgrCreateVkBufferError;
 
     VkMemoryRequirements memRequirements;
@@ -64,9 +68,11 @@ SgrErrCode MemoryManager::createBuffer(SgrBuffer*& buffer, VkDeviceSize size, Vk
 
     allocInfo.memoryTypeIndex = memoryFindedIndex;
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &newBuffer->bufferMemory) != VK_SUCCESS) {
+    if (vkAllocateMemory(device, &allocInfo, HostAllocationTracker::getAllocator(), &newBuffer->bufferMemory) != VK_SUCCESS) {
         return sgrAllocateMemoryError;
     }
+    frameStats.allocations++;
+    registerAllocation(newBuffer->bufferMemory, memoryFindedIndex, memRequirements.size, size, getBufferCategory(usage));
 
     vkBindBufferMemory(device, newBuffer->vkBuffer, newBuffer->bufferMemory, 0);
 
@@ -77,12 +83,15 @@ SgrErrCode MemoryManager::createBuffer(SgrBuffer*& buffer, VkDeviceSize size, Vk
 
 void MemoryManager::copyDataToBuffer(SgrBuffer* buffer, void* data)
 {
+    SGR_TRACE_SCOPE("MemoryManager::copyDataToBuffer");
+
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
 
     void* tempDataPointer;
     vkMapMemory(device, buffer->bufferMemory, 0, buffer->size, 0, &tempDataPointer);
     memcpy(tempDataPointer, data, buffer->size);
     vkUnmapMemory(device, buffer->bufferMemory);
+    frameStats.bytesUploaded += buffer->size;
 }
 
 SgrErrCode MemoryManager::createStagingBufferWithData(SgrBuffer*& buffer, VkDeviceSize size, void* data)
@@ -100,6 +109,8 @@ SgrErrCode MemoryManager::createStagingBufferWithData(SgrBuffer*& buffer, VkDevi
 
 SgrErrCode MemoryManager::createBufferUsingStaging(SgrBuffer*& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, void* data)
 {
+    SGR_TRACE_SCOPE("MemoryManager::createBufferUsingStaging");
+
     SgrBuffer* stagingBuffer = nullptr;
     SgrErrCode resultInitStagingBuffer = createStagingBufferWithData(stagingBuffer, size, data);
     if (resultInitStagingBuffer != sgrOK)
@@ -117,11 +128,18 @@ SgrErrCode MemoryManager::createBufferUsingStaging(SgrBuffer*& buffer, VkDeviceS
 void MemoryManager::destroyBuffer(SgrBuffer* buffer)
 {
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
-    vkDestroyBuffer(device, buffer->vkBuffer, nullptr);
-    vkFreeMemory(device, buffer->bufferMemory, nullptr);
+    vkDestroyBuffer(device, buffer->vkBuffer, HostAllocationTracker::getAllocator());
+    unregisterAllocation(buffer->bufferMemory);
+    vkFreeMemory(device, buffer->bufferMemory, HostAllocationTracker::getAllocator());
     delete buffer;
 }
 
+void MemoryManager::releaseBuffer(SgrBuffer* buffer)
+{
+    allocatedBuffers.erase(std::remove(allocatedBuffers.begin(), allocatedBuffers.end(), buffer), allocatedBuffers.end());
+    DeletionQueue::get()->retireSgrBuffer(buffer);
+}
+
 void MemoryManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
     VkCommandBuffer commandBuffer = CommandManager::instance->beginSingleTimeCommands();
@@ -178,29 +196,6 @@ SgrErrCode MemoryManager::createDynamicUniformBuffer(SgrBuffer*& buffer, VkDevic
     return sgrOK;
 }
 
-void MemoryManager::copyBufferToImage(SgrBuffer* buffer, SgrImage* image) {
-    VkCommandBuffer commandBuffer = CommandManager::instance->beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = {
-        image->width,
-        image->height,
-        1
-    };
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer->vkBuffer, image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    CommandManager::instance->endSingleTimeCommands(commandBuffer);
-}
-
 SgrErrCode MemoryManager::createDynamicUniformMemory(SgrInstancesUniformBufferObject& dynamicUBO)
 {
     if (dynamicUBO.data != nullptr)
@@ -242,4 +237,121 @@ SgrErrCode MemoryManager::destroyAllocatedBuffers()
     }
 
     return sgrOK;
-}
\ No newline at end of file
+}
+SgrMemoryCategory MemoryManager::getBufferCategory(VkBufferUsageFlags usage)
+{
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+        return SGR_MEMORY_VERTEX;
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+        return SGR_MEMORY_INDEX;
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        return SGR_MEMORY_UNIFORM;
+    if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+        return SGR_MEMORY_STAGING;
+    // capture and batch buffers are only written by device and read by host
+    if (usage & (VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+        return SGR_MEMORY_READBACK;
+    return SGR_MEMORY_OTHER;
+}
+
+SgrMemoryCategory MemoryManager::getImageCategory(VkImageUsageFlags usage)
+{
+    if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        return SGR_MEMORY_RENDER_TARGET;
+    if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+        return SGR_MEMORY_TEXTURE;
+    return SGR_MEMORY_OTHER;
+}
+
+const char* MemoryManager::getMemoryCategoryName(SgrMemoryCategory category)
+{
+    switch (category) {
+        case SGR_MEMORY_VERTEX: return "vertex";
+        case SGR_MEMORY_INDEX: return "index";
+        case SGR_MEMORY_UNIFORM: return "uniform";
+        case SGR_MEMORY_TEXTURE: return "texture";
+        case SGR_MEMORY_STAGING: return "staging";
+        case SGR_MEMORY_RENDER_TARGET: return "render target";
+        case SGR_MEMORY_READBACK: return "readback";
+        default: return "other";
+    }
+}
+
+void MemoryManager::registerAllocation(VkDeviceMemory memory, uint32_t typeIndex, VkDeviceSize allocatedSize, VkDeviceSize usedSize, SgrMemoryCategory category)
+{
+    MemoryManager* manager = get();
+    std::unique_lock<std::mutex> lock(manager->memoryAllocationsMutex);
+    manager->memoryAllocations[memory] = { typeIndex, allocatedSize, std::min(usedSize, allocatedSize), category };
+}
+
+void MemoryManager::unregisterAllocation(VkDeviceMemory memory)
+{
+    MemoryManager* manager = get();
+    std::unique_lock<std::mutex> lock(manager->memoryAllocationsMutex);
+    manager->memoryAllocations.erase(memory);
+}
+
+static void addMemoryUsage(SgrMemoryUsage& usage, VkDeviceSize allocatedSize, VkDeviceSize usedSize)
+{
+    usage.allocations++;
+    usage.allocatedBytes += allocatedSize;
+    usage.usedBytes += usedSize;
+}
+
+SgrMemoryStats MemoryManager::getMemoryStats()
+{
+    SgrMemoryStats stats;
+
+    SgrPhysicalDevice& physDevice = PhysicalDeviceManager::instance->pickedPhysicalDevice;
+    stats.budgetSupported = physDevice.memoryBudget;
+    stats.allocationsLimit = physDevice.props.limits.maxMemoryAllocationCount;
+
+    // budget is changed by other processes too, so it is queried every time
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{};
+    budgetProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memProperties{};
+    memProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    if (stats.budgetSupported)
+        memProperties.pNext = &budgetProps;
+    vkGetPhysicalDeviceMemoryProperties2(physDevice.vkPhysDevice, &memProperties);
+
+    const VkPhysicalDeviceMemoryProperties& props = memProperties.memoryProperties;
+    stats.heaps.resize(props.memoryHeapCount);
+    for (uint32_t i = 0; i < props.memoryHeapCount; i++) {
+        stats.heaps[i].size = props.memoryHeaps[i].size;
+        stats.heaps[i].deviceLocal = (props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(memoryAllocationsMutex);
+        for (auto& allocation : memoryAllocations) {
+            const SgrMemoryAllocation& info = allocation.second;
+            SgrMemoryHeapStats& heap = stats.heaps[props.memoryTypes[info.typeIndex].heapIndex];
+            addMemoryUsage(heap.usage, info.allocatedSize, info.usedSize);
+            addMemoryUsage(heap.categories[info.category], info.allocatedSize, info.usedSize);
+            addMemoryUsage(stats.categories[info.category], info.allocatedSize, info.usedSize);
+            addMemoryUsage(stats.total, info.allocatedSize, info.usedSize);
+        }
+    }
+
+    for (uint32_t i = 0; i < props.memoryHeapCount; i++) {
+        SgrMemoryHeapStats& heap = stats.heaps[i];
+        heap.unusedBytes = heap.usage.allocatedBytes - heap.usage.usedBytes;
+        if (heap.usage.allocatedBytes > 0)
+            heap.fragmentation = float(heap.unusedBytes) / float(heap.usage.allocatedBytes);
+
+        if (stats.budgetSupported) {
+            heap.budget = budgetProps.heapBudget[i];
+            heap.processUsage = budgetProps.heapUsage[i];
+        }
+        else {
+            // without extension only SGR allocations are known, drivers usually allow most of heap
+            heap.budget = heap.size / 10 * 8;
+            heap.processUsage = heap.usage.allocatedBytes;
+        }
+        heap.available = heap.budget > heap.processUsage ? heap.budget - heap.processUsage : 0;
+    }
+
+    return stats;
+}
@@ -64,12 +64,12 @@ bool PhysicalDeviceManager::isSupportRequiredQueuesAndSurface(SgrPhysicalDevice&
 {
     uint8_t supportedQueues = 0;
     VkBool32 surfaceSupport = false;
-    uint8_t queueIndex = 0;
     for (auto reqQueue : requiredQueues) {
+        uint8_t queueIndex = 0;
         for (auto queueProp : device.queueFamilies) {
             if (queueProp.queueFlags & reqQueue) {
                 supportedQueues++;
-                if (!device.fixedGraphicsQueue.has_value() && surface != nullptr && reqQueue == VK_QUEUE_GRAPHICS_BIT) // if we need to check surface we should to save graphics queue index
+                if (!device.fixedGraphicsQueue.has_value() && reqQueue == VK_QUEUE_GRAPHICS_BIT) // we should to save graphics queue index
                     device.fixedGraphicsQueue = queueIndex;
             }
             if (surface != nullptr && !device.fixedPresentQueue.has_value()) {
@@ -77,15 +77,24 @@ bool PhysicalDeviceManager::isSupportRequiredQueuesAndSurface(SgrPhysicalDevice&
                 if (surfaceSupport)
                     device.fixedPresentQueue = queueIndex;
             }
-            if ((queueProp.queueFlags & reqQueue) && device.fixedPresentQueue.has_value())
+            if ((queueProp.queueFlags & reqQueue) && (surface == nullptr || device.fixedPresentQueue.has_value()))
                 break;
+            queueIndex++;
         }
     }
 
-    if (supportedQueues == requiredQueues.size() && device.fixedPresentQueue.has_value())
+    if (supportedQueues != requiredQueues.size())
+        return false;
+
+    // offscreen rendering doesn't present anything, graphics queue is used instead of present one
+    if (surface == nullptr) {
+        if (!device.fixedGraphicsQueue.has_value())
+            return false;
+        device.fixedPresentQueue = device.fixedGraphicsQueue;
         return true;
+    }
 
-    return false;
+    return device.fixedPresentQueue.has_value();
 }
 
 bool PhysicalDeviceManager::isSupportRequiredExtentions(SgrPhysicalDevice device, std::vector<std::string> requiredExtensions)
@@ -129,16 +138,26 @@ SgrErrCode PhysicalDeviceManager::findPhysicalDeviceRequired(std::vector<VkQueue
                                                             std::vector<std::string> requiredExtensions,
                                                             VkSurfaceKHR surface)
 {
+    // surface is null handle for offscreen rendering
+    bool offscreen = surface == VK_NULL_HANDLE;
     for (auto physDev : physicalDevices) {
-        if (isSupportRequiredQueuesAndSurface(physDev, requiredQueues, &surface) &&
+        if (isSupportRequiredQueuesAndSurface(physDev, requiredQueues, offscreen ? nullptr : &surface) &&
             isSupportRequiredExtentions(physDev, requiredExtensions) &&
-            isSupportAnySwapChainMode(physDev)) {
+            (offscreen || isSupportAnySwapChainMode(physDev))) {
                 
                 // if physical device support portability we MUST to add it to logical device extension
                 std::vector<std::string> portabilityExtension; portabilityExtension.push_back("VK_KHR_portability_subset");
                 if (isSupportRequiredExtentions(physDev, portabilityExtension))
                     requiredExtensions.push_back("VK_KHR_portability_subset");
 
+                setupExtendedDynamicStateSupport(physDev, requiredExtensions);
+
+                // optional, heap budgets are estimated without it
+                if (isSupportRequiredExtentions(physDev, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME })) {
+                    physDev.memoryBudget = true;
+                    requiredExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                }
+
                 pickedPhysicalDevice = physDev;
                 enabledExtensions = requiredExtensions;
                 vkGetPhysicalDeviceProperties(pickedPhysicalDevice.vkPhysDevice, &pickedPhysicalDevice.props);
@@ -148,6 +167,48 @@ SgrErrCode PhysicalDeviceManager::findPhysicalDeviceRequired(std::vector<VkQueue
     return sgrGPUNotFound;
 }
 
+void PhysicalDeviceManager::setupExtendedDynamicStateSupport(SgrPhysicalDevice& sgrDevice, std::vector<std::string>& requiredExtensions)
+{
+    // optional extensions, pipeline variants are used if they are missing
+    bool eds1Extension = isSupportRequiredExtentions(sgrDevice, { VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME });
+    bool eds3Extension = isSupportRequiredExtentions(sgrDevice, { VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME });
+    if (!eds1Extension)
+        return;
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features{};
+    eds3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT eds1Features{};
+    eds1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    eds1Features.pNext = eds3Extension ? &eds3Features : nullptr;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &eds1Features;
+    vkGetPhysicalDeviceFeatures2(sgrDevice.vkPhysDevice, &features2);
+
+    if (!eds1Features.extendedDynamicState)
+        return;
+
+    sgrDevice.extendedDynamicState = true;
+    requiredExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+    if (eds3Extension && eds3Features.extendedDynamicState3PolygonMode) {
+        sgrDevice.extendedDynamicState3PolygonMode = true;
+
+        VkPhysicalDeviceExtendedDynamicState3PropertiesEXT eds3Props{};
+        eds3Props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 props2{};
+        props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        props2.pNext = &eds3Props;
+        vkGetPhysicalDeviceProperties2(sgrDevice.vkPhysDevice, &props2);
+        sgrDevice.dynamicPrimitiveTopologyUnrestricted = eds3Props.dynamicPrimitiveTopologyUnrestricted;
+
+        requiredExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+}
+
 SgrPhysicalDevice PhysicalDeviceManager::getPickedPhysicalDevice()
 {
     return pickedPhysicalDevice;
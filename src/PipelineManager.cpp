@@ -2,6 +2,11 @@
 #include "SwapChainManager.h"
 #include "LogicalDeviceManager.h"
 #include "RenderPassManager.h"
+#include "PhysicalDeviceManager.h"
+#include "FileManager.h"
+#include "DeletionQueue.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
 
 PipelineManager* PipelineManager::instance = nullptr;
 
@@ -24,21 +29,181 @@ PipelineManager* PipelineManager::get()
 		return instance;
 }
 
-SgrErrCode PipelineManager::createAndAddPipeline(std::string name, ShaderManager::SgrShader objectShaders, DescriptorManager::SgrDescriptorInfo descriptorInfo, bool filled)
+SgrErrCode PipelineManager::createAndAddPipeline(std::string name, ShaderManager::SgrShader objectShaders, DescriptorManager::SgrDescriptorInfo descriptorInfo, SgrRenderState renderState,
+                                                 std::shared_future<SgrErrCode>* compilation)
 {
 	SgrPipeline* newPipeline = new SgrPipeline;
 	newPipeline->name = name;
-	newPipeline->filled = filled;
-    SgrErrCode resultCreatePipeline = createPipeline(objectShaders, descriptorInfo, *newPipeline);
-    if (resultCreatePipeline != sgrOK)
-        return resultCreatePipeline;
+	newPipeline->renderState = getPipelineKeyState(renderState);
+    newPipeline->compilation = compilePipelineAsync(objectShaders, descriptorInfo, newPipeline);
 	pipelines.push_back(newPipeline);
 
+    if (compilation != nullptr)
+        *compilation = newPipeline->compilation;
+
     return sgrOK;
 }
 
+std::shared_future<SgrErrCode> PipelineManager::compilePipelineAsync(ShaderManager::SgrShader objectShaders,
+                                                                     DescriptorManager::SgrDescriptorInfo descriptorInfo,
+                                                                     SgrPipeline* sgrPipeline)
+{
+    // worker writes only into its own pipeline handles, main thread reads them after the future became ready
+    sgrPipeline->ready = false;
+    sgrPipeline->failed = false;
+    return ThreadPool::get()->submit([this, objectShaders, descriptorInfo, sgrPipeline]() {
+        return createPipeline(objectShaders, descriptorInfo, *sgrPipeline);
+    });
+}
+
+bool PipelineManager::pollCompiledPipelines()
+{
+    bool newFinished = false;
+    for (size_t i = 1; i < pipelines.size(); i++) {
+        SgrPipeline* pipeline = pipelines[i];
+        if (pipeline->ready || !pipeline->compilation.valid())
+            continue;
+
+        if (pipeline->compilation.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        // failed pipeline stays not ready, commands rebuild reports it
+        pipeline->ready = pipeline->compilation.get() == sgrOK;
+        pipeline->failed = !pipeline->ready;
+        pipeline->compilation = std::shared_future<SgrErrCode>();
+        newFinished = true;
+    }
+
+    return newFinished;
+}
+
+void PipelineManager::retryPipeline(SgrPipeline* sgrPipeline)
+{
+    if (!sgrPipeline->failed)
+        return;
+
+    // handles created before failure are retired, variant is compiled again in background
+    if (sgrPipeline->pipeline != VK_NULL_HANDLE)
+        DeletionQueue::get()->retirePipeline(sgrPipeline->pipeline);
+    if (sgrPipeline->pipelineLayout != VK_NULL_HANDLE)
+        DeletionQueue::get()->retirePipelineLayout(sgrPipeline->pipelineLayout);
+    sgrPipeline->pipeline = VK_NULL_HANDLE;
+    sgrPipeline->pipelineLayout = VK_NULL_HANDLE;
+
+    sgrPipeline->compilation = compilePipelineAsync(ShaderManager::instance->getShadersByName(sgrPipeline->name),
+                                                    DescriptorManager::instance->getDescriptorInfoByName(sgrPipeline->name), sgrPipeline);
+}
+
+void PipelineManager::waitAllPipelines()
+{
+    for (size_t i = 1; i < pipelines.size(); i++) {
+        if (pipelines[i]->compilation.valid())
+            pipelines[i]->compilation.wait();
+    }
+
+    pollCompiledPipelines();
+}
+
+SgrErrCode PipelineManager::initDynamicStateSupport()
+{
+    SgrPhysicalDevice device = PhysicalDeviceManager::get()->getPickedPhysicalDevice();
+    VkDevice logicalDevice = LogicalDeviceManager::instance->logicalDevice;
+
+    dynamicStateSupport = SgrDynamicStateSupport{};
+    if (!device.extendedDynamicState)
+        return sgrOK;
+
+    dynamicStateSupport.cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(logicalDevice, "vkCmdSetCullModeEXT");
+    dynamicStateSupport.cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthTestEnableEXT");
+    dynamicStateSupport.cmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthWriteEnableEXT");
+    dynamicStateSupport.cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(logicalDevice, "vkCmdSetPrimitiveTopologyEXT");
+    dynamicStateSupport.extendedDynamicState = dynamicStateSupport.cmdSetCullMode && dynamicStateSupport.cmdSetDepthTestEnable &&
+                                               dynamicStateSupport.cmdSetDepthWriteEnable && dynamicStateSupport.cmdSetPrimitiveTopology;
+
+    if (dynamicStateSupport.extendedDynamicState && device.extendedDynamicState3PolygonMode) {
+        dynamicStateSupport.cmdSetPolygonMode = (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(logicalDevice, "vkCmdSetPolygonModeEXT");
+        dynamicStateSupport.polygonMode = dynamicStateSupport.cmdSetPolygonMode != nullptr;
+        dynamicStateSupport.topologyUnrestricted = device.dynamicPrimitiveTopologyUnrestricted;
+    }
+
+    return sgrOK;
+}
+
+bool PipelineManager::isRenderStateDynamic()
+{
+    return dynamicStateSupport.extendedDynamicState;
+}
+
+void PipelineManager::cmdSetRenderState(VkCommandBuffer commandBuffer, SgrRenderState renderState)
+{
+    if (dynamicStateSupport.extendedDynamicState) {
+        dynamicStateSupport.cmdSetCullMode(commandBuffer, renderState.cullMode);
+        dynamicStateSupport.cmdSetDepthTestEnable(commandBuffer, renderState.depthTest ? VK_TRUE : VK_FALSE);
+        dynamicStateSupport.cmdSetDepthWriteEnable(commandBuffer, renderState.depthWrite ? VK_TRUE : VK_FALSE);
+        dynamicStateSupport.cmdSetPrimitiveTopology(commandBuffer, renderState.topology);
+    }
+    if (dynamicStateSupport.polygonMode)
+        dynamicStateSupport.cmdSetPolygonMode(commandBuffer, renderState.polygonMode);
+}
+
+SgrRenderState PipelineManager::getPipelineKeyState(SgrRenderState state)
+{
+    // fields which are set dynamically are replaced with defaults, so one pipeline serves all their values
+    SgrRenderState defaultState;
+    if (dynamicStateSupport.extendedDynamicState) {
+        state.cullMode = defaultState.cullMode;
+        state.depthTest = defaultState.depthTest;
+        state.depthWrite = defaultState.depthWrite;
+
+        if (dynamicStateSupport.topologyUnrestricted)
+            state.topology = defaultState.topology;
+        else {
+            // without unrestricted support topology can be changed only inside of topology class
+            switch (state.topology) {
+            case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+                break;
+            case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+            case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+                state.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+                break;
+            default:
+                state.topology = defaultState.topology;
+                break;
+            }
+        }
+    }
+
+    if (dynamicStateSupport.polygonMode)
+        state.polygonMode = defaultState.polygonMode;
+
+    return state;
+}
+
+PipelineManager::SgrPipeline* PipelineManager::getPipelineVariant(std::string name, SgrRenderState state)
+{
+    SgrRenderState keyState = getPipelineKeyState(state);
+    for (size_t i = 1; i < pipelines.size(); i++) {
+        if (pipelines[i]->name == name && pipelines[i]->renderState == keyState)
+            return pipelines[i];
+    }
+
+    if (getPipelineByName(name)->name == "empty")
+        return pipelines[0];
+
+    // state without own pipeline yet, compile new variant in background
+    SgrPipeline* newVariant = new SgrPipeline;
+    newVariant->name = name;
+    newVariant->renderState = keyState;
+    newVariant->compilation = compilePipelineAsync(ShaderManager::instance->getShadersByName(name), DescriptorManager::instance->getDescriptorInfoByName(name), newVariant);
+    pipelines.push_back(newVariant);
+
+    return newVariant;
+}
+
 SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShaders, DescriptorManager::SgrDescriptorInfo descriptorInfo, SgrPipeline& sgrPipeline)
 {
+    SGR_TRACE_SCOPE("PipelineManager::createPipeline");
+
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -62,35 +227,39 @@ SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShader
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = sgrPipeline.renderState.topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)SwapChainManager::get()->getExtent().width;
-    viewport.height = (float)SwapChainManager::get()->getExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = SwapChainManager::get()->getExtent();
-
+    // viewport and scissor are set at command buffer recording, so pipeline doesn't depend on swapchain extent
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    if (dynamicStateSupport.extendedDynamicState) {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+    }
+    if (dynamicStateSupport.polygonMode)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = sgrPipeline.filled ? VK_POLYGON_MODE_FILL : VK_POLYGON_MODE_LINE;
+    rasterizer.polygonMode = sgrPipeline.renderState.polygonMode;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.cullMode = sgrPipeline.renderState.cullMode;
     rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -101,8 +270,8 @@ SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShader
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthTestEnable = sgrPipeline.renderState.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = sgrPipeline.renderState.depthWrite ? VK_TRUE : VK_FALSE;
 	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
 	depthStencil.depthBoundsTestEnable = VK_FALSE;
 	depthStencil.minDepthBounds = 0.0f; // Optional
@@ -137,7 +306,7 @@ SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShader
 
     VkDevice logicalDevice = LogicalDeviceManager::instance->logicalDevice;
 
-    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &sgrPipeline.pipelineLayout) != VK_SUCCESS)
+    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, HostAllocationTracker::getAllocator(), &sgrPipeline.pipelineLayout) != VK_SUCCESS)
         return sgrInitPipelineLayoutError;
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
@@ -151,12 +320,13 @@ SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShader
     pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = sgrPipeline.pipelineLayout;
     pipelineInfo.renderPass = RenderPassManager::instance->renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &sgrPipeline.pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineInfo, HostAllocationTracker::getAllocator(), &sgrPipeline.pipeline) != VK_SUCCESS)
         return sgrInitPipelineError;
 
     return sgrOK;
@@ -164,27 +334,66 @@ SgrErrCode PipelineManager::createPipeline(ShaderManager::SgrShader objectShader
 
 SgrErrCode PipelineManager::destroyAllPipelines()
 {
+    waitAllPipelines();
+
     for (size_t i = 1; i < pipelines.size(); i++) { // start with first because 0-th element is always empty (e.g. architecture)
-        vkDestroyPipeline(LogicalDeviceManager::instance->logicalDevice, pipelines[i]->pipeline, nullptr);
-        vkDestroyPipelineLayout(LogicalDeviceManager::instance->logicalDevice, pipelines[i]->pipelineLayout, nullptr);
+        vkDestroyPipeline(LogicalDeviceManager::instance->logicalDevice, pipelines[i]->pipeline, HostAllocationTracker::getAllocator());
+        vkDestroyPipelineLayout(LogicalDeviceManager::instance->logicalDevice, pipelines[i]->pipelineLayout, HostAllocationTracker::getAllocator());
+        pipelines[i]->pipeline = VK_NULL_HANDLE;
+        pipelines[i]->pipelineLayout = VK_NULL_HANDLE;
+        pipelines[i]->ready = false;
     }
 
     return sgrOK;
 }
 
+SgrErrCode PipelineManager::destroyPipelines(std::string name)
+{
+    bool found = false;
+    for (size_t i = 1; i < pipelines.size();) {
+        if (pipelines[i]->name != name) {
+            i++;
+            continue;
+        }
+
+        // background compilation writes into pipeline struct
+        if (pipelines[i]->compilation.valid())
+            pipelines[i]->compilation.wait();
+
+        // pipeline can be bound in frames in flight
+        if (pipelines[i]->pipeline != VK_NULL_HANDLE)
+            DeletionQueue::get()->retirePipeline(pipelines[i]->pipeline);
+        if (pipelines[i]->pipelineLayout != VK_NULL_HANDLE)
+            DeletionQueue::get()->retirePipelineLayout(pipelines[i]->pipelineLayout);
+
+        delete pipelines[i];
+        pipelines.erase(pipelines.begin() + i);
+        found = true;
+    }
+
+    return found ? sgrOK : sgrMissingPipeline;
+}
+
 SgrErrCode PipelineManager::reinitAllPipelines()
 {
+    // compile all pipelines concurrently and wait for them, swapchain recreation must end with ready pipelines
     size_t oldPipelineNum = pipelines.size();
     for (size_t i = 0; i < oldPipelineNum; i++) {
         if (pipelines[i]->name == "empty")
             continue;
 
-        SgrErrCode resultCreatePipline = createPipeline(ShaderManager::instance->getShadersByName(pipelines[i]->name), DescriptorManager::instance->getDescriptorInfoByName(pipelines[i]->name), *pipelines[i]);
-        if (resultCreatePipline != sgrOK)
-            return sgrReinitPipelineError;
+        pipelines[i]->compilation = compilePipelineAsync(ShaderManager::instance->getShadersByName(pipelines[i]->name), DescriptorManager::instance->getDescriptorInfoByName(pipelines[i]->name), pipelines[i]);
     }
 
-    return sgrOK;
+    SgrErrCode resultReinit = sgrOK;
+    for (size_t i = 0; i < oldPipelineNum; i++) {
+        if (pipelines[i]->compilation.valid() && pipelines[i]->compilation.get() != sgrOK)
+            resultReinit = sgrReinitPipelineError;
+    }
+
+    pollCompiledPipelines();
+
+    return resultReinit;
 }
 
 PipelineManager::SgrPipeline* PipelineManager::getPipelineByName(std::string name)
@@ -197,3 +406,88 @@ PipelineManager::SgrPipeline* PipelineManager::getPipelineByName(std::string nam
     return pipelines[0];
 }
 
+
+std::string PipelineManager::getPipelineCacheFilePath()
+{
+    std::string directory = pipelineCacheDirectory;
+    if (directory.empty())
+        directory = getExecutablePath();
+
+    return directory + "/" + pipelineCacheFileName;
+}
+
+bool PipelineManager::isPipelineCacheDataValid(const std::vector<char>& cacheData)
+{
+    if (cacheData.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+        return false;
+
+    VkPipelineCacheHeaderVersionOne header{};
+    memcpy(&header, cacheData.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+
+    if (header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+        return false;
+
+    // cache blob is valid only for the same vendor, device and driver build
+    VkPhysicalDeviceProperties props = PhysicalDeviceManager::get()->getPickedPhysicalDevice().props;
+    if (header.vendorID != props.vendorID || header.deviceID != props.deviceID)
+        return false;
+
+    if (memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        return false;
+
+    return true;
+}
+
+SgrErrCode PipelineManager::initPipelineCache()
+{
+    std::vector<char> cacheData;
+    if (FileManager::readFileIfExists(getPipelineCacheFilePath(), cacheData) && !isPipelineCacheDataValid(cacheData))
+        cacheData.clear(); // stale or foreign cache, start from scratch
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+    VkDevice logicalDevice = LogicalDeviceManager::instance->logicalDevice;
+    if (vkCreatePipelineCache(logicalDevice, &cacheInfo, HostAllocationTracker::getAllocator(), &pipelineCache) != VK_SUCCESS) {
+        // driver rejected initial data, try again with empty cache
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(logicalDevice, &cacheInfo, HostAllocationTracker::getAllocator(), &pipelineCache) != VK_SUCCESS)
+            return sgrInitPipelineCacheError;
+    }
+
+    return sgrOK;
+}
+
+SgrErrCode PipelineManager::savePipelineCache()
+{
+    if (pipelineCache == VK_NULL_HANDLE)
+        return sgrOK;
+
+    VkDevice logicalDevice = LogicalDeviceManager::instance->logicalDevice;
+
+    size_t cacheSize = 0;
+    if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &cacheSize, nullptr) != VK_SUCCESS || cacheSize == 0)
+        return sgrSavePipelineCacheError;
+
+    std::vector<char> cacheData(cacheSize);
+    if (vkGetPipelineCacheData(logicalDevice, pipelineCache, &cacheSize, cacheData.data()) != VK_SUCCESS)
+        return sgrSavePipelineCacheError;
+    cacheData.resize(cacheSize);
+
+    if (!FileManager::writeFile(getPipelineCacheFilePath(), cacheData))
+        return sgrSavePipelineCacheError;
+
+    return sgrOK;
+}
+
+void PipelineManager::destroyPipelineCache()
+{
+    if (pipelineCache == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyPipelineCache(LogicalDeviceManager::instance->logicalDevice, pipelineCache, HostAllocationTracker::getAllocator());
+    pipelineCache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,408 @@
+#include "QueryManager.h"
+#include "LogicalDeviceManager.h"
+#include "PhysicalDeviceManager.h"
+#include "CommandManager.h"
+#include "HostAllocationTracker.h"
+
+QueryManager* QueryManager::instance = nullptr;
+
+QueryManager::QueryManager() { ; }
+QueryManager::~QueryManager() { ; }
+
+QueryManager* QueryManager::get()
+{
+	if (instance == nullptr) {
+		instance = new QueryManager();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+bool QueryManager::isSupported()
+{
+	return supported;
+}
+
+bool QueryManager::isPipelineStatisticsSupported()
+{
+	return statisticsSupported;
+}
+
+SgrErrCode QueryManager::init()
+{
+	SgrPhysicalDevice device = PhysicalDeviceManager::get()->getPickedPhysicalDevice();
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device.vkPhysDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device.vkPhysDevice, &queueFamilyCount, queueFamilies.data());
+
+	// all supported features are enabled with logical device
+	statisticsSupported = device.deviceFeatures.pipelineStatisticsQuery == VK_TRUE;
+	preciseOcclusion = device.deviceFeatures.occlusionQueryPrecise == VK_TRUE;
+
+	uint32_t validBits = queueFamilies[device.fixedGraphicsQueue.value()].timestampValidBits;
+	if (validBits == 0 || device.props.limits.timestampPeriod <= 0.f) {
+		// timings are just not reported
+		supported = false;
+		return sgrOK;
+	}
+
+	timestampPeriod = device.props.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = 2;
+	if (vkCreateQueryPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, HostAllocationTracker::getAllocator(), &uploadPool) != VK_SUCCESS)
+		return sgrInitQueryPoolError;
+
+	supported = true;
+	return sgrOK;
+}
+
+SgrErrCode QueryManager::initFrameQueries(uint32_t commandBuffersCount)
+{
+	if (commandBuffersCount == buffersCount)
+		return sgrOK;
+
+	// swapchain may be recreated right after submit, last frame queries can be still in use
+	if (timestampPool != VK_NULL_HANDLE || statisticsPool != VK_NULL_HANDLE)
+		vkQueueWaitIdle(LogicalDeviceManager::instance->graphicsQueue);
+	destroyFrameQueries();
+
+	buffersCount = commandBuffersCount;
+	pendingFrames.assign(buffersCount, 0);
+	pendingUploads.assign(buffersCount, 0.f);
+
+	if (supported) {
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = commandBuffersCount * SGR_TIMESTAMP_COUNT;
+		if (vkCreateQueryPool(LogicalDeviceManager::instance->logicalDevice, &poolInfo, HostAllocationTracker::getAllocator(), &timestampPool) != VK_SUCCESS)
+			return sgrInitQueryPoolError;
+	}
+
+	if (statisticsEnabled)
+		return initStatisticsQueries();
+
+	return sgrOK;
+}
+
+void QueryManager::destroyFrameQueries()
+{
+	vkDestroyQueryPool(LogicalDeviceManager::instance->logicalDevice, timestampPool, HostAllocationTracker::getAllocator());
+	timestampPool = VK_NULL_HANDLE;
+	destroyStatisticsQueries();
+	buffersCount = 0;
+	pendingFrames.clear();
+	pendingUploads.clear();
+}
+
+SgrErrCode QueryManager::initStatisticsQueries()
+{
+	if (buffersCount == 0)
+		return sgrOK;
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = buffersCount * maxStatisticsSegments;
+	// results are written in order of bits
+	poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+								  VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+								  VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+								  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+								  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+								  VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+	if (vkCreateQueryPool(device, &poolInfo, HostAllocationTracker::getAllocator(), &statisticsPool) != VK_SUCCESS)
+		return sgrInitQueryPoolError;
+
+	poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+	poolInfo.pipelineStatistics = 0;
+	if (vkCreateQueryPool(device, &poolInfo, HostAllocationTracker::getAllocator(), &occlusionPool) != VK_SUCCESS)
+		return sgrInitQueryPoolError;
+
+	return sgrOK;
+}
+
+void QueryManager::destroyStatisticsQueries()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	vkDestroyQueryPool(device, statisticsPool, HostAllocationTracker::getAllocator());
+	vkDestroyQueryPool(device, occlusionPool, HostAllocationTracker::getAllocator());
+	statisticsPool = VK_NULL_HANDLE;
+	occlusionPool = VK_NULL_HANDLE;
+}
+
+SgrErrCode QueryManager::setStatisticsEnabled(bool enable)
+{
+	if (enable && !statisticsSupported)
+		return sgrQueryNotSupported;
+
+	if (enable == statisticsEnabled)
+		return sgrOK;
+
+	// pools are used by recorded commands of all in flight frames
+	vkQueueWaitIdle(LogicalDeviceManager::instance->graphicsQueue);
+
+	statisticsEnabled = enable;
+	clearStatisticsSegments();
+	if (!enable) {
+		destroyStatisticsQueries();
+		return sgrOK;
+	}
+
+	return initStatisticsQueries();
+}
+
+void QueryManager::clearStatisticsSegments()
+{
+	segmentGroups.clear();
+}
+
+int32_t QueryManager::addStatisticsSegment(const std::string& group)
+{
+	if (statisticsPool == VK_NULL_HANDLE || segmentGroups.size() >= maxStatisticsSegments)
+		return -1;
+
+	segmentGroups.push_back(group);
+	return static_cast<int32_t>(segmentGroups.size() - 1);
+}
+
+void QueryManager::recordSegmentBegin(int32_t segment)
+{
+	if (segment < 0)
+		return;
+
+	CommandManager* commandManager = CommandManager::get();
+	VkQueryControlFlags occlusionFlags = preciseOcclusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+	for (size_t i = 0; i < commandManager->commandBuffers.size(); i++) {
+		uint32_t query = static_cast<uint32_t>(i) * maxStatisticsSegments + segment;
+		commandManager->beginQuery(&statisticsPool, query, 0, static_cast<int16_t>(i));
+		commandManager->beginQuery(&occlusionPool, query, occlusionFlags, static_cast<int16_t>(i));
+	}
+}
+
+void QueryManager::recordSegmentEnd(int32_t segment)
+{
+	if (segment < 0)
+		return;
+
+	CommandManager* commandManager = CommandManager::get();
+	for (size_t i = 0; i < commandManager->commandBuffers.size(); i++) {
+		uint32_t query = static_cast<uint32_t>(i) * maxStatisticsSegments + segment;
+		commandManager->endQuery(&statisticsPool, query, static_cast<int16_t>(i));
+		commandManager->endQuery(&occlusionPool, query, static_cast<int16_t>(i));
+	}
+}
+
+void QueryManager::destroy()
+{
+	destroyFrameQueries();
+	vkDestroyQueryPool(LogicalDeviceManager::instance->logicalDevice, uploadPool, HostAllocationTracker::getAllocator());
+	delete instance;
+	instance = nullptr;
+}
+
+void QueryManager::resetFrameQueries(VkCommandBuffer commandBuffer, uint32_t bufferIndex)
+{
+	if (bufferIndex >= buffersCount)
+		return;
+
+	if (timestampPool != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(commandBuffer, timestampPool, bufferIndex * SGR_TIMESTAMP_COUNT, SGR_TIMESTAMP_COUNT);
+
+	if (statisticsPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, statisticsPool, bufferIndex * maxStatisticsSegments, maxStatisticsSegments);
+		vkCmdResetQueryPool(commandBuffer, occlusionPool, bufferIndex * maxStatisticsSegments, maxStatisticsSegments);
+	}
+}
+
+void QueryManager::writeTimestamp(VkCommandBuffer commandBuffer, uint32_t bufferIndex, SgrTimestamp timestamp)
+{
+	if (timestampPool == VK_NULL_HANDLE || bufferIndex >= buffersCount)
+		return;
+
+	VkPipelineStageFlagBits stage = timestamp == SGR_TIMESTAMP_FRAME_BEGIN ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	vkCmdWriteTimestamp(commandBuffer, stage, timestampPool, bufferIndex * SGR_TIMESTAMP_COUNT + timestamp);
+}
+
+void QueryManager::frameSubmitted(uint32_t bufferIndex, uint64_t frameNumber)
+{
+	if (bufferIndex >= buffersCount)
+		return;
+
+	pendingFrames[bufferIndex] = frameNumber;
+	pendingUploads[bufferIndex] = uploadTime;
+	uploadTime = 0.f;
+}
+
+float QueryManager::ticksToSeconds(uint64_t begin, uint64_t end)
+{
+	uint64_t ticks = (end - begin) & timestampMask;
+	return float(ticks * timestampPeriod * 1e-9);
+}
+
+void QueryManager::resolveFrames()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	// command buffers are recorded again right after this, so not ready results are dropped
+	for (uint32_t i = 0; i < buffersCount; i++) {
+		if (pendingFrames[i] == 0)
+			continue;
+
+		if (statisticsPool != VK_NULL_HANDLE)
+			resolveStatistics(i, pendingFrames[i]);
+
+		if (timestampPool == VK_NULL_HANDLE) {
+			pendingFrames[i] = 0;
+			continue;
+		}
+
+		std::array<uint64_t, SGR_TIMESTAMP_COUNT> ticks{};
+		VkResult result = vkGetQueryPoolResults(device, timestampPool, i * SGR_TIMESTAMP_COUNT, SGR_TIMESTAMP_COUNT,
+												sizeof(ticks), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS) {
+			SgrGpuFrameTimings timings;
+			timings.frameNumber = pendingFrames[i];
+			timings.frame = ticksToSeconds(ticks[SGR_TIMESTAMP_FRAME_BEGIN], ticks[SGR_TIMESTAMP_FRAME_END]);
+			timings.renderPass = ticksToSeconds(ticks[SGR_TIMESTAMP_FRAME_BEGIN], ticks[SGR_TIMESTAMP_RENDER_PASS_END]);
+			timings.scene = ticksToSeconds(ticks[SGR_TIMESTAMP_SCENE_BEGIN], ticks[SGR_TIMESTAMP_SCENE_END]);
+			timings.ui = ticksToSeconds(ticks[SGR_TIMESTAMP_SCENE_END], ticks[SGR_TIMESTAMP_UI_END]);
+			timings.readback = ticksToSeconds(ticks[SGR_TIMESTAMP_RENDER_PASS_END], ticks[SGR_TIMESTAMP_FRAME_END]);
+			timings.uploads = pendingUploads[i];
+
+			history.push_back(timings);
+			if (history.size() > historySize)
+				history.pop_front();
+		}
+
+		pendingFrames[i] = 0;
+	}
+}
+
+void QueryManager::resolveStatistics(uint32_t bufferIndex, uint64_t frameNumber)
+{
+	uint32_t segmentsCount = static_cast<uint32_t>(segmentGroups.size());
+	if (segmentsCount == 0)
+		return;
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	uint32_t firstQuery = bufferIndex * maxStatisticsSegments;
+
+	std::vector<uint64_t> statistics(segmentsCount * statisticsCount);
+	std::vector<uint64_t> samples(segmentsCount);
+	if (vkGetQueryPoolResults(device, statisticsPool, firstQuery, segmentsCount, statistics.size() * sizeof(uint64_t), statistics.data(),
+							  statisticsCount * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	if (vkGetQueryPoolResults(device, occlusionPool, firstQuery, segmentsCount, samples.size() * sizeof(uint64_t), samples.data(),
+							  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	SgrFramePipelineStats frameStats;
+	frameStats.frameNumber = frameNumber;
+	for (uint32_t i = 0; i < segmentsCount; i++) {
+		SgrPipelineStats stats;
+		uint64_t* values = &statistics[i * statisticsCount];
+		stats.inputVertices = values[0];
+		stats.inputPrimitives = values[1];
+		stats.vertexShaderInvocations = values[2];
+		stats.clippingInvocations = values[3];
+		stats.clippingPrimitives = values[4];
+		stats.fragmentShaderInvocations = values[5];
+		stats.samplesPassed = samples[i];
+
+		frameStats.total += stats;
+
+		// not neighbour instances of same group give several segments
+		auto group = std::find_if(frameStats.groups.begin(), frameStats.groups.end(),
+								  [&](const SgrQueryGroupStats& g) { return g.group == segmentGroups[i]; });
+		if (group == frameStats.groups.end())
+			frameStats.groups.push_back({ segmentGroups[i], stats });
+		else
+			group->stats += stats;
+	}
+
+	statisticsHistory.push_back(frameStats);
+	if (statisticsHistory.size() > historySize)
+		statisticsHistory.pop_front();
+}
+
+void QueryManager::beginUploadQueries(VkCommandBuffer commandBuffer)
+{
+	if (uploadPool == VK_NULL_HANDLE)
+		return;
+
+	vkCmdResetQueryPool(commandBuffer, uploadPool, 0, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, uploadPool, 0);
+}
+
+void QueryManager::endUploadQueries(VkCommandBuffer commandBuffer)
+{
+	if (uploadPool == VK_NULL_HANDLE)
+		return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, uploadPool, 1);
+}
+
+void QueryManager::resolveUploadQueries()
+{
+	if (uploadPool == VK_NULL_HANDLE)
+		return;
+
+	// single time commands are already waited by queue idle, results are available
+	std::array<uint64_t, 2> ticks{};
+	VkResult result = vkGetQueryPoolResults(LogicalDeviceManager::instance->logicalDevice, uploadPool, 0, 2,
+											sizeof(ticks), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result == VK_SUCCESS)
+		uploadTime += ticksToSeconds(ticks[0], ticks[1]);
+}
+
+bool QueryManager::getLastFrameTimings(SgrGpuFrameTimings& timings)
+{
+	if (history.empty())
+		return false;
+
+	timings = history.back();
+	return true;
+}
+
+bool QueryManager::getLastPipelineStats(SgrFramePipelineStats& stats)
+{
+	if (statisticsHistory.empty())
+		return false;
+
+	stats = statisticsHistory.back();
+	return true;
+}
+
+bool QueryManager::getPipelineStats(uint64_t frameNumber, SgrFramePipelineStats& stats)
+{
+	for (auto& frameStats : statisticsHistory) {
+		if (frameStats.frameNumber == frameNumber) {
+			stats = frameStats;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool QueryManager::getFrameTimings(uint64_t frameNumber, SgrGpuFrameTimings& timings)
+{
+	for (auto& frameTimings : history) {
+		if (frameTimings.frameNumber == frameNumber) {
+			timings = frameTimings;
+			return true;
+		}
+	}
+
+	return false;
+}
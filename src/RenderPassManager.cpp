@@ -1,6 +1,7 @@
 #include "RenderPassManager.h"
 #include "LogicalDeviceManager.h"
 #include "SwapChainManager.h"
+#include "HostAllocationTracker.h"
 
 RenderPassManager* RenderPassManager::instance = nullptr;
 
@@ -27,7 +28,8 @@ SgrErrCode RenderPassManager::init()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // offscreen image is copied to host after render pass instead of presentation
+    colorAttachment.finalLayout = SwapChainManager::get()->isOffscreen() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkFormat depthFormat;
 	VkAttachmentDescription depthAttachment{};
@@ -75,7 +77,7 @@ SgrErrCode RenderPassManager::init()
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(LogicalDeviceManager::instance->logicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    if (vkCreateRenderPass(LogicalDeviceManager::instance->logicalDevice, &renderPassInfo, HostAllocationTracker::getAllocator(), &renderPass) != VK_SUCCESS)
         return sgrInitRenderPassError;
 
 	return sgrOK;
@@ -83,7 +85,7 @@ SgrErrCode RenderPassManager::init()
 
 SgrErrCode RenderPassManager::destroyRenderPass()
 {
-    vkDestroyRenderPass(LogicalDeviceManager::instance->logicalDevice, renderPass, nullptr);
+    vkDestroyRenderPass(LogicalDeviceManager::instance->logicalDevice, renderPass, HostAllocationTracker::getAllocator());
     return sgrOK;
 }
 
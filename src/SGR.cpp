@@ -18,10 +18,7 @@ SGR::SGR(std::string appName, uint8_t appVersionMajor, uint8_t appVersionMinor)
 	applicationName = appName;
 	this->appVersionMajor = appVersionMajor;
 	this->appVersionMinor = appVersionMinor;
-#if ON_SCREEN_RENDER
 	requiredQueueFamilies.push_back(VK_QUEUE_GRAPHICS_BIT); // because graphics bit support also transfer bit
-	deviceRequiredExtensions.push_back("VK_KHR_swapchain");
-#endif
 #if __APPLE__
 	// since VulkanSDK 1.3.216 we should to add this
 	instanceRequiredExtensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
@@ -40,6 +37,12 @@ SGR::SGR(std::string appName, uint8_t appVersionMajor, uint8_t appVersionMinor)
 	renderPassManager = RenderPassManager::get();
 	shaderManager = ShaderManager::get();
 	uiManager = UIManager::get();
+	captureManager = CaptureManager::get();
+	batchManager = BatchManager::get();
+	queryManager = QueryManager::get();
+	deletionQueue = DeletionQueue::get();
+	textureLoader = TextureLoader::get();
+	textureStreamer = TextureStreamer::get();
 
 	SgrObject emptyObject;
 	emptyObject.name = "empty";
@@ -71,6 +74,9 @@ SgrErrCode SGR::init(uint32_t windowWidth, uint32_t windowHeight, const char *wi
 	if (window == nullptr)
 		return sgrInitWindowError;
 
+	offscreen = false;
+	deviceRequiredExtensions.push_back("VK_KHR_swapchain");
+
 	SgrErrCode resultInit = sgrOK;
 
 	resultInit = initVulkanInstance();
@@ -93,25 +99,23 @@ SgrErrCode SGR::init(uint32_t windowWidth, uint32_t windowHeight, const char *wi
 	if (resultInit != sgrOK)
 		return resultInit;
 
-	resultInit = swapChainManager->initSwapChain();
+	resultInit = pipelineManager->initDynamicStateSupport();
 	if (resultInit != sgrOK)
 		return resultInit;
 
-	maxFrameInFlight = swapChainManager->imageCount;
-
-	resultInit = renderPassManager->init();
+	resultInit = pipelineManager->initPipelineCache();
 	if (resultInit != sgrOK)
 		return resultInit;
 
-	resultInit = swapChainManager->initFrameBuffers();
+	resultInit = queryManager->init();
 	if (resultInit != sgrOK)
 		return resultInit;
 
-	resultInit = commandManager->initCommandBuffers();
+	resultInit = swapChainManager->initSwapChain();
 	if (resultInit != sgrOK)
 		return resultInit;
 
-	resultInit = initSyncObjects();
+	resultInit = initRenderTargets();
 	if (resultInit != sgrOK)
 		return resultInit;
 
@@ -126,26 +130,136 @@ SgrErrCode SGR::init(uint32_t windowWidth, uint32_t windowHeight, const char *wi
 	return sgrOK;
 }
 
+SgrErrCode SGR::initOffscreen(uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0)
+		return sgrInitOffscreenError;
+
+	offscreen = true;
+
+	SgrErrCode resultInit = sgrOK;
+
+	resultInit = initVulkanInstance();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = physicalDeviceManager->init(vulkanInstance);
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	// without surface any device with required queues is suitable, present support is not checked
+	resultInit = physicalDeviceManager->findPhysicalDeviceRequired(requiredQueueFamilies, deviceRequiredExtensions, VK_NULL_HANDLE);
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = logicalDeviceManager->initLogicalDevice();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = pipelineManager->initDynamicStateSupport();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = pipelineManager->initPipelineCache();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = queryManager->init();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = swapChainManager->initOffscreen(width, height);
+	if (resultInit != sgrOK)
+		return sgrInitOffscreenError;
+
+	resultInit = initRenderTargets();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	sgrRunning = true;
+	startRunningTime = SgrTime::now();
+
+	return sgrOK;
+}
+
+SgrErrCode SGR::initRenderTargets()
+{
+	maxFrameInFlight = swapChainManager->imageCount;
+
+	SgrErrCode resultInit = renderPassManager->init();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = swapChainManager->initFrameBuffers();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	resultInit = commandManager->initCommandBuffers();
+	if (resultInit != sgrOK)
+		return resultInit;
+
+	return initSyncObjects();
+}
+
+SgrErrCode SGR::resizeOffscreen(uint32_t width, uint32_t height)
+{
+	if (!offscreen || width == 0 || height == 0)
+		return sgrInitOffscreenError;
+
+	VkExtent2D extent = swapChainManager->extent;
+	if (extent.width == width && extent.height == height)
+		return sgrOK;
+
+	SgrErrCode resultReinit = swapChainManager->reinitOffscreen(width, height);
+	if (resultReinit != sgrOK)
+		return resultReinit;
+
+	// batch readback buffers and tiles are sized by render target
+	vkQueueWaitIdle(logicalDeviceManager->graphicsQueue);
+	batchManager->destroySlots();
+	batchManager->tileWidth = 0;
+	batchManager->tileHeight = 0;
+
+	return sgrOK;
+}
+
+bool SGR::isOffscreen()
+{
+	return offscreen;
+}
+
 SgrErrCode SGR::destroy()
 {
 	VkDevice device = logicalDeviceManager->logicalDevice;
 
 	vkDeviceWaitIdle(device);
+	pipelineManager->waitAllPipelines();
+	captureManager->stop(submittedFrame);
+	deletionQueue->destroy(); // device is idle, all retired objects can be destroyed
 
-	uiManager->destroy();
+	if (!offscreen)
+		uiManager->destroy();
 
 	for (uint8_t i = 0; i < maxFrameInFlight; i++) {
-		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-    	vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(device, inFlightFences[i], nullptr);
+		vkDestroySemaphore(device, imageAvailableSemaphores[i], HostAllocationTracker::getAllocator());
+    	vkDestroySemaphore(device, renderFinishedSemaphores[i], HostAllocationTracker::getAllocator());
+		vkDestroyFence(device, inFlightFences[i], HostAllocationTracker::getAllocator());
 	}
 
+	textureStreamer->destroy();
+	textureLoader->destroy();
 	TextureManager::destroyAllSamplers();
 	descriptorManager->destroyDescriptorsData();
 	shaderManager->destroy();
+	batchManager->destroy(); // slots command buffers are freed to command pool
 	commandManager->destroy();
+	queryManager->destroy();
 	renderPassManager->destroy();
 	pipelineManager->destroyAllPipelines();
+	pipelineManager->savePipelineCache();
+	pipelineManager->destroyPipelineCache();
+	ThreadPool::get()->destroy();
+	captureManager->destroy();
 	swapChainManager->destroy(vulkanInstance);
 	memoryManager->destroyAllocatedBuffers();
 	logicalDeviceManager->destroy();
@@ -154,12 +268,18 @@ SgrErrCode SGR::destroy()
 	if (validationLayersEnabled)
 		destroyDebugMessenger();
 
-	vkDestroyInstance(vulkanInstance, nullptr);
-	windowManager->destroy();
+	vkDestroyInstance(vulkanInstance, HostAllocationTracker::getAllocator());
+	if (!offscreen)
+		windowManager->destroy();
 
 	return sgrOK;
 }
 
+void SGR::setPipelineCacheDirectory(std::string directory)
+{
+	pipelineManager->pipelineCacheDirectory = directory;
+}
+
 SgrErrCode SGR::initSGRWindow(GLFWwindow* newWindow, const char* windowName)
 {
 	SgrErrCode resultCreateWindow = windowManager->init(newWindow, windowName);
@@ -175,43 +295,58 @@ SgrErrCode SGR::initSGRWindow(GLFWwindow* newWindow, const char* windowName)
 
 void SGR::setAspectRatio(uint8_t x, uint8_t y)
 {
+	if (offscreen)
+		return;
+
 	windowManager->setAspectRatio(x, y);
 }
 
 SgrErrCode SGR::drawFrame()
 {
-	SgrTime_t startDrawFrameTime = SgrTime::now();
+	// window callbacks can ask for frame while current one is in progress
+	if (frameDrawing)
+		return sgrOK;
 
-	drawDataUpdate();
+	SGR_TRACE_SCOPE("SGR::drawFrame");
 
-	vkQueueWaitIdle(logicalDeviceManager->graphicsQueue);
+	frameDrawing = true;
+	HostAllocationTracker::get()->beginFrame(submittedFrame + 1);
+	SgrErrCode res = renderFrame();
+	HostAllocationTracker::get()->endFrame();
+	frameDrawing = false;
 
+	return res;
+}
 
-	// start commands recording
-	SgrErrCode res = commandManager->beginCommandBuffers();
-	if (res != sgrOK)
-		return res;
-	
-	res = descriptorManager->updateDescriptorSets();
+SgrErrCode SGR::renderFrame()
+{
+	SgrTime_t startDrawFrameTime = SgrTime::now();
 
-	if (res != sgrOK && res != sgrDescriptorsSetsUpdated)
-		return res;
+	frameTimings = SgrFrameTimings();
+	if (frameCounted)
+		frameTimings.interval = getTimeDuration(lastFrameStartTime, startDrawFrameTime);
+	lastFrameStartTime = startDrawFrameTime;
 
-	if (!commandsBuilded || res == sgrDescriptorsSetsUpdated) {
-		res = buildDrawingCommands(res == sgrDescriptorsSetsUpdated);
-		if (res != sgrOK)
-			return res;
-	}
+	if (offscreen)
+		return renderOffscreenFrame();
 
-	commandManager->executeCommands();
-	uiManager->uiRender();
+	// all resize events since last frame are handled by one swapchain recreation
+	if (windowManager->windowResized && !windowManager->windowMinimized) {
+		windowManager->windowResized = false;
+		SgrErrCode resultRecreate = recreateSwapChain();
+		if (resultRecreate != sgrOK)
+			return resultRecreate;
+	}
 
-	// end commands recording
-	commandManager->endInitCommandBuffers();
+	SgrErrCode res = recordFrameCommands();
+	if (res != sgrOK)
+		return res;
 
 	if (windowManager->windowMinimized)
 		glfwWaitEvents();
 
+	SgrTime_t phaseStartTime = SgrTime::now();
+
 	vkWaitForFences(logicalDeviceManager->logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
 	uint32_t imageIndex;
@@ -220,12 +355,8 @@ SgrErrCode SGR::drawFrame()
 	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		unbindAllMeshesAndPiplines();
-		SgrErrCode reinitSwapChain = swapChainManager->reinitSwapChain();
-		if (reinitSwapChain != sgrOK) {
-			return reinitSwapChain;
-		}
-		imagesInFlight.resize(swapChainManager->imageCount, VK_NULL_HANDLE);
+		// recorded command buffers reference old framebuffers, so this frame is skipped
+		return recreateSwapChain();
 	}
 	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 		return sgrFailedToAcquireImage;
@@ -237,6 +368,9 @@ SgrErrCode SGR::drawFrame()
 	// Mark the image as now being in use by this frame
 	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
+	frameTimings.acquire += getTimeDuration(phaseStartTime, SgrTime::now());
+	phaseStartTime = SgrTime::now();
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -258,6 +392,16 @@ SgrErrCode SGR::drawFrame()
 	if (result != VK_SUCCESS)
 		return sgrQueueSubmitFailed;
 
+	submittedFrame++;
+	inFlightFrames[currentFrame] = submittedFrame;
+	deletionQueue->frameSubmitted(submittedFrame);
+	captureManager->frameSubmitted(submittedFrame);
+	queryManager->frameSubmitted(imageIndex, submittedFrame);
+	collectRenderStats(imageIndex);
+
+	frameTimings.submit = getTimeDuration(phaseStartTime, SgrTime::now());
+	phaseStartTime = SgrTime::now();
+
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
@@ -270,11 +414,13 @@ SgrErrCode SGR::drawFrame()
 	presentInfo.pResults = nullptr; // Optional
 
 	result = vkQueuePresentKHR(logicalDeviceManager->presentQueue, &presentInfo);
+	frameTimings.present = getTimeDuration(phaseStartTime, SgrTime::now());
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || windowManager->windowResized) {
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
 		windowManager->windowResized = false;
-		unbindAllMeshesAndPiplines();
-		swapChainManager->reinitSwapChain();
+		SgrErrCode resultRecreate = recreateSwapChain();
+		if (resultRecreate != sgrOK)
+			return resultRecreate;
 	}
 	else if (result != VK_SUCCESS) {
 		return sgrFailedPresentImage;
@@ -283,6 +429,7 @@ SgrErrCode SGR::drawFrame()
 	currentFrame = (currentFrame + 1) % maxFrameInFlight;
 
 	float drawFrameTime = getTimeDuration(startDrawFrameTime,SgrTime::now());
+	addFrameTimings(drawFrameTime);
 
 	if (drawFrameTime < 1.f/fpsDesired) {
 		#if __linux__ || __APPLE__
@@ -297,8 +444,289 @@ SgrErrCode SGR::drawFrame()
 	return sgrOK;
 }
 
+SgrErrCode SGR::recordFrameCommands()
+{
+	SGR_TRACE_SCOPE("SGR::recordFrameCommands");
+	SgrTime_t phaseStartTime = SgrTime::now();
+
+	if (drawDataUpdate)
+		drawDataUpdate();
+
+	frameTimings.update = getTimeDuration(phaseStartTime, SgrTime::now());
+	phaseStartTime = SgrTime::now();
+
+	// all swapchain command buffers are re-recorded below, so GPU is drained before every frame,
+	// waiting for it is counted as acquire, not recording
+	{
+		SGR_TRACE_SCOPE("vkQueueWaitIdle");
+		vkQueueWaitIdle(logicalDeviceManager->graphicsQueue);
+	}
+
+	frameTimings.acquire = getTimeDuration(phaseStartTime, SgrTime::now());
+	phaseStartTime = SgrTime::now();
+
+	uint64_t completedFrame = getCompletedFrame();
+	deletionQueue->destroyCompleted(completedFrame);
+	captureManager->deliverCompletedFrames(completedFrame);
+	queryManager->resolveFrames();
+
+	// drawn instances mark their streamed textures as used before residency is updated
+	if (textureStreamer->hasTextures())
+		for (auto& instance : instances)
+			if (instance.needToDraw)
+				descriptorManager->reportStreamedTexturesUsage(instance.name);
+
+	// uploaded textures replace placeholders in descriptor update below
+	SgrErrCode resultTextures = textureLoader->update();
+	if (resultTextures != sgrOK)
+		return resultTextures;
+
+	resultTextures = textureStreamer->update();
+	if (resultTextures != sgrOK)
+		return resultTextures;
+
+	// start commands recording
+	SgrErrCode res = commandManager->beginCommandBuffers();
+	if (res != sgrOK)
+		return res;
+	
+	res = descriptorManager->updateDescriptorSets();
+
+	if (res != sgrOK && res != sgrDescriptorsSetsUpdated)
+		return res;
+
+	// pipelines compiled or failed in background since last frame require commands rebuild
+	bool newPipelinesReady = pipelineManager->pollCompiledPipelines();
+
+	if (!commandsBuilded || commandsOutdated || res == sgrDescriptorsSetsUpdated || newPipelinesReady) {
+		res = buildDrawingCommands(commandsOutdated || res == sgrDescriptorsSetsUpdated || newPipelinesReady);
+		if (res != sgrOK)
+			return res;
+	}
+
+	commandManager->executeCommands();
+	if (!offscreen)
+		uiManager->uiRender();
+
+	res = captureManager->prepareFrame();
+	if (res != sgrOK)
+		return res;
+
+	// end commands recording
+	commandManager->endInitCommandBuffers();
+
+	frameTimings.recording = getTimeDuration(phaseStartTime, SgrTime::now());
+
+	return sgrOK;
+}
+
+void SGR::addFrameTimings(float frameTime)
+{
+	frameTimings.frameTime = frameTime;
+	if (!frameCounted)
+		frameTimings.interval = frameTime;
+	frameCounted = true;
+
+	frameStatistics.addFrame(frameTimings, 1.f / fpsDesired);
+}
+
+const SgrFrameStats& SGR::getFrameStats()
+{
+	return frameStatistics.getStats();
+}
+
+void SGR::setFrameStatsWindow(uint32_t framesCount)
+{
+	frameStatistics.setWindowSize(framesCount);
+}
+
+void SGR::resetFrameStats()
+{
+	frameStatistics.reset();
+	frameCounted = false;
+}
+
+SgrErrCode SGR::saveTrace(std::string path)
+{
+	return TraceManager::get()->saveChromeTrace(path);
+}
+
+void SGR::setTraceEnabled(bool enable)
+{
+	TraceManager::get()->setEnabled(enable);
+}
+
+SgrErrCode SGR::enableHostAllocationTracking(uint32_t warmupFrames)
+{
+	// objects created without allocator can't be destroyed with it
+	if (vulkanInstance != VK_NULL_HANDLE)
+		return sgrHostAllocationTrackingError;
+
+	HostAllocationTracker::get()->enable(warmupFrames);
+	return sgrOK;
+}
+
+SgrHostAllocationStats SGR::getHostAllocationStats()
+{
+	return HostAllocationTracker::get()->getStats();
+}
+
+std::vector<SgrHostAllocationEvent> SGR::getSteadyStateHostAllocations()
+{
+	return HostAllocationTracker::get()->getSteadyStateEvents();
+}
+
+SgrMemoryStats SGR::getMemoryStats()
+{
+	return memoryManager->getMemoryStats();
+}
+
+void SGR::collectRenderStats(uint32_t imageIndex)
+{
+	renderStats = SgrRenderStats();
+	if (imageIndex < commandManager->bufferStats.size())
+		renderStats = commandManager->bufferStats[imageIndex];
+	renderStats.frameNumber = submittedFrame;
+
+	renderStats += MemoryManager::frameStats;
+	renderStats.descriptorUpdates = descriptorManager->descriptorWritesCount;
+	renderStats.commandBuffersRecorded = commandManager->recordedBuffersCount;
+
+	MemoryManager::frameStats = SgrRenderStats();
+	descriptorManager->descriptorWritesCount = 0;
+	commandManager->recordedBuffersCount = 0;
+}
+
+const SgrRenderStats& SGR::getRenderStats()
+{
+	return renderStats;
+}
+
+SgrErrCode SGR::enablePipelineStatistics(bool enable)
+{
+	SgrErrCode res = queryManager->setStatisticsEnabled(enable);
+	if (res != sgrOK)
+		return res;
+
+	commandsOutdated = true;
+	return sgrOK;
+}
+
+SgrErrCode SGR::setInstanceQueryGroup(std::string instanceName, std::string group)
+{
+	SgrObjectInstance& instance = findInstanceByName(instanceName);
+	if (instance.name == "empty")
+		return sgrMissingInstance;
+
+	instance.queryGroup = group;
+	commandsOutdated = true;
+	return sgrOK;
+}
+
+bool SGR::getLastPipelineStats(SgrFramePipelineStats& stats)
+{
+	return queryManager->getLastPipelineStats(stats);
+}
+
+bool SGR::getPipelineStats(uint64_t frameNumber, SgrFramePipelineStats& stats)
+{
+	return queryManager->getPipelineStats(frameNumber, stats);
+}
+
+bool SGR::isGpuTimingSupported()
+{
+	return queryManager->isSupported();
+}
+
+bool SGR::getLastGpuFrameTimings(SgrGpuFrameTimings& timings)
+{
+	return queryManager->getLastFrameTimings(timings);
+}
+
+bool SGR::getGpuFrameTimings(uint64_t frameNumber, SgrGpuFrameTimings& timings)
+{
+	return queryManager->getFrameTimings(frameNumber, timings);
+}
+
+SgrErrCode SGR::renderOffscreenFrame()
+{
+	SgrErrCode res = recordFrameCommands();
+	if (res != sgrOK)
+		return res;
+
+	VkDevice device = logicalDeviceManager->logicalDevice;
+	SgrTime_t phaseStartTime = SgrTime::now();
+	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	frameTimings.acquire += getTimeDuration(phaseStartTime, SgrTime::now());
+	phaseStartTime = SgrTime::now();
+
+	// offscreen images are used in order, no acquire and present
+	uint32_t imageIndex = currentFrame;
+	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandManager->commandBuffers[imageIndex];
+
+	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+	if (vkQueueSubmit(logicalDeviceManager->graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+		return sgrQueueSubmitFailed;
+
+	submittedFrame++;
+	inFlightFrames[currentFrame] = submittedFrame;
+	deletionQueue->frameSubmitted(submittedFrame);
+	captureManager->frameSubmitted(submittedFrame);
+	queryManager->frameSubmitted(imageIndex, submittedFrame);
+	collectRenderStats(imageIndex);
+
+	frameTimings.submit = getTimeDuration(phaseStartTime, SgrTime::now());
+
+	currentFrame = (currentFrame + 1) % maxFrameInFlight;
+
+	// offscreen frames are not paced by fpsDesired
+	addFrameTimings(getTimeDuration(lastFrameStartTime, SgrTime::now()));
+
+	return sgrOK;
+}
+
+SgrErrCode SGR::recreateSwapChain()
+{
+	SGR_TRACE_SCOPE("SGR::recreateSwapChain");
+	uint32_t oldImageCount = swapChainManager->imageCount;
+
+	unbindAllMeshesAndPiplines();
+	SgrErrCode resultReinit = swapChainManager->reinitSwapChain();
+	if (resultReinit != sgrOK)
+		return resultReinit;
+
+	if (swapChainManager->imageCount != oldImageCount) {
+		commandsOutdated = true;
+		imagesInFlight.assign(swapChainManager->imageCount, VK_NULL_HANDLE);
+		uiManager->setImageCount(swapChainManager->imageCount);
+	}
+
+	return sgrOK;
+}
+
+uint64_t SGR::getCompletedFrame()
+{
+	// queue executes submissions in order, so signaled fence means all previous frames are completed too
+	uint64_t completedFrame = 0;
+	for (size_t i = 0; i < inFlightFences.size(); i++) {
+		if (vkGetFenceStatus(logicalDeviceManager->logicalDevice, inFlightFences[i]) == VK_SUCCESS)
+			completedFrame = std::max(completedFrame, inFlightFrames[i]);
+	}
+
+	return completedFrame;
+}
+
 bool SGR::isSGRRunning()
 {
+	if (offscreen)
+		return sgrRunning;
+
 	glfwPollEvents();
 
 	if (glfwWindowShouldClose(window))
@@ -312,6 +740,7 @@ SgrErrCode SGR::initSyncObjects()
 	imageAvailableSemaphores.resize(maxFrameInFlight);
 	renderFinishedSemaphores.resize(maxFrameInFlight);
 	inFlightFences.resize(maxFrameInFlight);
+	inFlightFrames.assign(maxFrameInFlight, 0);
 	imagesInFlight.resize(swapChainManager->imageCount, VK_NULL_HANDLE);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
@@ -322,9 +751,9 @@ SgrErrCode SGR::initSyncObjects()
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
 	for (size_t i = 0; i < maxFrameInFlight; i++) {
-		if (vkCreateSemaphore(logicalDeviceManager->logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(logicalDeviceManager->logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(logicalDeviceManager->logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+		if (vkCreateSemaphore(logicalDeviceManager->logicalDevice, &semaphoreInfo, HostAllocationTracker::getAllocator(), &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(logicalDeviceManager->logicalDevice, &semaphoreInfo, HostAllocationTracker::getAllocator(), &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(logicalDeviceManager->logicalDevice, &fenceInfo, HostAllocationTracker::getAllocator(), &inFlightFences[i]) != VK_SUCCESS) {
 			return sgrInitSyncObjectsError;
 		}
 	}
@@ -418,7 +847,8 @@ SgrErrCode SGR::initVulkanInstance()
 		createInfo.enabledLayerCount = 0;
 	}
 
-	addGlfwRequiredExtensions();
+	if (!offscreen)
+		addGlfwRequiredExtensions();
 	if (checkRequiredExtensionsSupport() != sgrOK)
 		return sgrExtensionNotSupport;
 
@@ -445,7 +875,7 @@ SgrErrCode SGR::initVulkanInstance()
 		createInfo.pNext = (void*)&debugMessengercreateInfo;
 	}
 
-	if (vkCreateInstance(&createInfo, nullptr, &vulkanInstance) != VK_SUCCESS) {
+	if (vkCreateInstance(&createInfo, HostAllocationTracker::getAllocator(), &vulkanInstance) != VK_SUCCESS) {
 		return sgrInitVulkanError;
 	}
 
@@ -453,7 +883,7 @@ SgrErrCode SGR::initVulkanInstance()
 		// loading function through the API
 		auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(vulkanInstance, "vkCreateDebugUtilsMessengerEXT");
 		if (func != nullptr) {
-			if (func(vulkanInstance, &debugMessengercreateInfo, nullptr, &debugMessenger) != VK_SUCCESS)
+			if (func(vulkanInstance, &debugMessengercreateInfo, HostAllocationTracker::getAllocator(), &debugMessenger) != VK_SUCCESS)
 				return sgrDebugMessengerCreationFailed;
 		} else {
 			return sgrExtensionNotSupport;
@@ -493,7 +923,8 @@ SgrErrCode SGR::addNewObjectGeometry(std::string name, std::vector<SgrVertex> ve
 									 std::string shaderVert, std::string shaderFrag, bool filled,
 									 std::vector<VkVertexInputBindingDescription> bindingDescriptions,
 									 std::vector<VkVertexInputAttributeDescription> attributDescrtions,
-									 std::vector<VkDescriptorSetLayoutBinding> setDescriptorSetsLayoutBinding)
+									 std::vector<VkDescriptorSetLayoutBinding> setDescriptorSetsLayoutBinding,
+									 std::shared_future<SgrErrCode>* pipelineReady)
 {
 	SgrObject newObject;
 	newObject.name = name;
@@ -529,7 +960,10 @@ SgrErrCode SGR::addNewObjectGeometry(std::string name, std::vector<SgrVertex> ve
 	newDescriptorInfo.setLayoutBinding = setDescriptorSetsLayoutBinding;
 	descriptorManager->addNewDescriptorInfo(newDescriptorInfo);
 
-	pipelineManager->createAndAddPipeline(name, objectShaders, newDescriptorInfo, filled);
+	newObject.renderState.polygonMode = filled ? VK_POLYGON_MODE_FILL : VK_POLYGON_MODE_LINE;
+	SgrErrCode resultCreatePipeline = pipelineManager->createAndAddPipeline(name, objectShaders, newDescriptorInfo, newObject.renderState, pipelineReady);
+	if (resultCreatePipeline != sgrOK)
+		return resultCreatePipeline;
 
 	objects.push_back(newObject);
 
@@ -562,6 +996,46 @@ SgrErrCode SGR::addObjectInstance(std::string name, std::string geometry, uint32
 	return sgrOK;
 }
 
+SgrErrCode SGR::removeObjectGeometry(std::string name)
+{
+	// 0-th element is empty object
+	size_t objectIndex = 1;
+	while (objectIndex < objects.size() && objects[objectIndex].name != name)
+		objectIndex++;
+	if (objectIndex == objects.size())
+		return sgrUnknownGeometry;
+
+	for (size_t i = 1; i < instances.size(); i++) {
+		if (instances[i].geometry == name)
+			return sgrGeometryInUse;
+	}
+
+	pipelineManager->destroyPipelines(name);
+	shaderManager->removeShaders(name);
+	descriptorManager->removeDescriptorInfo(name);
+	memoryManager->releaseBuffer(objects[objectIndex].vertices);
+	memoryManager->releaseBuffer(objects[objectIndex].indices);
+
+	objects.erase(objects.begin() + objectIndex);
+	commandsOutdated = true; // cached commands reference removed pipelines and buffers
+	return sgrOK;
+}
+
+SgrErrCode SGR::removeObjectInstance(std::string name)
+{
+	size_t instanceIndex = 1;
+	while (instanceIndex < instances.size() && instances[instanceIndex].name != name)
+		instanceIndex++;
+	if (instanceIndex == instances.size())
+		return sgrMissingInstance;
+
+	descriptorManager->destroyDescriptorSets(name);
+
+	instances.erase(instances.begin() + instanceIndex);
+	commandsOutdated = true;
+	return sgrOK;
+}
+
 SGR::SgrObject& SGR::findObjectByName(std::string name)
 {
 	for (size_t i = 0; i < objects.size(); i++) {
@@ -582,6 +1056,28 @@ SGR::SgrObjectInstance& SGR::findInstanceByName(std::string name)
 	return instances[0];
 }
 
+SgrErrCode SGR::setObjectRenderState(std::string geometry, SgrRenderState renderState)
+{
+	SgrObject& object = findObjectByName(geometry);
+	if (object.name == "empty")
+		return sgrUnknownGeometry;
+
+	object.renderState = renderState;
+	commandsOutdated = true;
+	return sgrOK;
+}
+
+SgrErrCode SGR::setInstanceRenderState(std::string instanceName, SgrRenderState renderState)
+{
+	SgrObjectInstance& instance = findInstanceByName(instanceName);
+	if (instance.name == "empty")
+		return sgrMissingInstance;
+
+	instance.renderState = renderState;
+	commandsOutdated = true;
+	return sgrOK;
+}
+
 SgrErrCode SGR::setupGlobalUniformBufferObject(SgrBuffer* uboBuffer)
 {
 	UBO = uboBuffer;
@@ -658,6 +1154,8 @@ bool SGR::setFPSDesired(uint8_t fps)
 
 SgrErrCode SGR::buildDrawingCommands(bool rebuild)
 {
+	SGR_TRACE_SCOPE("SGR::buildDrawingCommands");
+
 	if (rebuild) {
 		commandManager->freeCommandBuffers(true);
 
@@ -684,6 +1182,14 @@ SgrErrCode SGR::buildDrawingCommands(bool rebuild)
 		}
 	}
 
+	PipelineManager::SgrPipeline* boundPipeline = nullptr;
+	SgrRenderState recordedRenderState;
+	bool renderStateRecorded = false;
+
+	queryManager->clearStatisticsSegments();
+	int32_t querySegment = -1;
+	const std::string* querySegmentGroup = nullptr;
+
 	for (size_t i = 0; i < instances.size(); i++) {
 		const SgrObjectInstance& instance = instances[i];
 		if (instance.name == "empty") 
@@ -696,18 +1202,48 @@ SgrErrCode SGR::buildDrawingCommands(bool rebuild)
 		if (objectToDraw.name == "empty")
 			return sgrMissingObject;
 
-		PipelineManager::SgrPipeline* objectPipeline = pipelineManager->instance->getPipelineByName(instance.geometry);
+		SgrRenderState renderState = instance.renderState.value_or(objectToDraw.renderState);
+
+		// with extended dynamic state all render states share one pipeline, otherwise variant is used
+		PipelineManager::SgrPipeline* objectPipeline = pipelineManager->getPipelineVariant(instance.geometry, renderState);
 		if (objectPipeline->name == "empty")
 			return sgrMissingPipeline;
 
-		if (!objectToDraw.meshDataAndPiplineBinded) {
+		if (objectPipeline->failed) {
+			// partially built commands must not be executed, next frame rebuilds them with retried pipeline
+			pipelineManager->retryPipeline(objectPipeline);
+			commandsOutdated = true;
+			return sgrInitPipelineError;
+		}
+
+		if (!objectPipeline->ready)
+			continue; // pipeline is still compiling, commands will be rebuilt when it is ready
+
+		if (queryManager->statisticsEnabled && (querySegmentGroup == nullptr || *querySegmentGroup != instance.queryGroup)) {
+			queryManager->recordSegmentEnd(querySegment);
+			querySegment = queryManager->addStatisticsSegment(instance.queryGroup);
+			querySegmentGroup = &instance.queryGroup;
+			queryManager->recordSegmentBegin(querySegment);
+		}
+
+		if (objectPipeline != boundPipeline) {
 			commandManager->bindPipeline(&objectPipeline->pipeline);
+			boundPipeline = objectPipeline;
+		}
+
+		if (!objectToDraw.meshDataAndPiplineBinded) {
 			std::vector<VkBuffer> vertices{ objectToDraw.vertices->vkBuffer };
 			commandManager->bindVertexBuffer(vertices);
 			commandManager->bindIndexBuffer(objectToDraw.indices->vkBuffer);
 			objectToDraw.meshDataAndPiplineBinded = true;
 		}
 
+		if (pipelineManager->isRenderStateDynamic() && (!renderStateRecorded || renderState != recordedRenderState)) {
+			commandManager->setRenderState(renderState);
+			recordedRenderState = renderState;
+			renderStateRecorded = true;
+		}
+
 		DescriptorManager::SgrDescriptorSets descrSets = descriptorManager->getDescriptorSetsByName(instance.name);
 		if (descrSets.name == "empty")
 			return sgrMissingDescriptorSets;
@@ -720,7 +1256,66 @@ SgrErrCode SGR::buildDrawingCommands(bool rebuild)
 		commandManager->drawIndexed(objectToDraw.indicesCount, 1, 0, 0, 0);
 	}
 
+	queryManager->recordSegmentEnd(querySegment);
+
 	commandsBuilded = true;
+	commandsOutdated = false;
+
+	return sgrOK;
+}
+
+SgrErrCode SGR::recordInstanceDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex, std::string instanceName, PipelineManager::SgrPipeline*& boundPipeline,
+								   VkDescriptorSet descriptorSet, uint32_t dynamicOffset)
+{
+	SgrObjectInstance& instance = findInstanceByName(instanceName);
+	if (instance.name == "empty")
+		return sgrMissingInstance;
+
+	SgrObject& objectToDraw = findObjectByName(instance.geometry);
+	if (objectToDraw.name == "empty")
+		return sgrMissingObject;
+
+	SgrRenderState renderState = instance.renderState.value_or(objectToDraw.renderState);
+	PipelineManager::SgrPipeline* objectPipeline = pipelineManager->getPipelineVariant(instance.geometry, renderState);
+	if (objectPipeline->name == "empty")
+		return sgrMissingPipeline;
+
+	if (!objectPipeline->ready) {
+		// new variant was requested by this draw, batch can not skip it
+		pipelineManager->waitAllPipelines();
+		pipelineManager->pollCompiledPipelines();
+	}
+	if (objectPipeline->failed) {
+		pipelineManager->retryPipeline(objectPipeline);
+		return sgrInitPipelineError;
+	}
+	if (!objectPipeline->ready)
+		return sgrMissingPipeline;
+
+	DescriptorManager::SgrDescriptorSets descrSets = descriptorManager->getDescriptorSetsByName(instance.name);
+	if (descrSets.name == "empty")
+		return sgrMissingDescriptorSets;
+
+	if (objectPipeline != boundPipeline) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, objectPipeline->pipeline);
+		boundPipeline = objectPipeline;
+	}
+
+	if (pipelineManager->isRenderStateDynamic())
+		pipelineManager->cmdSetRenderState(commandBuffer, renderState);
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &objectToDraw.vertices->vkBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, objectToDraw.indices->vkBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+	if (descriptorSet == VK_NULL_HANDLE) {
+		descriptorSet = descrSets.descriptorSets[imageIndex];
+		dynamicOffset = instance.uboDataAlignment;
+	}
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, objectPipeline->pipelineLayout, 0, 1,
+							&descriptorSet, 1, &dynamicOffset);
+
+	vkCmdDrawIndexed(commandBuffer, objectToDraw.indicesCount, 1, 0, 0, 0);
 
 	return sgrOK;
 }
@@ -736,6 +1331,9 @@ SgrErrCode SGR::getWindow(GLFWwindow* &ptr)
 
 SgrErrCode SGR::setApplicationLogo(std::string path)
 {
+	if (offscreen)
+		return sgrInitWindowError;
+
 	GLFWimage icon;
 
 	icon.pixels = stbi_load(path.c_str(), &icon.width, &icon.height, 0, 4);
@@ -766,19 +1364,86 @@ SgrErrCode SGR::destroyDebugMessenger()
 	// loading function through the API
 	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT) vkGetInstanceProcAddr(vulkanInstance, "vkDestroyDebugUtilsMessengerEXT");
 	if (func != nullptr) {
-		func(vulkanInstance, debugMessenger, nullptr);
+		func(vulkanInstance, debugMessenger, HostAllocationTracker::getAllocator());
 		return sgrOK;
 	}
 
 	return sgrDebugMessengerDestructionFailed;
 }
 
+SgrErrCode SGR::startCapture(SgrCaptureCallback callback, void* userData, uint8_t slotCount, SgrCaptureFormat format)
+{
+	return captureManager->start(callback, userData, slotCount, format);
+}
+
+void SGR::setCaptureConversionShader(std::string spvPath)
+{
+	captureManager->conversionShaderPath = spvPath;
+}
+
+SgrErrCode SGR::stopCapture()
+{
+	// frames still in flight are delivered before readback buffers are released
+	vkQueueWaitIdle(logicalDeviceManager->graphicsQueue);
+	return captureManager->stop(submittedFrame);
+}
+
+SgrErrCode SGR::setBatchTileSize(uint32_t tileWidth, uint32_t tileHeight)
+{
+	return batchManager->setTileSize(tileWidth, tileHeight);
+}
+
+SgrErrCode SGR::submitRenderJob(SgrRenderJob job)
+{
+	if (!offscreen)
+		return sgrBatchRenderError;
+
+	// job data is copied with instance UBO stride
+	if (job.instancesData.data != nullptr &&
+		(dynamicUBO == nullptr || job.instancesData.instnaceCount < job.instances.size() || job.instancesData.dynamicAlignment != dynamicUBO->blockRange))
+		return sgrBatchRenderError;
+
+	batchManager->queue.push_back(job);
+	return sgrOK;
+}
+
+SgrErrCode SGR::renderJobs()
+{
+	if (!offscreen)
+		return sgrBatchRenderError;
+
+	// batches use offscreen images and descriptor sets of regular frames
+	vkQueueWaitIdle(logicalDeviceManager->graphicsQueue);
+
+	SgrErrCode res = descriptorManager->updateDescriptorSets();
+	if (res != sgrOK && res != sgrDescriptorsSetsUpdated)
+		return res;
+	if (res == sgrDescriptorsSetsUpdated)
+		commandsOutdated = true;
+
+	pipelineManager->waitAllPipelines();
+	pipelineManager->pollCompiledPipelines();
+
+	return batchManager->renderJobs(this);
+}
+
+SgrBatchStats SGR::getBatchStats()
+{
+	return batchManager->getStats();
+}
+
 SgrErrCode SGR::drawUIElement(SgrUIElement& uiElement)
 {
+	if (offscreen)
+		return sgrOK;
+
 	return uiManager->drawElement(uiElement);
 }
 
 void SGR::setupUICallback()
 {
+	if (offscreen)
+		return;
+
 	uiManager->setupUICallback();
 }
\ No newline at end of file
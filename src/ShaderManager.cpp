@@ -1,6 +1,7 @@
 #include "ShaderManager.h"
 #include "FileManager.h"
 #include "LogicalDeviceManager.h"
+#include "HostAllocationTracker.h"
 
 ShaderManager* ShaderManager::instance = nullptr;
 
@@ -26,7 +27,7 @@ VkShaderModule ShaderManager::createShader(std::string filePath)
     createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
 
     VkShaderModule shaderModule;
-    if (vkCreateShaderModule(LogicalDeviceManager::get()->getLogicalDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    if (vkCreateShaderModule(LogicalDeviceManager::get()->getLogicalDevice(), &createInfo, HostAllocationTracker::getAllocator(), &shaderModule) != VK_SUCCESS) {
         throw std::printf("Failed to create shader module from path %s", filePath.c_str());
     }
 
@@ -48,14 +49,25 @@ SgrErrCode ShaderManager::destroyShaders(std::string name)
     VkDevice device = LogicalDeviceManager::get()->getLogicalDevice();
     for (size_t i = 0; i < objectShaders.size(); i++) {
         if (objectShaders[i].name == name) {
-            vkDestroyShaderModule(device, objectShaders[i].vkShaders.vertex, nullptr);
-            vkDestroyShaderModule(device, objectShaders[i].vkShaders.fragment, nullptr);
+            vkDestroyShaderModule(device, objectShaders[i].vkShaders.vertex, HostAllocationTracker::getAllocator());
+            vkDestroyShaderModule(device, objectShaders[i].vkShaders.fragment, HostAllocationTracker::getAllocator());
             return sgrOK;
         }
     }
     return sgrShaderToDeleteNotFound;
 }
 
+SgrErrCode ShaderManager::removeShaders(std::string name)
+{
+    // modules are needed only for pipeline creation, they are destroyed immediately
+    SgrErrCode res = destroyShaders(name);
+    if (res != sgrOK)
+        return res;
+
+    objectShaders.erase(std::find_if(objectShaders.begin(), objectShaders.end(), [&name](const SgrShader& shader) { return shader.name == name; }));
+    return sgrOK;
+}
+
 SgrErrCode ShaderManager::destroyAllShaders()
 {
     for (auto shader : objectShaders) {
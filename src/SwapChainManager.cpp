@@ -6,6 +6,9 @@
 #include "CommandManager.h"
 #include "PipelineManager.h"
 #include "MemoryManager.h"
+#include "DeletionQueue.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
 
 SwapChainManager* SwapChainManager::instance = nullptr;
 
@@ -28,35 +31,42 @@ SwapChainManager* SwapChainManager::get()
 void SwapChainManager::destroy(VkInstance vKInstance)
 {
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
     for (size_t i = 0; i < framebuffers.size(); i++) {
-        vkDestroyFramebuffer(device, framebuffers[i], nullptr);
+        vkDestroyFramebuffer(device, framebuffers[i], HostAllocationTracker::getAllocator());
     }
 
     for (auto& img : createdImages) {
-        vkDestroyImage(device, *img.imgP, nullptr);
-        vkFreeMemory(device, *img.memP, nullptr);
+        vkDestroyImage(device, *img.imgP, HostAllocationTracker::getAllocator());
+        MemoryManager::unregisterAllocation(*img.memP);
+        vkFreeMemory(device, *img.memP, HostAllocationTracker::getAllocator());
     }
 
     for (auto& imgv : createdImageViews)
-        vkDestroyImageView(device, *imgv, nullptr);
+        vkDestroyImageView(device, *imgv, HostAllocationTracker::getAllocator());
 
 
     // destroy depth resources
-    vkDestroyImage(device, depthImage->vkImage, nullptr);
-    vkFreeMemory(device, depthImage->memory, nullptr);
-    vkDestroyImageView(device, depthImage->view, nullptr);
+    vkDestroyImage(device, depthImage->vkImage, HostAllocationTracker::getAllocator());
+    MemoryManager::unregisterAllocation(depthImage->memory);
+    vkFreeMemory(device, depthImage->memory, HostAllocationTracker::getAllocator());
+    vkDestroyImageView(device, depthImage->view, HostAllocationTracker::getAllocator());
 
     // destroy own image views
     for (size_t i = 0; i < imageViews.size(); i++) {
-        vkDestroyImageView(device, imageViews[i], nullptr);
+        vkDestroyImageView(device, imageViews[i], HostAllocationTracker::getAllocator());
     }
 
+    for (auto offscreenImage : offscreenImages)
+        delete offscreenImage;
+    offscreenImages.clear();
+
     createdImages.clear();
     createdImageViews.clear();
     images.clear();
     details.destroy();
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
-    vkDestroySurfaceKHR(vKInstance, surface, nullptr);
+    vkDestroySwapchainKHR(device, swapChain, HostAllocationTracker::getAllocator());
+    vkDestroySurfaceKHR(vKInstance, surface, HostAllocationTracker::getAllocator());
     delete instance;
 }
 
@@ -161,7 +171,7 @@ SgrErrCode SwapChainManager::createImageViews() {
 }
 
 
-SgrErrCode SwapChainManager::initSwapChain()
+SgrErrCode SwapChainManager::initSwapChain(VkSwapchainKHR oldSwapChain)
 {
     setupSwapChainProperties();
 
@@ -175,6 +185,9 @@ SgrErrCode SwapChainManager::initSwapChain()
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // allows frame capture by copying from swapchain image
+    if (details.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
     
     SgrPhysicalDevice ourDevice = PhysicalDeviceManager::get()->getPickedPhysicalDevice();
@@ -191,10 +204,10 @@ SgrErrCode SwapChainManager::initSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain; // driver can reuse resources of the old swapchain
 
     VkDevice logicalDevice = LogicalDeviceManager::get()->getLogicalDevice();
-    if (vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
+    if (vkCreateSwapchainKHR(logicalDevice, &createInfo, HostAllocationTracker::getAllocator(), &swapChain) != VK_SUCCESS)
         return sgrInitSwapChainError;
 
     vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, nullptr);
@@ -214,66 +227,148 @@ SgrErrCode SwapChainManager::initSwapChain()
     return sgrOK;
 }
 
-SgrErrCode SwapChainManager::cleanOldSwapChain()
+void SwapChainManager::retireSwapChain()
 {
-    VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+    DeletionQueue* deletionQueue = DeletionQueue::get();
+    deletionQueue->retireImageView(depthImage->view);
+    deletionQueue->retireImage(depthImage->vkImage);
+    deletionQueue->retireMemory(depthImage->memory);
+
+    for (auto framebuffer : framebuffers)
+        deletionQueue->retireFramebuffer(framebuffer);
+
+    for (auto view : imageViews)
+        deletionQueue->retireImageView(view);
+
+    if (swapChain != VK_NULL_HANDLE)
+        deletionQueue->retireSwapChain(swapChain);
+
+    // offscreen images memory is not released with all created images anymore, views are retired above
+    for (auto offscreenImage : offscreenImages) {
+        createdImages.erase(std::remove_if(createdImages.begin(), createdImages.end(),
+            [offscreenImage](const AllocatedImageData& img) { return img.imgP == &offscreenImage->vkImage; }), createdImages.end());
+        deletionQueue->retireImage(offscreenImage->vkImage);
+        deletionQueue->retireMemory(offscreenImage->memory);
+        delete offscreenImage;
+    }
+
+    offscreenImages.clear();
+    imageViews.clear();
+    framebuffers.clear();
+}
 
-    vkDestroyImageView(device, depthImage->view, nullptr);
-    vkDestroyImage(device, depthImage->vkImage, nullptr);
-    vkFreeMemory(device, depthImage->memory, nullptr);
+SgrErrCode SwapChainManager::reinitSwapChain()
+{
+    SGR_TRACE_SCOPE("SwapChainManager::reinitSwapChain");
 
-    for (size_t i = 0; i < framebuffers.size(); i++) {
-        vkDestroyFramebuffer(device, framebuffers[i], nullptr);
-    }
+    VkFormat oldImageFormat = imageFormat;
+    uint32_t oldImageCount = imageCount;
 
-    CommandManager::instance->freeCommandBuffers();
+    // old resources can still be used by frames in flight, they are destroyed later
+    VkSwapchainKHR oldSwapChain = swapChain;
+    retireSwapChain();
 
-    PipelineManager::instance->destroyAllPipelines();
+    if (initSwapChain(oldSwapChain) != sgrOK)
+        return sgrReinitSwapChainError;
 
-    RenderPassManager::instance->destroyRenderPass();
+    VkDevice device = LogicalDeviceManager::instance->logicalDevice;
 
-    for (size_t i = 0; i < imageViews.size(); i++) {
-        vkDestroyImageView(device, imageViews[i], nullptr);
+    // render pass and pipelines depend only on attachment formats, not on extent
+    if (imageFormat != oldImageFormat) {
+        vkDeviceWaitIdle(device); // rare case, pipelines can be in use by frames in flight
+        PipelineManager::instance->destroyAllPipelines();
+        RenderPassManager::instance->destroyRenderPass();
+
+        if (RenderPassManager::instance->init() != sgrOK)
+            return sgrReinitRenderPassError;
+
+        if (PipelineManager::instance->reinitAllPipelines() != sgrOK)
+            return sgrReinitPipelineError;
+    }
+
+    if (initFrameBuffers() != sgrOK)
+        return sgrReinitFrameBuffersError;
+
+    // command buffers are recorded per swapchain image, so they survive while image count is the same
+    if (imageCount != oldImageCount) {
+        vkDeviceWaitIdle(device); // rare case, command buffers can be pending
+        CommandManager::instance->freeCommandBuffers(true);
+        if (CommandManager::instance->initCommandBuffers() != sgrOK)
+            return sgrReinitCommandBuffersError;
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
     return sgrOK;
 }
 
-SgrErrCode SwapChainManager::reinitSwapChain()
+SgrErrCode SwapChainManager::reinitOffscreen(uint32_t width, uint32_t height)
 {
-    vkDeviceWaitIdle(LogicalDeviceManager::instance->logicalDevice);
-
-    SgrErrCode resultCleanOldSwapChain = cleanOldSwapChain();
-    if (resultCleanOldSwapChain != sgrOK)
-        return resultCleanOldSwapChain;
+    SGR_TRACE_SCOPE("SwapChainManager::reinitOffscreen");
 
-    if (initSwapChain() != sgrOK)
-        return sgrReinitSwapChainError;
+    // old images can still be used by frames in flight, they are destroyed later
+    retireSwapChain();
 
-    if (RenderPassManager::instance->init() != sgrOK)
-        return sgrReinitRenderPassError;
-
-    if (PipelineManager::instance->reinitAllPipelines() != sgrOK)
-        return sgrReinitPipelineError;
+    if (initOffscreen(width, height) != sgrOK)
+        return sgrInitOffscreenError;
 
+    // render pass, pipelines and command buffers do not depend on extent
     if (initFrameBuffers() != sgrOK)
         return sgrReinitFrameBuffersError;
 
-    if (CommandManager::instance->initCommandBuffers() != sgrOK)
-        return sgrReinitCommandBuffersError;
-
     return sgrOK;
 }
 
 SgrErrCode SwapChainManager::initSurface(VkInstance instance, GLFWwindow* window)
 {
-	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+	if (glfwCreateWindowSurface(instance, window, HostAllocationTracker::getAllocator(), &surface) != VK_SUCCESS) {
 		return sgrInitSurfaceError;
 	}
 	return sgrOK;
 }
 
+SgrErrCode SwapChainManager::initOffscreen(uint32_t width, uint32_t height)
+{
+    offscreen = true;
+    extent = { width, height };
+    imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    imageCount = offscreenImageCount;
+
+    images.resize(imageCount);
+    offscreenImages.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        SgrImage* colorImage = new SgrImage;
+        colorImage->width = width;
+        colorImage->height = height;
+        colorImage->format = imageFormat;
+        colorImage->tiling = VK_IMAGE_TILING_OPTIMAL;
+        colorImage->usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        colorImage->properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        colorImage->view = VK_NULL_HANDLE;
+        colorImage->sampler = VK_NULL_HANDLE;
+        offscreenImages[i] = colorImage;
+
+        // image memory is released with all created images
+        SgrErrCode resultCreateImage = createImage(colorImage);
+        if (resultCreateImage != sgrOK)
+            return resultCreateImage;
+
+        images[i] = colorImage->vkImage;
+    }
+
+    SgrErrCode resultInitImageViews = createImageViews();
+    if (resultInitImageViews != sgrOK)
+        return resultInitImageViews;
+
+    for (uint32_t i = 0; i < imageCount; i++)
+        offscreenImages[i]->view = imageViews[i];
+
+    return createDepthResources();
+}
+
+bool SwapChainManager::isOffscreen()
+{
+    return offscreen;
+}
+
 VkExtent2D SwapChainManager::getExtent()
 {
     return extent;
@@ -314,7 +409,7 @@ SgrErrCode SwapChainManager::initFrameBuffers()
         framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
+        if (vkCreateFramebuffer(logicalDevice, &framebufferInfo, HostAllocationTracker::getAllocator(), &framebuffers[i]) != VK_SUCCESS)
             return sgrInitFrameBuffersError;
     }
 
@@ -332,7 +427,7 @@ SgrErrCode SwapChainManager::createImage(SgrImage*& image)
     imageInfo.extent.width = image->width;
     imageInfo.extent.height = image->height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = image->mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = image->format;
     imageInfo.tiling = image->tiling;
@@ -342,7 +437,7 @@ SgrErrCode SwapChainManager::createImage(SgrImage*& image)
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     VkDevice device = LogicalDeviceManager::instance->logicalDevice;
-    if (vkCreateImage(device, &imageInfo, nullptr, &(image->vkImage)) != VK_SUCCESS)
+    if (vkCreateImage(device, &imageInfo, HostAllocationTracker::getAllocator(), &(image->vkImage)) != VK_SUCCESS)
         return sgrCreateImageError;
 
     AllocatedImageData newAllocatedImageData;
@@ -361,8 +456,11 @@ SgrErrCode SwapChainManager::createImage(SgrImage*& image)
         return resultSuitableMemoryIndex;
     allocInfo.memoryTypeIndex = memoryFindedIndex;
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &image->memory) != VK_SUCCESS)
+    if (vkAllocateMemory(device, &allocInfo, HostAllocationTracker::getAllocator(), &image->memory) != VK_SUCCESS)
         return sgrAllocateMemoryError;
+    MemoryManager::frameStats.allocations++;
+    // image size by format is not known here, whole allocation is counted as used
+    MemoryManager::registerAllocation(image->memory, memoryFindedIndex, memRequirements.size, memRequirements.size, MemoryManager::getImageCategory(image->usage));
 
     vkBindImageMemory(device, image->vkImage, image->memory, 0);
 
@@ -429,7 +527,7 @@ SgrErrCode SwapChainManager::transitionImageLayout(SgrImage* image, VkImageLayou
 }
 
 
-SgrErrCode SwapChainManager::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView)
+SgrErrCode SwapChainManager::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView, uint32_t mipLevels)
 {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -438,11 +536,11 @@ SgrErrCode SwapChainManager::createImageView(VkImage image, VkFormat format, VkI
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(LogicalDeviceManager::instance->logicalDevice, &viewInfo, nullptr, imageView) != VK_SUCCESS)
+    if (vkCreateImageView(LogicalDeviceManager::instance->logicalDevice, &viewInfo, HostAllocationTracker::getAllocator(), imageView) != VK_SUCCESS)
         return sgrInitImageViews;
 
     createdImageViews.push_back(imageView);
@@ -0,0 +1,273 @@
+#include <stb_image.h>
+
+#include "TextureAtlas.h"
+#include "TextureManager.h"
+#include "Trace.h"
+
+#include <cmath>
+
+SgrTextureAtlas::SgrTextureAtlas(uint32_t pageSize, uint32_t padding, bool mipmaps) :
+	pageSize(pageSize), padding(padding), mipmaps(mipmaps) { ; }
+
+SgrTextureAtlas::~SgrTextureAtlas() { ; }
+
+SgrErrCode SgrTextureAtlas::addSprite(std::string name, void* rgbaPixels, uint32_t width, uint32_t height, SgrAtlasSprite& sprite)
+{
+	if (getSprite(name, sprite))
+		return sgrOK;
+
+	if (rgbaPixels == nullptr || width == 0 || height == 0)
+		return sgrLoadImageError;
+
+	// cells are multiples of deepest mip block, so every sprite starts on block boundary: skyline starts at 0
+	// and its edges are sums of cell sizes
+	uint32_t alignment = 1u << (getPageLevels() - 1);
+	uint32_t paddedWidth = (width + 2 * padding + alignment - 1) / alignment * alignment;
+	uint32_t paddedHeight = (height + 2 * padding + alignment - 1) / alignment * alignment;
+	if (paddedWidth > pageSize || paddedHeight > pageSize)
+		return sgrAtlasSpriteTooLarge;
+
+	// first page with free place, new page is started only when all are full
+	size_t pageIndex = 0;
+	size_t nodeIndex = 0;
+	uint32_t y = 0;
+	while (pageIndex < pages.size() && !findPosition(pages[pageIndex], paddedWidth, paddedHeight, nodeIndex, y))
+		pageIndex++;
+
+	if (pageIndex == pages.size()) {
+		addPage();
+		findPosition(pages[pageIndex], paddedWidth, paddedHeight, nodeIndex, y);
+	}
+
+	SgrAtlasPage& page = pages[pageIndex];
+	uint32_t x = page.skyline[nodeIndex].x;
+	insertNode(page, nodeIndex, paddedWidth, paddedHeight, y);
+	copySprite(page, static_cast<const uint8_t*>(rgbaPixels), width, height, x, y, paddedWidth, paddedHeight);
+
+	sprite.page = static_cast<uint32_t>(pageIndex);
+	sprite.width = width;
+	sprite.height = height;
+	sprite.startText = glm::vec2(float(x + padding) / pageSize, float(y + padding) / pageSize);
+	sprite.endText = glm::vec2(float(x + padding + width) / pageSize, float(y + padding + height) / pageSize);
+	sprites[name] = sprite;
+
+	return sgrOK;
+}
+
+SgrErrCode SgrTextureAtlas::addSpriteFromFile(std::string name, std::string path, SgrAtlasSprite& sprite)
+{
+	if (getSprite(name, sprite))
+		return sgrOK;
+
+	int texWidth, texHeight, texChannels;
+	stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (!pixels)
+		return sgrLoadImageError;
+
+	SgrErrCode result = addSprite(name, pixels, texWidth, texHeight, sprite);
+	stbi_image_free(pixels);
+	return result;
+}
+
+bool SgrTextureAtlas::getSprite(std::string name, SgrAtlasSprite& sprite)
+{
+	auto it = sprites.find(name);
+	if (it == sprites.end())
+		return false;
+
+	sprite = it->second;
+	return true;
+}
+
+void SgrTextureAtlas::addPage()
+{
+	SgrAtlasPage page;
+	page.skyline.push_back({ 0, 0, pageSize });
+	page.pixels.resize(size_t(pageSize) * pageSize * 4, 0);
+	pages.push_back(std::move(page));
+}
+
+bool SgrTextureAtlas::fitsAtNode(const SgrAtlasPage& page, size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& y)
+{
+	if (page.skyline[nodeIndex].x + width > pageSize)
+		return false;
+
+	// rectangle lays on highest node under it
+	y = 0;
+	uint32_t widthLeft = width;
+	for (size_t i = nodeIndex; widthLeft > 0; i++) {
+		y = std::max(y, page.skyline[i].y);
+		if (y + height > pageSize)
+			return false;
+		widthLeft -= std::min(widthLeft, page.skyline[i].width);
+	}
+
+	return true;
+}
+
+bool SgrTextureAtlas::findPosition(const SgrAtlasPage& page, uint32_t width, uint32_t height, size_t& nodeIndex, uint32_t& y)
+{
+	bool found = false;
+	uint32_t bestBottom = UINT32_MAX;
+	uint32_t bestWidth = UINT32_MAX;
+
+	// bottom-left rule: lowest resulting top edge, then narrowest node
+	for (size_t i = 0; i < page.skyline.size(); i++) {
+		uint32_t nodeY;
+		if (!fitsAtNode(page, i, width, height, nodeY))
+			continue;
+
+		uint32_t bottom = nodeY + height;
+		if (bottom < bestBottom || (bottom == bestBottom && page.skyline[i].width < bestWidth)) {
+			found = true;
+			bestBottom = bottom;
+			bestWidth = page.skyline[i].width;
+			nodeIndex = i;
+			y = nodeY;
+		}
+	}
+
+	return found;
+}
+
+void SgrTextureAtlas::insertNode(SgrAtlasPage& page, size_t nodeIndex, uint32_t width, uint32_t height, uint32_t y)
+{
+	std::vector<SgrSkylineNode>& skyline = page.skyline;
+	SgrSkylineNode node = { skyline[nodeIndex].x, y + height, width };
+	skyline.insert(skyline.begin() + nodeIndex, node);
+
+	// nodes covered by new one are cut or removed
+	size_t i = nodeIndex + 1;
+	while (i < skyline.size()) {
+		uint32_t previousEnd = skyline[i - 1].x + skyline[i - 1].width;
+		if (skyline[i].x >= previousEnd)
+			break;
+
+		uint32_t shrink = previousEnd - skyline[i].x;
+		if (skyline[i].width <= shrink) {
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		break;
+	}
+
+	for (size_t j = 0; j + 1 < skyline.size();) {
+		if (skyline[j].y == skyline[j + 1].y) {
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + j + 1);
+		}
+		else
+			j++;
+	}
+}
+
+void SgrTextureAtlas::copySprite(SgrAtlasPage& page, const uint8_t* rgbaPixels, uint32_t width, uint32_t height, uint32_t x, uint32_t y,
+								 uint32_t cellWidth, uint32_t cellHeight)
+{
+	// padding and alignment tail repeat edge texels, so filtering and mips near sprite border don't pick neighbours
+	for (uint32_t row = 0; row < cellHeight; row++) {
+		uint32_t srcRow = std::min(row >= padding ? row - padding : 0, height - 1);
+		uint8_t* dst = page.pixels.data() + (size_t(y + row) * pageSize + x) * 4;
+		const uint8_t* src = rgbaPixels + size_t(srcRow) * width * 4;
+
+		for (uint32_t column = 0; column < padding; column++)
+			memcpy(dst + column * 4, src, 4);
+		memcpy(dst + padding * 4, src, size_t(width) * 4);
+		for (uint32_t column = padding + width; column < cellWidth; column++)
+			memcpy(dst + column * 4, src + size_t(width - 1) * 4, 4);
+	}
+
+	int32_t right = static_cast<int32_t>(x + cellWidth);
+	int32_t bottom = static_cast<int32_t>(y + cellHeight);
+	if (!page.dirty) {
+		page.dirtyMin = { static_cast<int32_t>(x), static_cast<int32_t>(y) };
+		page.dirtyMax = { right, bottom };
+		page.dirty = true;
+		return;
+	}
+
+	page.dirtyMin.x = std::min(page.dirtyMin.x, static_cast<int32_t>(x));
+	page.dirtyMin.y = std::min(page.dirtyMin.y, static_cast<int32_t>(y));
+	page.dirtyMax.x = std::max(page.dirtyMax.x, right);
+	page.dirtyMax.y = std::max(page.dirtyMax.y, bottom);
+}
+
+SgrErrCode SgrTextureAtlas::uploadPage(SgrAtlasPage& page)
+{
+	if (page.image == nullptr) {
+		uint32_t levels = getPageLevels();
+
+		page.image = new SgrImage;
+		page.image->mipLevels = levels;
+		SgrErrCode resultInitTextureImage = TextureManager::initTextureImage(page.image, pageSize, pageSize, VK_FORMAT_R8G8B8A8_SRGB, levels > 1);
+		if (resultInitTextureImage != sgrOK)
+			return resultInitTextureImage;
+
+		page.dirty = false;
+		return TextureManager::updateTextureRegion(page.image, page.pixels.data(), { 0, 0 }, { pageSize, pageSize }, false);
+	}
+
+	VkExtent2D extent = { static_cast<uint32_t>(page.dirtyMax.x - page.dirtyMin.x), static_cast<uint32_t>(page.dirtyMax.y - page.dirtyMin.y) };
+	std::vector<uint8_t> region(size_t(extent.width) * extent.height * 4);
+	for (uint32_t row = 0; row < extent.height; row++)
+		memcpy(region.data() + size_t(row) * extent.width * 4,
+			   page.pixels.data() + (size_t(page.dirtyMin.y + row) * pageSize + page.dirtyMin.x) * 4, size_t(extent.width) * 4);
+
+	page.dirty = false;
+	return TextureManager::updateTextureRegion(page.image, region.data(), page.dirtyMin, extent, true);
+}
+
+uint32_t SgrTextureAtlas::getPageLevels()
+{
+	// level k averages 2^k texels, deeper levels would mix sprites through padding
+	return (mipmaps && padding > 1) ? static_cast<uint32_t>(std::floor(std::log2(padding))) + 1 : 1;
+}
+
+SgrErrCode SgrTextureAtlas::flush()
+{
+	SGR_TRACE_SCOPE("SgrTextureAtlas::flush");
+
+	for (SgrAtlasPage& page : pages) {
+		if (page.image != nullptr && !page.dirty)
+			continue;
+
+		SgrErrCode resultUpload = uploadPage(page);
+		if (resultUpload != sgrOK)
+			return resultUpload;
+	}
+
+	return sgrOK;
+}
+
+uint32_t SgrTextureAtlas::getPageCount()
+{
+	return static_cast<uint32_t>(pages.size());
+}
+
+SgrImage* SgrTextureAtlas::getPageImage(uint32_t page)
+{
+	if (page >= pages.size())
+		return nullptr;
+
+	return pages[page].image;
+}
+
+void SgrTextureAtlas::getInstanceTexCoords(const SgrAtlasSprite& sprite, glm::vec2 startMesh, glm::vec2 endMesh, glm::vec2& startText, glm::vec2& deltaText)
+{
+	startText = sprite.startText;
+	deltaText.x = (sprite.endText.x - sprite.startText.x) / (endMesh.x - startMesh.x);
+	deltaText.y = (sprite.endText.y - sprite.startText.y) / (endMesh.y - startMesh.y);
+}
+
+void SgrTextureAtlas::destroy()
+{
+	for (SgrAtlasPage& page : pages)
+		if (page.image != nullptr)
+			TextureManager::destroyTextureImage(page.image);
+
+	pages.clear();
+	sprites.clear();
+}
@@ -0,0 +1,263 @@
+#include "TextureContainer.h"
+#include "FileManager.h"
+
+#include <cmath>
+
+static const uint8_t ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const uint32_t ktx2HeaderSize = 80;	// identifier, header and index before level index
+static const uint32_t ktx2LevelIndexEntrySize = 24;
+
+static const uint32_t ddsMagic = 0x20534444; // "DDS "
+static const uint32_t ddsHeaderSize = 4 + 124;
+static const uint32_t ddsDx10HeaderSize = 20;
+
+static uint32_t getFullChainLevels(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+static uint32_t makeFourCC(char a, char b, char c, char d)
+{
+	return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+template<typename T>
+static T readValue(const std::vector<char>& data, size_t offset)
+{
+	T value;
+	memcpy(&value, data.data() + offset, sizeof(T));
+	return value;
+}
+
+SgrErrCode TextureContainer::read(const std::string& path, SgrTextureContainer& texture)
+{
+	if (!FileManager::readFileIfExists(path, texture.data))
+		return sgrLoadImageError;
+
+	texture.levels.clear();
+
+	if (texture.data.size() >= ktx2HeaderSize && memcmp(texture.data.data(), ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+		return parseKtx2(texture);
+
+	if (texture.data.size() >= ddsHeaderSize && readValue<uint32_t>(texture.data, 0) == ddsMagic)
+		return parseDds(texture);
+
+	return sgrUnsupportedTextureContainer;
+}
+
+SgrErrCode TextureContainer::parseKtx2(SgrTextureContainer& texture)
+{
+	const std::vector<char>& data = texture.data;
+
+	VkFormat format = static_cast<VkFormat>(readValue<uint32_t>(data, 12));
+	uint32_t width = readValue<uint32_t>(data, 20);
+	uint32_t height = readValue<uint32_t>(data, 24);
+	uint32_t depth = readValue<uint32_t>(data, 28);
+	uint32_t layerCount = readValue<uint32_t>(data, 32);
+	uint32_t faceCount = readValue<uint32_t>(data, 36);
+	uint32_t levelCount = std::max(readValue<uint32_t>(data, 40), 1u); // 0 asks loader to generate mips
+	uint32_t supercompression = readValue<uint32_t>(data, 44);
+
+	uint32_t blockWidth, blockHeight, blockBytes;
+	if (!getFormatBlock(format, blockWidth, blockHeight, blockBytes))
+		return sgrIncorrectImagePixelFormat;
+
+	if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0)
+		return sgrUnsupportedTextureContainer;
+
+	// more levels than full chain would be rejected by vkCreateImage
+	if (levelCount > getFullChainLevels(width, height))
+		return sgrUnsupportedTextureContainer;
+
+	if (data.size() < ktx2HeaderSize + size_t(levelCount) * ktx2LevelIndexEntrySize)
+		return sgrUnsupportedTextureContainer;
+
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+
+	for (uint32_t level = 0; level < levelCount; level++) {
+		size_t entryOffset = ktx2HeaderSize + size_t(level) * ktx2LevelIndexEntrySize;
+		uint64_t byteOffset = readValue<uint64_t>(data, entryOffset);
+		uint64_t byteLength = readValue<uint64_t>(data, entryOffset + 8);
+
+		SgrTextureLevel textureLevel;
+		textureLevel.width = std::max(width >> level, 1u);
+		textureLevel.height = std::max(height >> level, 1u);
+		textureLevel.offset = static_cast<size_t>(byteOffset);
+		textureLevel.size = static_cast<size_t>(byteLength);
+
+		size_t expectedSize = size_t((textureLevel.width + blockWidth - 1) / blockWidth) *
+							  ((textureLevel.height + blockHeight - 1) / blockHeight) * blockBytes;
+		if (textureLevel.size < expectedSize || byteOffset > data.size() || byteLength > data.size() - byteOffset)
+			return sgrUnsupportedTextureContainer;
+
+		texture.levels.push_back(textureLevel);
+	}
+
+	return sgrOK;
+}
+
+SgrErrCode TextureContainer::parseDds(SgrTextureContainer& texture)
+{
+	const std::vector<char>& data = texture.data;
+
+	// offsets are counted from magic
+	uint32_t height = readValue<uint32_t>(data, 12);
+	uint32_t width = readValue<uint32_t>(data, 16);
+	uint32_t depth = readValue<uint32_t>(data, 24);
+	uint32_t levelCount = std::max(readValue<uint32_t>(data, 28), 1u);
+	uint32_t pixelFormatFlags = readValue<uint32_t>(data, 80);
+	uint32_t fourCC = readValue<uint32_t>(data, 84);
+	uint32_t caps2 = readValue<uint32_t>(data, 112);
+
+	const uint32_t ddpfFourCC = 0x4;
+	const uint32_t ddsCaps2CubemapOrVolume = 0x200 | 0x200000;
+	if (!(pixelFormatFlags & ddpfFourCC) || (caps2 & ddsCaps2CubemapOrVolume) || depth > 1)
+		return sgrUnsupportedTextureContainer;
+
+	size_t dataOffset = ddsHeaderSize;
+	uint32_t dxgiFormat = 0;
+	if (fourCC == makeFourCC('D', 'X', '1', '0')) {
+		if (data.size() < ddsHeaderSize + ddsDx10HeaderSize)
+			return sgrUnsupportedTextureContainer;
+
+		const uint32_t ddsDimensionTexture2D = 3;
+		dxgiFormat = readValue<uint32_t>(data, ddsHeaderSize);
+		uint32_t resourceDimension = readValue<uint32_t>(data, ddsHeaderSize + 4);
+		uint32_t arraySize = readValue<uint32_t>(data, ddsHeaderSize + 12);
+		if (resourceDimension != ddsDimensionTexture2D || arraySize > 1)
+			return sgrUnsupportedTextureContainer;
+
+		dataOffset += ddsDx10HeaderSize;
+	}
+
+	VkFormat format = getDdsFormat(fourCC, dxgiFormat);
+	uint32_t blockWidth, blockHeight, blockBytes;
+	if (!getFormatBlock(format, blockWidth, blockHeight, blockBytes))
+		return sgrIncorrectImagePixelFormat;
+
+	if (width == 0 || height == 0 || levelCount > getFullChainLevels(width, height))
+		return sgrUnsupportedTextureContainer;
+
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+
+	// levels are tightly packed one after another
+	for (uint32_t level = 0; level < levelCount; level++) {
+		SgrTextureLevel textureLevel;
+		textureLevel.width = std::max(width >> level, 1u);
+		textureLevel.height = std::max(height >> level, 1u);
+		textureLevel.offset = dataOffset;
+		textureLevel.size = size_t((textureLevel.width + blockWidth - 1) / blockWidth) *
+							((textureLevel.height + blockHeight - 1) / blockHeight) * blockBytes;
+
+		if (dataOffset + textureLevel.size > data.size())
+			return sgrUnsupportedTextureContainer;
+
+		texture.levels.push_back(textureLevel);
+		dataOffset += textureLevel.size;
+	}
+
+	return sgrOK;
+}
+
+VkFormat TextureContainer::getDdsFormat(uint32_t fourCC, uint32_t dxgiFormat)
+{
+	if (fourCC == makeFourCC('D', 'X', 'T', '1'))
+		return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	if (fourCC == makeFourCC('D', 'X', 'T', '3'))
+		return VK_FORMAT_BC2_UNORM_BLOCK;
+	if (fourCC == makeFourCC('D', 'X', 'T', '5'))
+		return VK_FORMAT_BC3_UNORM_BLOCK;
+	if (fourCC == makeFourCC('A', 'T', 'I', '1') || fourCC == makeFourCC('B', 'C', '4', 'U'))
+		return VK_FORMAT_BC4_UNORM_BLOCK;
+	if (fourCC == makeFourCC('B', 'C', '4', 'S'))
+		return VK_FORMAT_BC4_SNORM_BLOCK;
+	if (fourCC == makeFourCC('A', 'T', 'I', '2') || fourCC == makeFourCC('B', 'C', '5', 'U'))
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	if (fourCC == makeFourCC('B', 'C', '5', 'S'))
+		return VK_FORMAT_BC5_SNORM_BLOCK;
+
+	// DXGI_FORMAT values of DX10 header
+	switch (dxgiFormat) {
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+	}
+}
+
+bool TextureContainer::getFormatBlock(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes)
+{
+	blockWidth = 4;
+	blockHeight = 4;
+
+	switch (format) {
+		case VK_FORMAT_R8_UNORM:
+			blockWidth = blockHeight = 1;
+			blockBytes = 1;
+			return true;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			blockWidth = blockHeight = 1;
+			blockBytes = 4;
+			return true;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+			blockBytes = 8;
+			return true;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+			blockBytes = 16;
+			return true;
+		// every ASTC block is 16 bytes, only its footprint differs
+		case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+			blockWidth = blockHeight = 5;
+			blockBytes = 16;
+			return true;
+		case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+			blockWidth = blockHeight = 6;
+			blockBytes = 16;
+			return true;
+		case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+			blockWidth = blockHeight = 8;
+			blockBytes = 16;
+			return true;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,385 @@
+#include <stb_image.h>
+
+#include "TextureLoader.h"
+#include "TextureManager.h"
+#include "MemoryManager.h"
+#include "CommandManager.h"
+#include "LogicalDeviceManager.h"
+#include "ThreadPool.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
+
+TextureLoader* TextureLoader::instance = nullptr;
+
+TextureLoader::TextureLoader() { ; }
+TextureLoader::~TextureLoader() { ; }
+
+TextureLoader* TextureLoader::get()
+{
+	if (instance == nullptr) {
+		instance = new TextureLoader();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+SgrErrCode TextureLoader::loadTextureAsync(std::string path, SgrImage*& image, uint32_t maxSize)
+{
+	if (image != nullptr)
+		return sgrIncorrectPointer;
+
+	// created before first descriptor write, so it does not stall a frame later
+	if (getPlaceholder() == nullptr)
+		return sgrLoadImageError;
+
+	image = new SgrImage{};
+	setTextureState(image, SGR_TEXTURE_LOADING);
+	{
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		stats.loading++;
+	}
+
+	SgrImage* target = image;
+	decodeJobs.push_back(ThreadPool::get()->submit([this, path, target, maxSize]() {
+		SGR_TRACE_SCOPE("TextureLoader::decode");
+
+		SgrDecodedTexture decoded;
+		decoded.image = target;
+
+		int texWidth, texHeight, texChannels;
+		decoded.pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (decoded.pixels != nullptr) {
+			decoded.width = static_cast<uint32_t>(texWidth);
+			decoded.height = static_cast<uint32_t>(texHeight);
+			if (maxSize > 0)
+				downscale(decoded, maxSize);
+		}
+
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		if (maxSize > 0 && decoded.pixels != nullptr)
+			sourceExtents[target] = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight) };
+		decodedTextures.push_back(decoded);
+	}));
+
+	return sgrOK;
+}
+
+void TextureLoader::downscale(SgrDecodedTexture& decoded, uint32_t maxSize)
+{
+	// 2x2 box filter in place, destination texel never overtakes source texels which are not read yet
+	while (decoded.width > maxSize || decoded.height > maxSize) {
+		uint32_t width = std::max(decoded.width / 2, 1u);
+		uint32_t height = std::max(decoded.height / 2, 1u);
+
+		for (uint32_t y = 0; y < height; y++) {
+			uint32_t y0 = std::min(y * 2, decoded.height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, decoded.height - 1);
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t x0 = std::min(x * 2, decoded.width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, decoded.width - 1);
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = decoded.pixels[(size_t(y0) * decoded.width + x0) * 4 + c] + decoded.pixels[(size_t(y0) * decoded.width + x1) * 4 + c] +
+								   decoded.pixels[(size_t(y1) * decoded.width + x0) * 4 + c] + decoded.pixels[(size_t(y1) * decoded.width + x1) * 4 + c];
+					decoded.pixels[(size_t(y) * width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+
+		decoded.width = width;
+		decoded.height = height;
+	}
+}
+
+bool TextureLoader::takeSourceExtent(SgrImage* image, VkExtent2D& extent)
+{
+	std::unique_lock<std::mutex> lock(texturesMutex);
+	auto it = sourceExtents.find(image);
+	if (it == sourceExtents.end())
+		return false;
+
+	extent = it->second;
+	sourceExtents.erase(it);
+	return true;
+}
+
+SgrTextureState TextureLoader::getTextureState(SgrImage* image)
+{
+	std::unique_lock<std::mutex> lock(texturesMutex);
+	auto it = textureStates.find(image);
+	return it == textureStates.end() ? SGR_TEXTURE_READY : it->second;
+}
+
+bool TextureLoader::isTextureReady(SgrImage* image)
+{
+	return getTextureState(image) == SGR_TEXTURE_READY;
+}
+
+void TextureLoader::setTextureState(SgrImage* image, SgrTextureState state)
+{
+	std::unique_lock<std::mutex> lock(texturesMutex);
+	if (state == SGR_TEXTURE_READY)
+		textureStates.erase(image);
+	else
+		textureStates[image] = state;
+}
+
+SgrTextureLoaderStats TextureLoader::getStats()
+{
+	std::unique_lock<std::mutex> lock(texturesMutex);
+	return stats;
+}
+
+SgrImage* TextureLoader::getPlaceholder()
+{
+	if (placeholder != nullptr)
+		return placeholder;
+
+	// grey and magenta checker is easy to spot if texture never arrives
+	const uint32_t pixels[4] = { 0xff808080, 0xffff00ff, 0xffff00ff, 0xff808080 };
+	if (TextureManager::createTextureImageFromPixels((void*)pixels, 2, 2, placeholder) != sgrOK)
+		placeholder = nullptr;
+
+	return placeholder;
+}
+
+SgrErrCode TextureLoader::initSlots()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	slots.resize(uploadSlotCount);
+	for (auto& slot : slots) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = CommandManager::instance->commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS)
+			return sgrInitCommandBuffersError;
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(device, &fenceInfo, HostAllocationTracker::getAllocator(), &slot.fence) != VK_SUCCESS)
+			return sgrInitSyncObjectsError;
+
+		SgrErrCode resultCreateBuffer = MemoryManager::get()->createBuffer(slot.staging, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (resultCreateBuffer != sgrOK)
+			return resultCreateBuffer;
+
+		if (vkMapMemory(device, slot.staging->bufferMemory, 0, stagingSize, 0, &slot.mapped) != VK_SUCCESS)
+			return sgrMapMemoryError;
+	}
+
+	return sgrOK;
+}
+
+SgrErrCode TextureLoader::update()
+{
+	SGR_TRACE_SCOPE("TextureLoader::update");
+
+	if (decodeJobs.empty() && slots.empty())
+		return sgrOK;
+
+	completeUploads(false);
+
+	decodeJobs.erase(std::remove_if(decodeJobs.begin(), decodeJobs.end(), [](const std::shared_future<void>& job) {
+		return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }), decodeJobs.end());
+
+	return submitUploads();
+}
+
+void TextureLoader::completeUploads(bool wait)
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	for (auto& slot : slots) {
+		if (!slot.submitted)
+			continue;
+
+		if (wait)
+			vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+		else if (vkGetFenceStatus(device, slot.fence) != VK_SUCCESS)
+			continue;
+
+		vkResetFences(device, 1, &slot.fence);
+		slot.submitted = false;
+
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		for (auto image : slot.images) {
+			textureStates.erase(image);
+			stats.loading--;
+			stats.loaded++;
+		}
+		slot.images.clear();
+	}
+}
+
+SgrErrCode TextureLoader::recordUpload(SgrUploadSlot& slot, VkDeviceSize offset, SgrDecodedTexture& decoded)
+{
+	VkDeviceSize size = VkDeviceSize(decoded.width) * decoded.height * 4;
+	memcpy((char*)slot.mapped + offset, decoded.pixels, size);
+
+	SgrErrCode resultInitImage = TextureManager::initTextureImage(decoded.image, decoded.width, decoded.height, VK_FORMAT_R8G8B8A8_SRGB, TextureManager::mipmapGeneration);
+	if (resultInitImage != sgrOK)
+		return resultInitImage;
+
+	TextureManager::recordImageUpload(slot.commandBuffer, slot.staging->vkBuffer, offset, decoded.image);
+	slot.images.push_back(decoded.image);
+	MemoryManager::frameStats.bytesUploaded += size;
+
+	std::unique_lock<std::mutex> lock(texturesMutex);
+	stats.bytesUploaded += size;
+	return sgrOK;
+}
+
+SgrErrCode TextureLoader::submitUploads()
+{
+	std::vector<SgrDecodedTexture> decoded;
+	{
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		decoded.swap(decodedTextures);
+	}
+	if (decoded.empty())
+		return sgrOK;
+
+	if (slots.empty()) {
+		SgrErrCode resultInit = initSlots();
+		if (resultInit != sgrOK)
+			return resultInit;
+	}
+
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+	size_t next = 0;
+
+	for (auto& slot : slots) {
+		if (slot.submitted || next == decoded.size())
+			continue;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS)
+			return sgrInitCommandBuffersError;
+
+		// textures are packed into staging buffer until it is full, rest waits for next free slot
+		VkDeviceSize offset = 0;
+		for (; next < decoded.size(); next++) {
+			SgrDecodedTexture& texture = decoded[next];
+			if (texture.pixels == nullptr) {
+				setTextureState(texture.image, SGR_TEXTURE_FAILED);
+				std::unique_lock<std::mutex> lock(texturesMutex);
+				stats.loading--;
+				stats.failed++;
+				continue;
+			}
+
+			VkDeviceSize size = VkDeviceSize(texture.width) * texture.height * 4;
+			if (offset + size > slot.staging->size) {
+				if (offset > 0)
+					break;
+
+				// texture is bigger than whole staging buffer, it is grown for this slot
+				vkUnmapMemory(device, slot.staging->bufferMemory);
+				MemoryManager::destroyBuffer(slot.staging);
+				slot.staging = nullptr;
+				SgrErrCode resultCreateBuffer = MemoryManager::get()->createBuffer(slot.staging, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+				if (resultCreateBuffer != sgrOK)
+					return resultCreateBuffer;
+				if (vkMapMemory(device, slot.staging->bufferMemory, 0, size, 0, &slot.mapped) != VK_SUCCESS)
+					return sgrMapMemoryError;
+			}
+
+			SgrErrCode resultRecord = recordUpload(slot, offset, texture);
+			stbi_image_free(texture.pixels);
+			texture.pixels = nullptr;
+			if (resultRecord != sgrOK) {
+				setTextureState(texture.image, SGR_TEXTURE_FAILED);
+				std::unique_lock<std::mutex> lock(texturesMutex);
+				stats.loading--;
+				stats.failed++;
+				continue;
+			}
+
+			// copy offset must be multiple of texel size, 16 covers all formats
+			offset = (offset + size + 15) & ~VkDeviceSize(15);
+		}
+
+		if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS)
+			return sgrInitCommandBuffersError;
+
+		if (slot.images.empty())
+			continue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.commandBuffer;
+		if (vkQueueSubmit(LogicalDeviceManager::instance->graphicsQueue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+			return sgrQueueSubmitFailed;
+
+		slot.submitted = true;
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		stats.uploadBatches++;
+	}
+
+	// all slots are busy, textures are uploaded by next frames
+	if (next < decoded.size()) {
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		decodedTextures.insert(decodedTextures.begin(), decoded.begin() + next, decoded.end());
+	}
+
+	return sgrOK;
+}
+
+SgrErrCode TextureLoader::waitAll()
+{
+	SGR_TRACE_SCOPE("TextureLoader::waitAll");
+
+	for (auto& job : decodeJobs)
+		job.wait();
+	decodeJobs.clear();
+
+	while (true) {
+		SgrErrCode resultSubmit = submitUploads();
+		if (resultSubmit != sgrOK)
+			return resultSubmit;
+
+		completeUploads(true);
+
+		std::unique_lock<std::mutex> lock(texturesMutex);
+		if (decodedTextures.empty())
+			break;
+	}
+
+	return sgrOK;
+}
+
+void TextureLoader::destroy()
+{
+	VkDevice device = LogicalDeviceManager::instance->logicalDevice;
+
+	for (auto& job : decodeJobs)
+		job.wait();
+	decodeJobs.clear();
+
+	for (auto& texture : decodedTextures)
+		stbi_image_free(texture.pixels);
+	decodedTextures.clear();
+
+	completeUploads(true);
+	for (auto& slot : slots) {
+		vkDestroyFence(device, slot.fence, HostAllocationTracker::getAllocator());
+		if (slot.staging != nullptr) {
+			vkUnmapMemory(device, slot.staging->bufferMemory);
+			MemoryManager::destroyBuffer(slot.staging);
+		}
+		vkFreeCommandBuffers(device, CommandManager::instance->commandPool, 1, &slot.commandBuffer);
+	}
+	slots.clear();
+
+	// placeholder and loaded images are released with all created images
+	delete instance;
+	instance = nullptr;
+}
@@ -7,10 +7,20 @@
 #include "CommandManager.h"
 #include "LogicalDeviceManager.h"
 #include "PhysicalDeviceManager.h"
+#include "DeletionQueue.h"
+#include "TextureLoader.h"
+#include "TextureContainer.h"
+#include "HostAllocationTracker.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <algorithm>
 
 TextureManager* TextureManager::instance = nullptr;
 
-std::vector<VkSampler*> TextureManager::createdSamplers;
+std::map<TextureManager::SgrSamplerKey, VkSampler> TextureManager::samplerCache;
+std::mutex TextureManager::samplerCacheMutex;
+bool TextureManager::mipmapGeneration = false;
 
 TextureManager::TextureManager() { ; }
 
@@ -24,8 +34,10 @@ TextureManager* TextureManager::get()
 	return instance;
 }
 
-SgrErrCode TextureManager::createImage(void* pixels, const uint32_t width, const uint32_t height, VkFormat format , SgrImage*& image)
+SgrErrCode TextureManager::createImage(void* pixels, const uint32_t width, const uint32_t height, VkFormat format , SgrImage*& image, bool generateMipmaps)
 {
+	SGR_TRACE_SCOPE("TextureManager::createImage");
+
 	if (!pixels)
         return sgrLoadImageError;
 
@@ -50,82 +62,442 @@ SgrErrCode TextureManager::createImage(void* pixels, const uint32_t width, const
     if (resultInitStagingBufferWithData != sgrOK)
         return resultInitStagingBufferWithData;
 
+    SgrErrCode resultInitTextureImage = initTextureImage(image, width, height, format, generateMipmaps);
+    if (resultInitTextureImage != sgrOK)
+        return resultInitTextureImage;
+
+    // layout transitions, copy and mip blits are done by one submission
+    VkCommandBuffer commandBuffer = CommandManager::instance->beginSingleTimeCommands();
+    recordImageUpload(commandBuffer, stagingBuffer->vkBuffer, 0, image);
+    CommandManager::instance->endSingleTimeCommands(commandBuffer);
+
+    MemoryManager::destroyBuffer(stagingBuffer);
+
+	return sgrOK;
+}
+
+SgrErrCode TextureManager::initTextureImage(SgrImage* image, const uint32_t width, const uint32_t height, VkFormat format, bool generateMipmaps)
+{
     image->width = width;
     image->height = height;
     image->format = format;
     image->tiling = VK_IMAGE_TILING_OPTIMAL;
     image->usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    // preset level count limits generated chain, without generation it is count of stored levels
+    VkFilter filter;
+    if (generateMipmaps && getMipmapBlitFilter(format, filter)) {
+        uint32_t fullChainLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+        image->mipLevels = image->mipLevels > 1 ? std::min(image->mipLevels, fullChainLevels) : fullChainLevels;
+        image->usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    else if (generateMipmaps)
+        image->mipLevels = 1; // format without blit support gets single level texture
+
     image->properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     SgrErrCode resultCreateImage = SwapChainManager::createImage(image);
     if (resultCreateImage != sgrOK)
         return resultCreateImage;
 
-    SgrErrCode resultTransitionImageLayout = SwapChainManager::transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    if (resultTransitionImageLayout != sgrOK)
-        return resultTransitionImageLayout;
+    SgrErrCode resultCreateImageView = SwapChainManager::createImageView(image->vkImage, image->format, VK_IMAGE_ASPECT_COLOR_BIT, &image->view, image->mipLevels);
+    if (resultCreateImageView != sgrOK)
+        return resultCreateImageView;
+
+    return getSampler(SgrSamplerDesc(), image->sampler);
+}
+
+bool TextureManager::getMipmapBlitFilter(VkFormat format, VkFilter& filter)
+{
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(PhysicalDeviceManager::instance->pickedPhysicalDevice.vkPhysDevice, format, &props);
+
+    VkFormatFeatureFlags features = props.optimalTilingFeatures;
+    if (!(features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) || !(features & VK_FORMAT_FEATURE_BLIT_DST_BIT))
+        return false;
+
+    // linear blit is optional, nearest downsampling is still better than no mips
+    filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    return true;
+}
+
+void TextureManager::recordImageUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, SgrImage* image)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image->vkImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = image->mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = bufferOffset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { image->width, image->height, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, buffer, image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    recordMipmapGeneration(commandBuffer, image);
+}
+
+void TextureManager::recordMipmapGeneration(VkCommandBuffer commandBuffer, SgrImage* image)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image->vkImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // every level is blitted from previous one, source level is released to shader right after its blit
+    VkFilter filter = VK_FILTER_LINEAR;
+    if (image->mipLevels > 1)
+        getMipmapBlitFilter(image->format, filter);
 
-    MemoryManager::copyBufferToImage(stagingBuffer, image);
+    int32_t mipWidth = static_cast<int32_t>(image->width);
+    int32_t mipHeight = static_cast<int32_t>(image->height);
+    for (uint32_t level = 1; level < image->mipLevels; level++) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    resultTransitionImageLayout = SwapChainManager::transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    if (resultTransitionImageLayout != sgrOK)
-        return resultTransitionImageLayout;
+        int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage(commandBuffer, image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    // last level was only written
+    barrier.subresourceRange.baseMipLevel = image->mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+SgrErrCode TextureManager::updateTextureRegion(SgrImage* image, void* rgbaPixels, VkOffset2D offset, VkExtent2D extent, bool initialized)
+{
+    SGR_TRACE_SCOPE("TextureManager::updateTextureRegion");
+
+    SgrBuffer* stagingBuffer = nullptr;
+    SgrErrCode resultInitStagingBufferWithData = MemoryManager::instance->createStagingBufferWithData(stagingBuffer, VkDeviceSize(extent.width) * extent.height * 4, rgbaPixels);
+    if (resultInitStagingBufferWithData != sgrOK)
+        return resultInitStagingBufferWithData;
+
+    VkCommandBuffer commandBuffer = CommandManager::instance->beginSingleTimeCommands();
+
+    // texture can be sampled by frames submitted before, their reads must finish before copy
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image->vkImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = image->mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    VkPipelineStageFlags srcStage = initialized ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { offset.x, offset.y, 0 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->vkBuffer, image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    recordMipmapGeneration(commandBuffer, image);
+    CommandManager::instance->endSingleTimeCommands(commandBuffer);
 
     MemoryManager::destroyBuffer(stagingBuffer);
 
-    SgrErrCode resultCreateImageView = SwapChainManager::createImageView(image->vkImage, image->format, VK_IMAGE_ASPECT_COLOR_BIT, &image->view);
-    if (resultCreateImageView != sgrOK)
-        return resultCreateImageView;
+    return sgrOK;
+}
 
-    SgrErrCode resultCreateSampler = createTextureSampler(image->sampler);
-    if (resultCreateSampler != sgrOK)
-        return resultCreateSampler;
+void TextureManager::recordLevelsUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, const std::vector<VkBufferImageCopy>& regions, SgrImage* image)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image->vkImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = image->mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-	return sgrOK;
+    vkCmdCopyBufferToImage(commandBuffer, buffer, image->vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+bool TextureManager::isTextureFormatSupported(VkFormat format)
+{
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(PhysicalDeviceManager::instance->pickedPhysicalDevice.vkPhysDevice, format, &props);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & required) == required;
+}
+
+SgrErrCode TextureManager::createCompressedTextureImage(const std::vector<std::string>& paths, SgrImage*& image)
+{
+    SGR_TRACE_SCOPE("TextureManager::createCompressedTextureImage");
+
+    SgrErrCode result = sgrTextureFormatNotSupported;
+    SgrTextureContainer texture;
+    for (const std::string& path : paths) {
+        result = TextureContainer::read(path, texture);
+        if (result == sgrOK && !isTextureFormatSupported(texture.format))
+            result = sgrTextureFormatNotSupported;
+        if (result == sgrOK)
+            break;
+    }
+    if (result != sgrOK)
+        return result;
+
+    // copy offsets must be multiple of block size, levels are repacked with 16 bytes alignment
+    const VkDeviceSize levelAlignment = 16;
+    std::vector<VkBufferImageCopy> regions(texture.levels.size());
+    VkDeviceSize stagingSize = 0;
+    for (size_t i = 0; i < texture.levels.size(); i++) {
+        stagingSize = (stagingSize + levelAlignment - 1) & ~(levelAlignment - 1);
+
+        VkBufferImageCopy& region = regions[i];
+        region = {};
+        region.bufferOffset = stagingSize;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { texture.levels[i].width, texture.levels[i].height, 1 };
+
+        stagingSize += texture.levels[i].size;
+    }
+
+    std::vector<char> packedLevels(stagingSize);
+    for (size_t i = 0; i < texture.levels.size(); i++)
+        memcpy(packedLevels.data() + regions[i].bufferOffset, texture.data.data() + texture.levels[i].offset, texture.levels[i].size);
+
+    image = new SgrImage;
+    image->mipLevels = static_cast<uint32_t>(texture.levels.size());
+
+    SgrBuffer* stagingBuffer = nullptr;
+    SgrErrCode resultInitStagingBufferWithData = MemoryManager::instance->createStagingBufferWithData(stagingBuffer, stagingSize, packedLevels.data());
+    if (resultInitStagingBufferWithData != sgrOK)
+        return resultInitStagingBufferWithData;
+
+    SgrErrCode resultInitTextureImage = initTextureImage(image, texture.width, texture.height, texture.format, false);
+    if (resultInitTextureImage != sgrOK)
+        return resultInitTextureImage;
+
+    VkCommandBuffer commandBuffer = CommandManager::instance->beginSingleTimeCommands();
+    recordLevelsUpload(commandBuffer, stagingBuffer->vkBuffer, regions, image);
+    CommandManager::instance->endSingleTimeCommands(commandBuffer);
+
+    MemoryManager::destroyBuffer(stagingBuffer);
+
+    return sgrOK;
 }
 
 SgrErrCode TextureManager::createTextureImage(std::string image_path, SgrImage*& image)
 {
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(image_path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	SgrErrCode result = createImage(pixels, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, image);
+	SgrErrCode result = createImage(pixels, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, image, mipmapGeneration);
     stbi_image_free(pixels);
 	return result;
 }
 
 SgrErrCode TextureManager::createFontTextureImage(void* fontPixels, const uint32_t fontWidth, const uint32_t fontHeight, SgrImage*& image)
 {
-	return createImage(fontPixels, fontWidth, fontHeight, VK_FORMAT_R8_UNORM, image);
+	return createImage(fontPixels, fontWidth, fontHeight, VK_FORMAT_R8_UNORM, image, false);
+}
+
+SgrErrCode TextureManager::createTextureImageFromPixels(void* rgbaPixels, const uint32_t width, const uint32_t height, SgrImage*& image)
+{
+	return createImage(rgbaPixels, width, height, VK_FORMAT_R8G8B8A8_SRGB, image, mipmapGeneration);
+}
+
+SgrErrCode TextureManager::loadTextureImageAsync(std::string image_path, SgrImage*& image)
+{
+	return TextureLoader::get()->loadTextureAsync(image_path, image);
+}
+
+SgrTextureState TextureManager::getTextureState(SgrImage* image)
+{
+	return TextureLoader::get()->getTextureState(image);
+}
+
+SgrErrCode TextureManager::waitAsyncTextures()
+{
+	return TextureLoader::get()->waitAll();
+}
+
+SgrErrCode TextureManager::destroyTextureImage(SgrImage*& image)
+{
+	if (image == nullptr)
+		return sgrIncorrectPointer;
+
+	// worker or upload slot still writes into image
+	if (TextureLoader::get()->getTextureState(image) == SGR_TEXTURE_LOADING)
+		return sgrTextureLoadInProgress;
+	TextureLoader::get()->setTextureState(image, SGR_TEXTURE_READY); // forget failed texture
+
+	// handles are not released at shutdown anymore
+	std::vector<AllocatedImageData>& createdImages = SwapChainManager::createdImages;
+	createdImages.erase(std::remove_if(createdImages.begin(), createdImages.end(),
+		[image](const AllocatedImageData& img) { return img.imgP == &image->vkImage; }), createdImages.end());
+
+	std::vector<VkImageView*>& createdImageViews = SwapChainManager::createdImageViews;
+	createdImageViews.erase(std::remove(createdImageViews.begin(), createdImageViews.end(), &image->view), createdImageViews.end());
+
+	image->sampler = VK_NULL_HANDLE; // shared with other textures, owned by cache
+
+	// descriptor sets of frames in flight can still reference texture
+	DeletionQueue::get()->retireSgrImage(image);
+	image = nullptr;
+
+	return sgrOK;
+}
+
+TextureManager::SgrSamplerKey TextureManager::getSamplerKey(const VkSamplerCreateInfo& samplerInfo)
+{
+    auto bits = [](float value) { uint32_t result; memcpy(&result, &value, sizeof(result)); return result; };
+
+    return { uint32_t(samplerInfo.magFilter), uint32_t(samplerInfo.minFilter), uint32_t(samplerInfo.mipmapMode),
+             uint32_t(samplerInfo.addressModeU), uint32_t(samplerInfo.addressModeV), uint32_t(samplerInfo.addressModeW),
+             bits(samplerInfo.mipLodBias), samplerInfo.anisotropyEnable, bits(samplerInfo.maxAnisotropy),
+             samplerInfo.compareEnable, uint32_t(samplerInfo.compareOp), bits(samplerInfo.minLod), bits(samplerInfo.maxLod),
+             uint32_t(samplerInfo.borderColor), samplerInfo.unnormalizedCoordinates };
 }
 
-SgrErrCode TextureManager::createTextureSampler(VkSampler& sampler)
+SgrErrCode TextureManager::getSampler(const SgrSamplerDesc& desc, VkSampler& sampler)
 {
+    const SgrPhysicalDevice& physicalDevice = PhysicalDeviceManager::instance->pickedPhysicalDevice;
+    bool anisotropy = desc.anisotropy && physicalDevice.deviceFeatures.samplerAnisotropy;
+
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = PhysicalDeviceManager::instance->pickedPhysicalDevice.deviceFeatures.samplerAnisotropy;
-    samplerInfo.maxAnisotropy = PhysicalDeviceManager::instance->pickedPhysicalDevice.props.limits.maxSamplerAnisotropy;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.magFilter = desc.magFilter;
+    samplerInfo.minFilter = desc.minFilter;
+    samplerInfo.addressModeU = desc.addressModeU;
+    samplerInfo.addressModeV = desc.addressModeV;
+    samplerInfo.addressModeW = desc.addressModeW;
+    samplerInfo.anisotropyEnable = anisotropy ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = anisotropy ? physicalDevice.props.limits.maxSamplerAnisotropy : 1.0f;
+    samplerInfo.borderColor = desc.borderColor;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipmapMode = desc.mipmapMode;
+    samplerInfo.minLod = desc.minLod;
+    samplerInfo.maxLod = desc.maxLod;
+    samplerInfo.mipLodBias = desc.mipLodBias;
+
+    SgrSamplerKey key = getSamplerKey(samplerInfo);
+
+    std::unique_lock<std::mutex> lock(samplerCacheMutex);
+    auto cached = samplerCache.find(key);
+    if (cached != samplerCache.end()) {
+        sampler = cached->second;
+        return sgrOK;
+    }
 
-    if (vkCreateSampler(LogicalDeviceManager::instance->logicalDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    if (vkCreateSampler(LogicalDeviceManager::instance->logicalDevice, &samplerInfo, HostAllocationTracker::getAllocator(), &sampler) != VK_SUCCESS)
         return sgrCreateSamplerError;
 
-    createdSamplers.push_back(&sampler);
+    samplerCache[key] = sampler;
 
     return sgrOK;
 }
 
+size_t TextureManager::getSamplerCount()
+{
+    std::unique_lock<std::mutex> lock(samplerCacheMutex);
+    return samplerCache.size();
+}
+
+SgrErrCode TextureManager::setTextureSampler(SgrImage* image, const SgrSamplerDesc& desc)
+{
+    if (image == nullptr)
+        return sgrIncorrectPointer;
+
+    // previous sampler stays in cache, so descriptor sets of frames in flight remain valid
+    return getSampler(desc, image->sampler);
+}
+
+void TextureManager::setMipmapGeneration(bool enable)
+{
+	mipmapGeneration = enable;
+}
+
 SgrErrCode TextureManager::destroyAllSamplers()
 {
-    for (auto& sampler : createdSamplers)
-        vkDestroySampler(LogicalDeviceManager::instance->logicalDevice, *sampler, nullptr);
+    std::unique_lock<std::mutex> lock(samplerCacheMutex);
+    for (auto& sampler : samplerCache)
+        vkDestroySampler(LogicalDeviceManager::instance->logicalDevice, sampler.second, HostAllocationTracker::getAllocator());
+    samplerCache.clear();
 
     return sgrOK;
 }
@@ -0,0 +1,245 @@
+#include "TextureStreamer.h"
+#include "TextureLoader.h"
+#include "TextureManager.h"
+#include "DescriptorManager.h"
+#include "Trace.h"
+
+#include <cmath>
+
+TextureStreamer* TextureStreamer::instance = nullptr;
+
+TextureStreamer::TextureStreamer() { ; }
+TextureStreamer::~TextureStreamer() { ; }
+
+TextureStreamer* TextureStreamer::get()
+{
+	if (instance == nullptr) {
+		instance = new TextureStreamer();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+SgrErrCode TextureStreamer::registerTexture(std::string path, SgrImage*& handle)
+{
+	if (handle != nullptr)
+		return sgrIncorrectPointer;
+
+	// low resolution version is decoded from the same file and stays resident until texture is unregistered
+	SgrStreamedTexture texture;
+	texture.path = path;
+	SgrErrCode resultLoad = TextureLoader::get()->loadTextureAsync(path, texture.lowRes, lowResSize);
+	if (resultLoad != sgrOK)
+		return resultLoad;
+
+	handle = new SgrImage{};
+	textures[handle] = texture;
+	stats.registered++;
+
+	return sgrOK;
+}
+
+SgrErrCode TextureStreamer::unregisterTexture(SgrImage*& handle)
+{
+	auto it = textures.find(handle);
+	if (it == textures.end())
+		return sgrIncorrectPointer;
+
+	SgrStreamedTexture& texture = it->second;
+	TextureLoader* textureLoader = TextureLoader::get();
+	if (textureLoader->getTextureState(texture.lowRes) == SGR_TEXTURE_LOADING ||
+		(texture.fullRes != nullptr && textureLoader->getTextureState(texture.fullRes) == SGR_TEXTURE_LOADING))
+		return sgrTextureLoadInProgress;
+
+	if (texture.fullResident) {
+		stats.resident--;
+		stats.residentBytes -= getImageBytes(texture.fullRes);
+	}
+	VkExtent2D extent;
+	textureLoader->takeSourceExtent(texture.lowRes, extent); // not taken if update didn't run after decoding
+	if (texture.fullRes != nullptr)
+		TextureManager::destroyTextureImage(texture.fullRes);
+	TextureManager::destroyTextureImage(texture.lowRes);
+
+	// handle must not be resolved by rewrites of sets written with it, it is freed below
+	DescriptorManager::get()->forgetStreamedTexture(handle);
+
+	textures.erase(it);
+	changedTextures.erase(handle);
+	stats.registered--;
+
+	delete handle;
+	handle = nullptr;
+
+	return sgrOK;
+}
+
+void TextureStreamer::setBudget(VkDeviceSize bytes)
+{
+	budget = bytes;
+}
+
+void TextureStreamer::markUsed(SgrImage* handle)
+{
+	auto it = textures.find(handle);
+	if (it != textures.end())
+		it->second.lastUsedFrame = currentFrame;
+}
+
+SgrTextureStreamerStats TextureStreamer::getStats()
+{
+	SgrTextureStreamerStats result = stats;
+	result.budget = budget;
+	return result;
+}
+
+bool TextureStreamer::hasTextures()
+{
+	return !textures.empty();
+}
+
+SgrImage* TextureStreamer::resolve(SgrImage* image)
+{
+	auto it = textures.find(image);
+	if (it == textures.end())
+		return image;
+
+	return it->second.fullResident ? it->second.fullRes : it->second.lowRes;
+}
+
+bool TextureStreamer::isResidencyChanged(SgrImage* image)
+{
+	return changedTextures.count(image) > 0;
+}
+
+SgrErrCode TextureStreamer::update()
+{
+	SGR_TRACE_SCOPE("TextureStreamer::update");
+
+	changedTextures.clear();
+	if (textures.empty()) {
+		currentFrame++;
+		return sgrOK;
+	}
+
+	// uploads are completed by TextureLoader, here they only become visible to descriptor sets
+	TextureLoader* textureLoader = TextureLoader::get();
+	for (auto& it : textures) {
+		SgrStreamedTexture& texture = it.second;
+		if (texture.fullExtent.width == 0)
+			textureLoader->takeSourceExtent(texture.lowRes, texture.fullExtent);
+
+		if (texture.fullRes == nullptr || texture.fullResident)
+			continue;
+
+		SgrTextureState state = textureLoader->getTextureState(texture.fullRes);
+		if (state == SGR_TEXTURE_LOADING)
+			continue;
+
+		stats.loading--;
+		stats.loadingBytes -= texture.loadingBytes;
+		texture.loadingBytes = 0;
+		if (state == SGR_TEXTURE_FAILED) {
+			TextureManager::destroyTextureImage(texture.fullRes);
+			texture.failed = true;
+			continue;
+		}
+
+		texture.fullResident = true;
+		stats.resident++;
+		stats.loads++;
+		stats.residentBytes += getImageBytes(texture.fullRes);
+		changedTextures.insert(it.first);
+	}
+
+	if (stats.residentBytes + stats.loadingBytes > budget)
+		evictLeastRecentlyUsed(budget);
+
+	// textures drawn in this frame are requested only if their estimated size fits budget with pending ones,
+	// textures which weren't drawn in this frame are evicted to free place
+	for (auto& it : textures) {
+		if (stats.loading >= maxLoadingTextures)
+			break;
+
+		SgrStreamedTexture& texture = it.second;
+		if (texture.lastUsedFrame != currentFrame || texture.fullRes != nullptr || texture.failed || texture.fullExtent.width == 0)
+			continue;
+
+		uint32_t mipLevels = 1;
+		if (TextureManager::mipmapGeneration)
+			mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture.fullExtent.width, texture.fullExtent.height)))) + 1;
+		VkDeviceSize estimatedBytes = getImageBytes(texture.fullExtent.width, texture.fullExtent.height, mipLevels);
+		if (estimatedBytes > budget)
+			continue;
+
+		if (stats.residentBytes + stats.loadingBytes + estimatedBytes > budget)
+			evictLeastRecentlyUsed(budget - estimatedBytes);
+		if (stats.residentBytes + stats.loadingBytes + estimatedBytes > budget)
+			continue;
+
+		SgrErrCode resultLoad = textureLoader->loadTextureAsync(texture.path, texture.fullRes);
+		if (resultLoad != sgrOK)
+			return resultLoad;
+
+		texture.loadingBytes = estimatedBytes;
+		stats.loading++;
+		stats.loadingBytes += estimatedBytes;
+	}
+
+	currentFrame++;
+	return sgrOK;
+}
+
+void TextureStreamer::evictLeastRecentlyUsed(VkDeviceSize targetBytes)
+{
+	SGR_TRACE_SCOPE("TextureStreamer::evictLeastRecentlyUsed");
+
+	// textures drawn in current frame are kept, requests are limited instead
+	std::vector<std::pair<uint64_t, SgrImage*>> candidates;
+	for (auto& it : textures)
+		if (it.second.fullResident && it.second.lastUsedFrame < currentFrame)
+			candidates.push_back({ it.second.lastUsedFrame, it.first });
+	std::sort(candidates.begin(), candidates.end());
+
+	for (auto& candidate : candidates) {
+		if (stats.residentBytes + stats.loadingBytes <= targetBytes)
+			break;
+
+		// sets are switched to low resolution in this frame, image is destroyed after frames in flight
+		SgrStreamedTexture& texture = textures[candidate.second];
+		stats.residentBytes -= getImageBytes(texture.fullRes);
+		TextureManager::destroyTextureImage(texture.fullRes);
+		texture.fullResident = false;
+
+		stats.resident--;
+		stats.evictions++;
+		changedTextures.insert(candidate.second);
+	}
+}
+
+VkDeviceSize TextureStreamer::getImageBytes(uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	// streamed textures are RGBA8 loaded by TextureLoader
+	VkDeviceSize bytes = 0;
+	for (uint32_t level = 0; level < mipLevels; level++)
+		bytes += VkDeviceSize(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+
+	return bytes;
+}
+
+VkDeviceSize TextureStreamer::getImageBytes(SgrImage* image)
+{
+	return getImageBytes(image->width, image->height, image->mipLevels);
+}
+
+void TextureStreamer::destroy()
+{
+	// low and full resolution images are released with all created images
+	for (auto& it : textures)
+		delete it.first;
+	textures.clear();
+
+	delete instance;
+	instance = nullptr;
+}
@@ -0,0 +1,63 @@
+#include "ThreadPool.h"
+
+ThreadPool* ThreadPool::instance = nullptr;
+
+ThreadPool::ThreadPool()
+{
+	// keep one core for the render thread
+	uint32_t workersCount = std::thread::hardware_concurrency();
+	workersCount = workersCount > 1 ? workersCount - 1 : 1;
+
+	for (uint32_t i = 0; i < workersCount; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() { ; }
+
+ThreadPool* ThreadPool::get()
+{
+	if (instance == nullptr) {
+		instance = new ThreadPool();
+		return instance;
+	}
+	else
+		return instance;
+}
+
+uint32_t ThreadPool::getWorkersCount()
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
+
+void ThreadPool::destroy()
+{
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+
+	workers.clear();
+	delete instance;
+	instance = nullptr;
+}
@@ -0,0 +1,144 @@
+#include "Trace.h"
+
+#include <cstdio>
+
+TraceManager* TraceManager::instance = nullptr;
+
+static thread_local SgrTraceBuffer* threadBuffer = nullptr;
+
+TraceManager::TraceManager() : traceStart(SgrTime::now()) { ; }
+TraceManager::~TraceManager() { ; }
+
+// trace is never destroyed, worker threads can record events until process exit
+TraceManager* TraceManager::get()
+{
+	static std::once_flag created;
+	std::call_once(created, []() { instance = new TraceManager(); });
+	return instance;
+}
+
+bool TraceManager::isCompiled()
+{
+#ifdef SGR_ENABLE_TRACE
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TraceManager::setEnabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool TraceManager::isEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+SgrTraceBuffer* TraceManager::getThreadBuffer()
+{
+	if (threadBuffer != nullptr)
+		return threadBuffer;
+
+	// lock is taken only once per thread
+	std::unique_lock<std::mutex> lock(buffersMutex);
+	buffers.push_back(std::make_unique<SgrTraceBuffer>());
+	threadBuffer = buffers.back().get();
+	threadBuffer->events.resize(eventsPerThread);
+	threadBuffer->threadIndex = static_cast<uint32_t>(buffers.size());
+
+	return threadBuffer;
+}
+
+void TraceManager::addEvent(const char* name, SgrTime_t begin, SgrTime_t end)
+{
+	if (!isEnabled())
+		return;
+
+	SgrTraceBuffer* buffer = getThreadBuffer();
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+
+	SgrTraceEvent& event = buffer->events[index % eventsPerThread];
+	event.name = name;
+	event.begin = begin > traceStart ? std::chrono::duration_cast<std::chrono::nanoseconds>(begin - traceStart).count() : 0;
+	event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+static void writeJsonString(std::ofstream& file, const char* str)
+{
+	file << '"';
+	for (const char* c = str; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			file << '\\';
+		file << *c;
+	}
+	file << '"';
+}
+
+SgrErrCode TraceManager::saveChromeTrace(std::string path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return sgrSaveTraceError;
+
+	std::vector<SgrTraceBuffer*> threads;
+	{
+		std::unique_lock<std::mutex> lock(buffersMutex);
+		for (auto& buffer : buffers)
+			threads.push_back(buffer.get());
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	uint64_t hiddenBefore = clearedAt.load(std::memory_order_relaxed);
+	bool first = true;
+	std::vector<SgrTraceEvent> events;
+	for (auto thread : threads) {
+		uint64_t writtenBefore = thread->written.load(std::memory_order_acquire);
+		uint64_t firstEvent = writtenBefore > eventsPerThread ? writtenBefore - eventsPerThread : 0;
+
+		events.clear();
+		for (uint64_t i = firstEvent; i < writtenBefore; i++)
+			events.push_back(thread->events[i % eventsPerThread]);
+
+		// owner thread continues writing while we copy, oldest copied events could be overwritten
+		uint64_t writtenAfter = thread->written.load(std::memory_order_acquire);
+		uint64_t firstValid = writtenAfter > eventsPerThread ? writtenAfter - eventsPerThread : 0;
+		size_t skip = firstValid > firstEvent ? static_cast<size_t>(std::min<uint64_t>(firstValid - firstEvent, events.size())) : 0;
+
+		if (!first)
+			file << ",";
+		first = false;
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->threadIndex
+			 << ",\"args\":{\"name\":\"SGR thread " << thread->threadIndex << "\"}}";
+
+		for (size_t i = skip; i < events.size(); i++) {
+			if (events[i].begin < hiddenBefore)
+				continue;
+
+			char times[64];
+			snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f", events[i].begin / 1000.0, events[i].duration / 1000.0);
+
+			file << ",{\"name\":";
+			writeJsonString(file, events[i].name);
+			file << ",\"cat\":\"sgr\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->threadIndex << ",\"ts\":" << times << "}";
+		}
+	}
+
+	file << "]}\n";
+	file.close();
+
+	if (file.fail())
+		return sgrSaveTraceError;
+
+	return sgrOK;
+}
+
+void TraceManager::clear()
+{
+	// owner threads keep writing without synchronization, so older events are only hidden from dump
+	clearedAt.store(std::chrono::duration_cast<std::chrono::nanoseconds>(SgrTime::now() - traceStart).count(), std::memory_order_relaxed);
+}
@@ -5,6 +5,7 @@
 #include "DescriptorManager.h"
 #include "RenderPassManager.h"
 #include "CommandManager.h"
+#include "HostAllocationTracker.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_vulkan.h"
@@ -40,6 +41,7 @@ SgrErrCode UIManager::init(GLFWwindow* window, VkInstance instance, uint8_t imag
     init_info.RenderPass = RenderPassManager::instance->renderPass; 
     init_info.MinImageCount = imageCount;
     init_info.ImageCount = imageCount;
+    init_info.Allocator = HostAllocationTracker::getAllocator();
 
     ImGui_ImplVulkan_Init(&init_info);
     ImGui_ImplVulkan_CreateFontsTexture();
@@ -60,9 +62,13 @@ void UIManager::uiRender()
 
     ImGui::Render();
     ImDrawData* data = ImGui::GetDrawData();
-    ImGui_ImplVulkan_RenderDrawData(data, CommandManager::instance->commandBuffers[0]);
-    ImGui_ImplVulkan_RenderDrawData(data, CommandManager::instance->commandBuffers[1]);
-    ImGui_ImplVulkan_RenderDrawData(data, CommandManager::instance->commandBuffers[2]);
+    for (auto cmdBuffer : CommandManager::instance->commandBuffers)
+        ImGui_ImplVulkan_RenderDrawData(data, cmdBuffer);
+}
+
+void UIManager::setImageCount(uint8_t imageCount)
+{
+    ImGui_ImplVulkan_SetMinImageCount(imageCount);
 }
 
 void UIManager::setupUICallback()
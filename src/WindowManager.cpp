@@ -7,12 +7,9 @@ void WindowManager::framebufferResizeCallback(GLFWwindow* window, int width, int
 	if (width == 0 || height == 0)
 		app->windowMinimized = true;
 	else {
+		// swapchain is recreated once at the next frame, not for each resize event
 		app->windowResized = true;
 		app->windowMinimized = false;
-		if (app->getParrentSGRptr()) {
-			app->requestUpdateSwapChain();
-			app->getParrentSGRptr()->drawFrame();
-		}
 	}
 }
 
@@ -91,12 +88,6 @@ void WindowManager::setAspectRatio(uint8_t x, uint8_t y)
 	glfwSetWindowAspectRatio(window, x, y);
 }
 
-void WindowManager::requestUpdateSwapChain()
-{
-	SwapChainManager::instance->reinitSwapChain();
-	windowResized = false;
-}
-
 void WindowManager::destroy()
 {
 	glfwDestroyWindow(window);